@@ -0,0 +1,107 @@
+# Runs the benchmarks for the bench target, cmake -P with:
+#   BENCHES     The executables to run, separated by "|"
+#   OUTPUT      File to collect their output in
+#   SOURCE_DIR  Top of the repo, for the commit the results are for
+#   PROFDATA    llvm-profdata, to merge Clang profiles into PGO_DIR after
+#               the run, or empty
+#   PGO_DIR     Where profiles are written
+#   REPLAYS     Lessons to check with a recorded replay, separated by "|"
+#   WORK_DIR    Where the replay logs are written
+#   GOLDEN_BENCH  The golden image check, among BENCHES
+#   GOLDEN_DIR  The committed golden images it checks against
+
+string(REPLACE "|" ";" BENCHES "${BENCHES}")
+string(REPLACE "|" ";" REPLAYS "${REPLAYS}")
+
+execute_process(COMMAND git rev-parse --short HEAD
+    WORKING_DIRECTORY "${SOURCE_DIR}"
+    OUTPUT_VARIABLE commit
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    ERROR_QUIET)
+file(WRITE "${OUTPUT}" "# commit ${commit}\n")
+
+set(ENV{SDL_VIDEODRIVER} dummy)
+
+# Everything runs even when something fails, so the output is complete
+# and a PGO training run still has every profile. What failed is listed
+# at the end, and fails the target
+set(failed)
+
+# Without committed golden images every scene would fail, so on a fresh
+# tree they are made in WORK_DIR first and the run checks against those.
+# That only shows the scenes draw the same every time, not that they look
+# right: run golden_update and commit res/golden for that
+set(golden_args)
+file(GLOB goldens "${GOLDEN_DIR}/*.golden")
+if(GOLDEN_BENCH AND NOT goldens)
+    message(WARNING "No golden images in ${GOLDEN_DIR}, making them in "
+        "${WORK_DIR}/golden for this run. Run the golden_update target and "
+        "commit them to check the scenes against known good images")
+    set(golden_args --golden-dir "${WORK_DIR}/golden")
+    execute_process(COMMAND "${GOLDEN_BENCH}" --update ${golden_args}
+        OUTPUT_QUIET
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        list(APPEND failed "making golden images (${result})")
+    endif()
+endif()
+
+foreach(bench ${BENCHES})
+    set(args)
+    if(bench STREQUAL GOLDEN_BENCH)
+        set(args ${golden_args})
+    endif()
+    execute_process(COMMAND "${bench}" ${args}
+        OUTPUT_VARIABLE output
+        RESULT_VARIABLE result)
+    file(APPEND "${OUTPUT}" "${output}")
+    if(NOT result EQUAL 0)
+        list(APPEND failed "${bench} (${result})")
+    endif()
+endforeach()
+
+# Record a run of each lesson, replay it with every frame hashed as the
+# reference, then replay that and fail if any frame is drawn differently.
+# Only the last replay's results go into OUTPUT
+foreach(lesson ${REPLAYS})
+    get_filename_component(name "${lesson}" NAME_WE)
+    set(recorded "${WORK_DIR}/${name}_recorded.replay")
+    set(reference "${WORK_DIR}/${name}_reference.replay")
+    execute_process(COMMAND "${lesson}" --offscreen --frames 120 --record "${recorded}"
+        OUTPUT_QUIET
+        RESULT_VARIABLE result)
+    if(result EQUAL 0)
+        execute_process(COMMAND "${lesson}" --offscreen --replay "${recorded}" --record "${reference}"
+            OUTPUT_QUIET
+            RESULT_VARIABLE result)
+    endif()
+    if(result EQUAL 0)
+        execute_process(COMMAND "${lesson}" --offscreen --replay "${reference}"
+            OUTPUT_VARIABLE output
+            RESULT_VARIABLE result)
+        # Keep the result lines, not what else the lesson prints
+        string(REGEX MATCHALL "[^\n]* iterations=[^\n]*\n" lines "${output}")
+        string(CONCAT lines ${lines})
+        file(APPEND "${OUTPUT}" "${lines}")
+    endif()
+    if(NOT result EQUAL 0)
+        list(APPEND failed "${name} replay (${result})")
+    endif()
+endforeach()
+
+if(PROFDATA)
+    file(GLOB raw_profiles "${PGO_DIR}/*.profraw")
+    execute_process(COMMAND "${PROFDATA}" merge -output=${PGO_DIR}/default.profdata ${raw_profiles}
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        list(APPEND failed "merging profiles (${result})")
+    endif()
+endif()
+
+file(READ "${OUTPUT}" results)
+message("${results}")
+
+if(failed)
+    string(REPLACE ";" "\n  " failed "${failed}")
+    message(FATAL_ERROR "Failed:\n  ${failed}")
+endif()
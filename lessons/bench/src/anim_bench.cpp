@@ -0,0 +1,100 @@
+#include <iostream>
+#include <string>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "animation.h"
+#include "sprite_batch.h"
+#include "bench.h"
+
+const int NUM_SPRITES = 50000;
+const int NUM_FRAMES = 10;
+const int NUM_UPDATES = 1000;
+const float UPDATE_STEP = 1.0f / 60.0f;
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG )
+    {
+        std::cout << "IMG_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    const std::string resource_path = get_resource_path("lesson5");
+    AnimationLibrary library;
+    SDL_Texture *sheet = nullptr;
+    if (library.load(resource_path + "image.anim"))
+    {
+        sheet = IMG_LoadTexture(renderer, (resource_path + "image.png").c_str());
+        if (sheet == nullptr)
+        {
+            std::cout << "LoadTexture" << SDL_GetError() << std::endl;
+        }
+    }
+    const int cycle = library.findClip("cycle");
+    if (sheet == nullptr || cycle < 0)
+    {
+        cleanup(sheet, renderer, window);
+        IMG_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Fixed pseudo random positions and speeds so every run does the
+    // same work, with the instances spread out over the cycle
+    const SDL_Rect &frame = library.frame(0);
+    AnimationSystem anims(library);
+    Uint32 seed = 12345;
+    for (int i = 0; i < NUM_SPRITES; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        float x = float(seed % (BENCH_SCREEN_WIDTH - frame.w));
+        seed = seed * 1664525u + 1013904223u;
+        float y = float(seed % (BENCH_SCREEN_HEIGHT - frame.h));
+        seed = seed * 1664525u + 1013904223u;
+        int id = anims.add(cycle, x, y);
+        anims.setSpeed(id, 0.5f + (seed % 100) / 100.0f);
+    }
+
+    // Update alone, this is the structure of arrays pass
+    BenchTimer timer;
+    for (int i = 0; i < NUM_UPDATES; ++i)
+    {
+        anims.update(UPDATE_STEP);
+    }
+    reportResult(std::cout, "anim_update", long(NUM_SPRITES) * NUM_UPDATES,
+        timer.seconds(), "sprites");
+
+    // Update and draw every frame, the way a game would, with the
+    // frames fed into a sprite batch
+    SpriteBatch batch(renderer, NUM_SPRITES);
+    timer.restart();
+    for (int i = 0; i < NUM_FRAMES; ++i)
+    {
+        anims.update(UPDATE_STEP);
+        SDL_RenderClear(renderer);
+        anims.draw([&](int x, int y, SDL_Rect clip)
+        {
+            batch.draw(sheet, clip, x, y);
+        });
+        batch.flush();
+        SDL_RenderPresent(renderer);
+    }
+    reportResult(std::cout, "anim_update_draw", long(NUM_SPRITES) * NUM_FRAMES,
+        timer.seconds(), "sprites");
+
+    cleanup(sheet, renderer, window);
+    IMG_Quit();
+    SDL_Quit();
+    return 0;
+}
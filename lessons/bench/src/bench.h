@@ -0,0 +1,88 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <iostream>
+#include <string>
+#include <SDL2/SDL.h>
+
+const int BENCH_SCREEN_WIDTH = 640;
+const int BENCH_SCREEN_HEIGHT = 480;
+
+// Start SDL with the dummy video driver and a software renderer so
+// benchmarks can run on machines without a display or a GPU
+// @param window Filled with the hidden window that was created
+// @param renderer Filled with the software renderer for the window
+// @return true if everything was created, false otherwise (nothing
+//         needs to be cleaned up on failure)
+bool initHeadless(SDL_Window **window, SDL_Renderer **renderer)
+{
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    {
+        std::cout << "SDL_Init" << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    *window = SDL_CreateWindow("Benchmark", 0, 0,
+        BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+    if (*window == nullptr)
+    {
+        std::cout << "SDL_CreateWindow" << SDL_GetError() << std::endl;
+        SDL_Quit();
+        return false;
+    }
+
+    *renderer = SDL_CreateRenderer(*window, -1, SDL_RENDERER_SOFTWARE);
+    if (*renderer == nullptr)
+    {
+        std::cout << "SDL_CreateRenderer" << SDL_GetError() << std::endl;
+        SDL_DestroyWindow(*window);
+        SDL_Quit();
+        return false;
+    }
+
+    return true;
+}
+
+// Wall clock timer based on the high resolution performance counter
+class BenchTimer
+{
+public:
+    BenchTimer()
+        : start(SDL_GetPerformanceCounter())
+    {
+    }
+
+    void restart()
+    {
+        start = SDL_GetPerformanceCounter();
+    }
+
+    double seconds() const
+    {
+        return double(SDL_GetPerformanceCounter() - start) /
+            double(SDL_GetPerformanceFrequency());
+    }
+
+private:
+    Uint64 start;
+};
+
+// Write one result line in the form
+// "name iterations=N seconds=S rate=R unit/s"
+// @param os The output stream to write the result to
+// @param name Name of the benchmark case
+// @param iterations How many units of work were timed
+// @param seconds How long the work took
+// @param unit What one unit of work is, eg. "strings"
+void reportResult(std::ostream &os, const std::string &name, long iterations,
+    double seconds, const std::string &unit)
+{
+    double rate = seconds > 0.0 ? iterations / seconds : 0.0;
+    os << name
+       << " iterations=" << iterations
+       << " seconds=" << seconds
+       << " rate=" << rate << " " << unit << "/s" << std::endl;
+}
+
+#endif
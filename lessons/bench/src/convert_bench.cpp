@@ -0,0 +1,140 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "cleanup.h"
+#include "pixel_convert.h"
+#include "bench.h"
+
+const int IMAGE_SIZE = 1024;
+const int NUM_PASSES = 50;
+
+// Megabytes written by one pass over the image
+const int PASS_MEGABYTES = IMAGE_SIZE * IMAGE_SIZE * 4 / (1024 * 1024);
+
+// Format name without the SDL_PIXELFORMAT_ prefix
+std::string formatName(Uint32 format)
+{
+    const std::string name = SDL_GetPixelFormatName(format);
+    const std::string prefix = "SDL_PIXELFORMAT_";
+    return name.compare(0, prefix.size(), prefix) == 0 ? name.substr(prefix.size()) : name;
+}
+
+// Surface filled with fixed pseudo random pixels, the same every run
+SDL_Surface* makeSurface(Uint32 format)
+{
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, IMAGE_SIZE, IMAGE_SIZE,
+        SDL_BITSPERPIXEL(format), format);
+    if (surface == nullptr)
+    {
+        std::cerr << "SDL_CreateRGBSurfaceWithFormat" << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    Uint32 seed = 12345;
+    for (int y = 0; y < surface->h; ++y)
+    {
+        Uint8 *row = (Uint8*)surface->pixels + y * surface->pitch;
+        for (int x = 0; x < surface->w * int(SDL_BYTESPERPIXEL(format)); ++x)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            row[x] = Uint8(seed >> 24);
+        }
+    }
+    return surface;
+}
+
+// Time every kernel level on one format pair with the given flags.
+// Before timing, each level's output is checked byte for byte against
+// the scalar kernels
+// @return false if a conversion failed or a level's output differs
+bool benchKernels(const std::string &name, SDL_Surface *src, Uint32 dstFormat, int flags,
+    std::vector<Uint32> &pixels, std::vector<Uint32> &reference)
+{
+    const PixelKernelLevel best = detectPixelKernelLevel();
+    bool ok = true;
+    for (int level = PIXEL_KERNELS_SCALAR; level <= best && ok; ++level)
+    {
+        const std::string case_name = name + "_" + pixelKernelName(PixelKernelLevel(level));
+        setPixelKernelLevel(PixelKernelLevel(level));
+        std::vector<Uint32> &out = level == PIXEL_KERNELS_SCALAR ? reference : pixels;
+        if (!convertPixels(src, dstFormat, out.data(), IMAGE_SIZE * 4, flags))
+        {
+            std::cerr << case_name << ": convertPixels failed" << std::endl;
+            ok = false;
+            break;
+        }
+        if (std::memcmp(out.data(), reference.data(), reference.size() * sizeof(Uint32)) != 0)
+        {
+            std::cerr << case_name << ": output differs from the scalar kernels" << std::endl;
+            ok = false;
+            break;
+        }
+
+        BenchTimer timer;
+        for (int pass = 0; pass < NUM_PASSES; ++pass)
+        {
+            convertPixels(src, dstFormat, pixels.data(), IMAGE_SIZE * 4, flags);
+        }
+        reportResult(std::cout, case_name, long(NUM_PASSES) * PASS_MEGABYTES,
+            timer.seconds(), "MB");
+    }
+    setPixelKernelLevel(best);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (SDL_Init(0) != 0)
+    {
+        std::cerr << "SDL_Init" << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    const Uint32 sources[] = {
+        SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_BGR24, SDL_PIXELFORMAT_ARGB8888,
+        SDL_PIXELFORMAT_ABGR8888, SDL_PIXELFORMAT_RGBA8888, SDL_PIXELFORMAT_RGB888
+    };
+    const Uint32 targets[] = { SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888 };
+    std::vector<Uint32> pixels(IMAGE_SIZE * IMAGE_SIZE);
+    std::vector<Uint32> reference(IMAGE_SIZE * IMAGE_SIZE);
+    bool ok = true;
+
+    for (size_t s = 0; s < sizeof(sources) / sizeof(sources[0]); ++s)
+    {
+        SDL_Surface *src = makeSurface(sources[s]);
+        if (src == nullptr)
+        {
+            SDL_Quit();
+            return 1;
+        }
+
+        for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); ++t)
+        {
+            const std::string pair = formatName(sources[s]) + "_" + formatName(targets[t]);
+
+            // What SDL_CreateTextureFromSurface would do to convert
+            BenchTimer timer;
+            for (int pass = 0; pass < NUM_PASSES; ++pass)
+            {
+                cleanup(SDL_ConvertSurfaceFormat(src, targets[t], 0));
+            }
+            reportResult(std::cout, "convert_" + pair + "_sdl",
+                long(NUM_PASSES) * PASS_MEGABYTES, timer.seconds(), "MB");
+
+            ok = benchKernels("convert_" + pair, src, targets[t], 0,
+                pixels, reference) && ok;
+            ok = benchKernels("premultiply_" + pair, src, targets[t],
+                PIXEL_CONVERT_PREMULTIPLY, pixels, reference) && ok;
+
+            SDL_SetColorKey(src, SDL_TRUE, SDL_MapRGB(src->format, 0x80, 0x40, 0x20));
+            ok = benchKernels("colorkey_" + pair, src, targets[t], PIXEL_CONVERT_COLORKEY,
+                pixels, reference) && ok;
+            SDL_SetColorKey(src, SDL_FALSE, 0);
+        }
+        cleanup(src);
+    }
+
+    SDL_Quit();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,513 @@
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "texture.h"
+#include "tile_layer.h"
+#include "sprite_batch.h"
+#include "glyph_atlas.h"
+#include "pixel_convert.h"
+#include "tile_raster.h"
+#include "offscreen.h"
+#include "golden.h"
+#include "bench.h"
+
+#ifdef _WIN32
+    #include <direct.h>
+#else
+    #include <sys/stat.h>
+#endif
+
+const int TILE_SIZE = 40;
+const int CLIP_SIZE = 100;
+const int FONT_SIZE = 64;
+const std::string MESSAGE = "TTF fonts are cool!";
+
+// Renders each lesson's scene into memory and checks it against the
+// golden image in res/golden. Scenes with a faster way to draw them (tile
+// layers, sprite batching, the tiled rasterizer, fast texture creation)
+// are drawn both ways and both are checked against the same golden image.
+// A scene with no golden image fails the check, as does one that could
+// not be drawn because an asset did not load.
+//
+// Run with --update to write the golden images, the first time or after
+// an intended change in how a scene looks, then commit them. Nothing is
+// written without it. Details of every failure go to stderr, stdout only
+// has the result lines.
+class GoldenChecker
+{
+public:
+    GoldenChecker(const std::string &dir, bool update)
+        : dir(dir), update(update), checks(0), failures(0)
+    {
+    }
+
+    // Check the frame just drawn on the target
+    // @param target The target the frame was drawn on, after endFrame
+    // @param reference Name of the golden image to compare against
+    // @param variant Name of the way the frame was drawn
+    void check(OffscreenTarget &target, const std::string &reference,
+        const std::string &variant)
+    {
+        ++checks;
+        OffscreenFrame frame;
+        if (!target.acquireFrame(frame, 0))
+        {
+            std::cerr << "golden_" << variant << ": no frame" << std::endl;
+            ++failures;
+            return;
+        }
+        GoldenImage image;
+        makeGoldenImage(frame.pixels, frame.pitch, frame.width, frame.height, image);
+        target.releaseFrame(frame);
+
+        const std::string file = dir + reference + ".golden";
+        GoldenImage golden;
+        if (update && written.count(reference) == 0)
+        {
+            if (!saveGoldenImage(file, image))
+            {
+                ++failures;
+                return;
+            }
+            written[reference] = image;
+            std::cerr << "golden_" << variant << ": wrote " << file << std::endl;
+            return;
+        }
+        if (update)
+        {
+            golden = written[reference];
+        }
+        else if (!loadGoldenImage(file, golden))
+        {
+            std::cerr << "golden_" << variant << ": no golden image " << file
+                      << ", run with --update to make it" << std::endl;
+            ++failures;
+            return;
+        }
+
+        const GoldenResult result = compareGoldenImage(golden, image);
+        if (!result.passed)
+        {
+            std::cerr << "golden_" << variant << ": differs from " << reference
+                      << " hash_distance=" << result.hash_distance
+                      << " max_diff=" << result.max_channel_diff
+                      << " mean_diff=" << result.mean_diff << std::endl;
+            ++failures;
+        }
+    }
+
+    // Count a check that could not be made, eg. because an asset did
+    // not load, as failed
+    // @param variant Name of the way the frame would have been drawn
+    // @param reason What went wrong
+    void fail(const std::string &variant, const std::string &reason)
+    {
+        ++checks;
+        ++failures;
+        std::cerr << "golden_" << variant << ": " << reason << std::endl;
+    }
+
+    int getChecks() const
+    {
+        return checks;
+    }
+
+    int getFailures() const
+    {
+        return failures;
+    }
+
+private:
+    std::string dir;
+    bool update;
+    int checks;
+    int failures;
+
+    // Golden images made during this run, so the other variants of a
+    // scene are checked against them instead of creating them again
+    std::map<std::string, GoldenImage> written;
+};
+
+// Load an image as a surface, bitmaps through SDL and the rest through
+// SDL_image, the way the lessons do
+SDL_Surface* loadSurface(const std::string &lesson, const std::string &file)
+{
+    const std::string path = get_resource_path(lesson) + file;
+    SDL_Surface *surface = file.rfind(".bmp") == file.size() - 4 ?
+        SDL_LoadBMP(path.c_str()) : IMG_Load(path.c_str());
+    if (surface == nullptr)
+    {
+        std::cerr << "Could not load " << path << " " << SDL_GetError() << std::endl;
+    }
+    return surface;
+}
+
+// lesson1: the bitmap stretched over the whole window
+void checkLesson1(OffscreenTarget &target, GoldenChecker &checker)
+{
+    SDL_Renderer *ren = target.getRenderer();
+    SDL_Surface *surface = loadSurface("lesson1", "hello.bmp");
+    if (surface == nullptr)
+    {
+        checker.fail("lesson1", "hello.bmp did not load");
+        return;
+    }
+    SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, surface);
+
+    target.beginFrame();
+    SDL_RenderClear(ren);
+    SDL_RenderCopy(ren, tex, nullptr, nullptr);
+    target.endFrame();
+    checker.check(target, "lesson1", "lesson1");
+
+    cleanup(tex, surface);
+}
+
+// lesson2: the background repeated at its own size and the image centered,
+// uploaded with SDL_CreateTextureFromSurface and with the fast converter
+void checkLesson2(OffscreenTarget &target, GoldenChecker &checker)
+{
+    SDL_Renderer *ren = target.getRenderer();
+    SDL_Surface *background = loadSurface("lesson2", "background.bmp");
+    SDL_Surface *image = loadSurface("lesson2", "image.bmp");
+    if (background == nullptr || image == nullptr)
+    {
+        checker.fail("lesson2", "images did not load");
+        checker.fail("lesson2_fast_convert", "images did not load");
+        cleanup(background, image);
+        return;
+    }
+
+    for (int fast = 0; fast < 2; ++fast)
+    {
+        SDL_Texture *bg_tex = fast ? createTextureFromSurfaceFast(ren, background) :
+            SDL_CreateTextureFromSurface(ren, background);
+        SDL_Texture *img_tex = fast ? createTextureFromSurfaceFast(ren, image) :
+            SDL_CreateTextureFromSurface(ren, image);
+
+        target.beginFrame();
+        SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+        SDL_RenderClear(ren);
+        for (int x = 0; x < BENCH_SCREEN_WIDTH; x += background->w)
+        {
+            for (int y = 0; y < BENCH_SCREEN_HEIGHT; y += background->h)
+            {
+                SDL_Rect dst = {x, y, background->w, background->h};
+                SDL_RenderCopy(ren, bg_tex, nullptr, &dst);
+            }
+        }
+        SDL_Rect dst = {BENCH_SCREEN_WIDTH / 2 - image->w / 2,
+            BENCH_SCREEN_HEIGHT / 2 - image->h / 2, image->w, image->h};
+        SDL_RenderCopy(ren, img_tex, nullptr, &dst);
+        target.endFrame();
+        checker.check(target, "lesson2", fast ? "lesson2_fast_convert" : "lesson2");
+
+        cleanup(bg_tex, img_tex);
+    }
+    cleanup(background, image);
+}
+
+// lesson3: the background scaled into 40x40 tiles with the image centered
+// on top, drawn tile by tile, through a TileLayer and with the tiled
+// rasterizer
+void checkLesson3(OffscreenTarget &target, GoldenChecker &checker)
+{
+    SDL_Renderer *ren = target.getRenderer();
+    SDL_Surface *background = loadSurface("lesson3", "background.png");
+    SDL_Surface *image = loadSurface("lesson3", "image.png");
+    if (background == nullptr || image == nullptr)
+    {
+        checker.fail("lesson3", "images did not load");
+        checker.fail("lesson3_tile_layer", "images did not load");
+        checker.fail("lesson3_raster", "images did not load");
+        cleanup(background, image);
+        return;
+    }
+    Texture bg_tex = makeTexture(SDL_CreateTextureFromSurface(ren, background));
+    Texture img_tex = makeTexture(SDL_CreateTextureFromSurface(ren, image));
+    SDL_Rect img_dst = {BENCH_SCREEN_WIDTH / 2 - image->w / 2,
+        BENCH_SCREEN_HEIGHT / 2 - image->h / 2, image->w, image->h};
+
+    target.beginFrame();
+    SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+    SDL_RenderClear(ren);
+    for (int y = 0; y < BENCH_SCREEN_HEIGHT; y += TILE_SIZE)
+    {
+        for (int x = 0; x < BENCH_SCREEN_WIDTH; x += TILE_SIZE)
+        {
+            SDL_Rect dst = {x, y, TILE_SIZE, TILE_SIZE};
+            SDL_RenderCopy(ren, bg_tex.texture, nullptr, &dst);
+        }
+    }
+    SDL_RenderCopy(ren, img_tex.texture, nullptr, &img_dst);
+    target.endFrame();
+    checker.check(target, "lesson3", "lesson3");
+
+    {
+        std::vector<SDL_Rect> clips(1);
+        clips[0].x = 0;
+        clips[0].y = 0;
+        clips[0].w = bg_tex.width;
+        clips[0].h = bg_tex.height;
+        TileLayer layer(ren, bg_tex, clips, BENCH_SCREEN_WIDTH / TILE_SIZE,
+            BENCH_SCREEN_HEIGHT / TILE_SIZE, TILE_SIZE);
+        layer.fill(0);
+        SDL_Rect view = {0, 0, BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT};
+
+        // The layer bakes its chunks on the first draw, check a later
+        // frame drawn from the baked chunks
+        for (int i = 0; i < 2; ++i)
+        {
+            target.beginFrame();
+            SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+            SDL_RenderClear(ren);
+            layer.draw(view);
+            SDL_RenderCopy(ren, img_tex.texture, nullptr, &img_dst);
+            target.endFrame();
+            if (i == 0)
+            {
+                OffscreenFrame frame;
+                if (target.acquireFrame(frame, 0))
+                {
+                    target.releaseFrame(frame);
+                }
+            }
+        }
+        checker.check(target, "lesson3", "lesson3_tile_layer");
+    }
+
+    RasterImage bg_raster;
+    RasterImage img_raster;
+    if (makeRasterImage(background, bg_raster) && makeRasterImage(image, img_raster))
+    {
+        TiledRasterizer raster(BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT);
+        raster.setTarget(target.beginFrame(), BENCH_SCREEN_WIDTH * 4);
+        raster.setDrawColor(0, 0, 0, 255);
+        raster.clear();
+        for (int y = 0; y < BENCH_SCREEN_HEIGHT; y += TILE_SIZE)
+        {
+            for (int x = 0; x < BENCH_SCREEN_WIDTH; x += TILE_SIZE)
+            {
+                SDL_Rect dst = {x, y, TILE_SIZE, TILE_SIZE};
+                raster.copy(bg_raster, nullptr, &dst);
+            }
+        }
+        raster.copy(img_raster, nullptr, &img_dst);
+        raster.flush();
+        target.endFrame();
+        checker.check(target, "lesson3", "lesson3_raster");
+    }
+    else
+    {
+        checker.fail("lesson3_raster", "images could not be converted for the rasterizer");
+    }
+
+    cleanup(bg_tex.texture, img_tex.texture, background, image);
+}
+
+// lesson4: the image centered
+void checkLesson4(OffscreenTarget &target, GoldenChecker &checker)
+{
+    SDL_Renderer *ren = target.getRenderer();
+    SDL_Surface *image = loadSurface("lesson4", "image.png");
+    if (image == nullptr)
+    {
+        checker.fail("lesson4", "image.png did not load");
+        return;
+    }
+    SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, image);
+
+    target.beginFrame();
+    SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+    SDL_RenderClear(ren);
+    SDL_Rect dst = {BENCH_SCREEN_WIDTH / 2 - image->w / 2,
+        BENCH_SCREEN_HEIGHT / 2 - image->h / 2, image->w, image->h};
+    SDL_RenderCopy(ren, tex, nullptr, &dst);
+    target.endFrame();
+    checker.check(target, "lesson4", "lesson4");
+
+    cleanup(tex, image);
+}
+
+// lesson5: each of the four sprite sheet clips in its own quarter of the
+// screen, drawn one SDL_RenderCopy at a time and through a SpriteBatch
+void checkLesson5(OffscreenTarget &target, GoldenChecker &checker)
+{
+    SDL_Renderer *ren = target.getRenderer();
+    SDL_Surface *sheet = loadSurface("lesson5", "image.png");
+    if (sheet == nullptr)
+    {
+        checker.fail("lesson5", "image.png did not load");
+        checker.fail("lesson5_sprite_batch", "image.png did not load");
+        return;
+    }
+    SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, sheet);
+    SpriteBatch batch(ren);
+
+    for (int batched = 0; batched < 2; ++batched)
+    {
+        target.beginFrame();
+        SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+        SDL_RenderClear(ren);
+        for (int i = 0; i < 4; ++i)
+        {
+            SDL_Rect clip = {(i % 2) * CLIP_SIZE, (i / 2) * CLIP_SIZE, CLIP_SIZE, CLIP_SIZE};
+            SDL_Rect dst = {(i % 2) * BENCH_SCREEN_WIDTH / 2 + BENCH_SCREEN_WIDTH / 4 - CLIP_SIZE / 2,
+                (i / 2) * BENCH_SCREEN_HEIGHT / 2 + BENCH_SCREEN_HEIGHT / 4 - CLIP_SIZE / 2,
+                CLIP_SIZE, CLIP_SIZE};
+            if (batched)
+            {
+                batch.draw(tex, &clip, dst);
+            }
+            else
+            {
+                SDL_RenderCopy(ren, tex, &clip, &dst);
+            }
+        }
+        if (batched)
+        {
+            batch.flush();
+        }
+        target.endFrame();
+        checker.check(target, "lesson5", batched ? "lesson5_sprite_batch" : "lesson5");
+    }
+
+    cleanup(tex, sheet);
+}
+
+// lesson6: the line of text centered, rendered whole with SDL_ttf, and
+// glyph by glyph from a GlyphAtlas. The atlas has its own golden image,
+// it places glyphs itself so the two are not expected to match exactly
+void checkLesson6(OffscreenTarget &target, GoldenChecker &checker)
+{
+    SDL_Renderer *ren = target.getRenderer();
+    const std::string font_file = get_resource_path("lesson6") + "sample.ttf";
+    const SDL_Color color = {255, 255, 255, 255};
+
+    TTF_Font *font = TTF_OpenFont(font_file.c_str(), FONT_SIZE);
+    if (font == nullptr)
+    {
+        checker.fail("lesson6", std::string("TTF_OpenFont ") + SDL_GetError());
+        checker.fail("lesson6_atlas", "sample.ttf did not load");
+        return;
+    }
+    SDL_Surface *surface = TTF_RenderText_Blended(font, MESSAGE.c_str(), color);
+    TTF_CloseFont(font);
+    if (surface == nullptr)
+    {
+        checker.fail("lesson6", std::string("TTF_RenderText ") + SDL_GetError());
+        return;
+    }
+    SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, surface);
+
+    target.beginFrame();
+    SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+    SDL_RenderClear(ren);
+    SDL_Rect dst = {BENCH_SCREEN_WIDTH / 2 - surface->w / 2,
+        BENCH_SCREEN_HEIGHT / 2 - surface->h / 2, surface->w, surface->h};
+    SDL_RenderCopy(ren, tex, nullptr, &dst);
+    target.endFrame();
+    checker.check(target, "lesson6", "lesson6");
+    cleanup(tex, surface);
+
+    TextEngine text_engine(ren);
+    int w = 0;
+    int h = 0;
+    if (text_engine.sizeText(MESSAGE, font_file, FONT_SIZE, &w, &h))
+    {
+        target.beginFrame();
+        SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+        SDL_RenderClear(ren);
+        text_engine.drawText(MESSAGE, font_file, color, FONT_SIZE,
+            BENCH_SCREEN_WIDTH / 2 - w / 2, BENCH_SCREEN_HEIGHT / 2 - h / 2);
+        target.endFrame();
+        checker.check(target, "lesson6_atlas", "lesson6_atlas");
+    }
+    else
+    {
+        checker.fail("lesson6_atlas", "the text could not be measured");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // --golden-dir DIR reads and writes the golden images somewhere other
+    // than res/golden, golden_update points it at the source tree
+    bool update = false;
+    std::string golden_dir = get_resource_path("golden");
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--update") == 0)
+        {
+            update = true;
+        }
+        if (std::strcmp(argv[i], "--golden-dir") == 0 && i + 1 < argc)
+        {
+            golden_dir = argv[i + 1];
+            const char last = golden_dir.empty() ? '/' : golden_dir.back();
+            if (last != '/' && last != '\\')
+            {
+                golden_dir += '/';
+            }
+        }
+    }
+
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG || TTF_Init() != 0 )
+    {
+        std::cerr << "IMG_Init/TTF_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    if (update)
+    {
+#ifdef _WIN32
+        _mkdir(golden_dir.c_str());
+#else
+        mkdir(golden_dir.c_str(), 0755);
+#endif
+    }
+
+    GoldenChecker checker(golden_dir, update);
+    BenchTimer timer;
+    {
+        // Two buffers, every frame is checked as soon as it is drawn
+        OffscreenTarget target(BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT, 2);
+        if (!target.good())
+        {
+            cleanup(renderer, window);
+            SDL_Quit();
+            return 1;
+        }
+        checkLesson1(target, checker);
+        checkLesson2(target, checker);
+        checkLesson3(target, checker);
+        checkLesson4(target, checker);
+        checkLesson5(target, checker);
+        checkLesson6(target, checker);
+    }
+    const double seconds = timer.seconds();
+    const int failures = checker.getFailures();
+    reportResult(std::cout, "golden_checks", checker.getChecks(), seconds, "checks");
+    reportResult(std::cout, "golden_failures", failures, seconds, "checks");
+
+    cleanup(renderer, window);
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <string>
+#include <SDL2/SDL.h>
+#include "cleanup.h"
+#include "game_loop.h"
+#include "input.h"
+#include "bench.h"
+
+const int NUM_EVENTS = 100000;
+const int EVENTS_PER_FRAME = 500;
+const int LATENCY_FRAMES = 1000;
+
+// Queue key presses and releases of the keys 1 to 5, alternating
+// @param count How many events to push
+void pushKeys(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = (i & 1) == 0 ? SDL_KEYDOWN : SDL_KEYUP;
+        event.key.keysym.sym = SDLK_1 + (i / 2) % 5;
+        SDL_PushEvent(&event);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    InputSystem input;
+    int actions[5];
+    for (int i = 0; i < 5; ++i)
+    {
+        actions[i] = input.defineAction("clip" + std::to_string(i + 1));
+        input.bindKey(SDLK_1 + i, actions[i]);
+    }
+
+    bool failed = false;
+
+    // Baseline: one SDL_PollEvent call per event, with a switch on the key
+    // the way the lessons used to read input
+    {
+        long handled = 0;
+        double seconds = 0.0;
+        for (int done = 0; done < NUM_EVENTS; done += EVENTS_PER_FRAME)
+        {
+            pushKeys(EVENTS_PER_FRAME);
+            BenchTimer timer;
+            SDL_Event event;
+            while (SDL_PollEvent(&event))
+            {
+                if (event.type == SDL_KEYDOWN)
+                {
+                    switch (event.key.keysym.sym)
+                    {
+                        case SDLK_1: case SDLK_2: case SDLK_3: case SDLK_4: case SDLK_5:
+                            ++handled;
+                            break;
+                        default:
+                            break;
+                    }
+                }
+            }
+            seconds += timer.seconds();
+        }
+        reportResult(std::cout, "input_poll_event", NUM_EVENTS, seconds, "events");
+        if (handled != NUM_EVENTS / 2)
+        {
+            std::cerr << "input_poll_event: handled " << handled << " presses, expected "
+                      << NUM_EVENTS / 2 << std::endl;
+            failed = true;
+        }
+    }
+
+    // Batched: drained with SDL_PeepEvents and mapped to actions
+    {
+        long presses = 0;
+        double seconds = 0.0;
+        for (int done = 0; done < NUM_EVENTS; done += EVENTS_PER_FRAME)
+        {
+            pushKeys(EVENTS_PER_FRAME);
+            BenchTimer timer;
+            input.beginFrame();
+            input.pump([](const SDL_Event&) {});
+            for (int i = 0; i < 5; ++i)
+            {
+                presses += input.state(actions[i]).presses;
+            }
+            input.endFrame();
+            seconds += timer.seconds();
+        }
+        reportResult(std::cout, "input_peep_actions", NUM_EVENTS, seconds, "events");
+        if (presses != NUM_EVENTS / 2)
+        {
+            std::cerr << "input_peep_actions: counted " << presses << " presses, expected "
+                      << NUM_EVENTS / 2 << std::endl;
+            failed = true;
+        }
+    }
+
+    // Latency: a key is pressed and released during each frame's render,
+    // and measured when the next frame has consumed it
+    {
+        input.resetLatency();
+        GameLoopConfig config;
+        config.headless_frames = LATENCY_FRAMES;
+        GameLoop loop(config);
+        loop.setInput(&input);
+        loop.onRender([&](double)
+        {
+            SDL_RenderClear(renderer);
+            SDL_RenderPresent(renderer);
+            pushKeys(2);
+        });
+        BenchTimer timer;
+        loop.run();
+        const double seconds = timer.seconds();
+
+        // Latencies as iterations, in the unit of the case name. SDL event
+        // timestamps are whole milliseconds, so the mean is rounded to one
+        reportResult(std::cout, "input_latency", loop.getFrames(), seconds, "frames");
+        reportResult(std::cout, "input_latency_samples", input.getLatencySamples(), seconds,
+            "samples");
+        reportResult(std::cout, "input_latency_mean_ms", long(input.getMeanLatency() + 0.5),
+            seconds, "ms");
+        reportResult(std::cout, "input_latency_p99_ms", long(input.getLatencyPercentile(0.99)),
+            seconds, "ms");
+        reportResult(std::cout, "input_latency_max_ms", long(input.getMaxLatency()), seconds,
+            "ms");
+    }
+
+    cleanup(renderer, window);
+    SDL_Quit();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "async_loader.h"
+#include "bench.h"
+
+// Copies of each image to load, the startup cost of a scene with
+// this many assets is what we are measuring
+const int NUM_COPIES = 200;
+
+// Loads an image into a texture on the rendering device, same as the
+// loadTexture the lessons use from render_helpers.h, without
+// wrapping the result
+SDL_Texture* loadTextureSync(const std::string &file, SDL_Renderer *ren)
+{
+    return IMG_LoadTexture(ren, file.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG )
+    {
+        std::cout << "IMG_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    for (int i = 0; i < NUM_COPIES; ++i)
+    {
+        files.push_back(get_resource_path("lesson4") + "image.png");
+        files.push_back(get_resource_path("lesson5") + "image.png");
+    }
+
+    // Serial: decode and upload one at a time on the main thread
+    std::vector<SDL_Texture*> textures;
+    BenchTimer timer;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        textures.push_back(loadTextureSync(files[i], renderer));
+    }
+    reportResult(std::cout, "startup_serial", long(files.size()), timer.seconds(), "images");
+
+    for (size_t i = 0; i < textures.size(); ++i)
+    {
+        cleanup(textures[i]);
+    }
+    textures.clear();
+
+    // Parallel: decode on the worker pool, upload in batches here.
+    // Starting the pool is part of the startup cost so it is timed too
+    timer.restart();
+    {
+        AsyncImageLoader loader(renderer);
+        std::vector<ImageLoadHandle> handles;
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            handles.push_back(loader.load(files[i]));
+        }
+        loader.finishAll();
+
+        for (size_t i = 0; i < handles.size(); ++i)
+        {
+            textures.push_back(handles[i].take());
+        }
+    }
+    reportResult(std::cout, "startup_parallel", long(files.size()), timer.seconds(), "images");
+
+    for (size_t i = 0; i < textures.size(); ++i)
+    {
+        cleanup(textures[i]);
+    }
+
+    cleanup(renderer, window);
+    IMG_Quit();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "offscreen.h"
+#include "bench.h"
+
+const int FRAMES = 300;
+const int TILE_SIZE = 40;
+const int CLIP_SIZE = 100;
+const int SPRITES = 500;
+
+// The lesson3 tiled background with lesson5 sprites moving over it
+void drawScene(SDL_Renderer *ren, SDL_Texture *background, SDL_Texture *sheet, int frame)
+{
+    SDL_SetRenderDrawColor(ren, 0, 0, 0, 255);
+    SDL_RenderClear(ren);
+    for (int y = 0; y < BENCH_SCREEN_HEIGHT; y += TILE_SIZE)
+    {
+        for (int x = 0; x < BENCH_SCREEN_WIDTH; x += TILE_SIZE)
+        {
+            SDL_Rect dst = {x, y, TILE_SIZE, TILE_SIZE};
+            SDL_RenderCopy(ren, background, nullptr, &dst);
+        }
+    }
+    for (int i = 0; i < SPRITES; ++i)
+    {
+        SDL_Rect clip = {(i % 2) * CLIP_SIZE, ((i / 2) % 2) * CLIP_SIZE, CLIP_SIZE, CLIP_SIZE};
+        SDL_Rect dst = {(i * 97 + frame * 3) % (BENCH_SCREEN_WIDTH + CLIP_SIZE) - CLIP_SIZE,
+            (i * 61) % (BENCH_SCREEN_HEIGHT + CLIP_SIZE) - CLIP_SIZE, CLIP_SIZE, CLIP_SIZE};
+        SDL_RenderCopy(ren, sheet, &clip, &dst);
+    }
+}
+
+// Render FRAMES frames offscreen while a consumer thread hashes them
+// @param name Name of the benchmark case
+// @param buffers How many frame buffers to rotate through
+// @param dropWhenFull Reuse unread frames instead of waiting for the consumer
+// @param readDelayMs Extra time the consumer spends on each frame, to
+//        stand in for a slow encoder
+// @return the hash of the last frame the consumer read
+Uint32 runOffscreen(const std::string &name, SDL_Surface *background, SDL_Surface *sheet,
+    int buffers, bool dropWhenFull, Uint32 readDelayMs)
+{
+    OffscreenTarget target(BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT, buffers,
+        nullptr, 0, dropWhenFull);
+    if (!target.good())
+    {
+        return 0;
+    }
+    SDL_Renderer *ren = target.getRenderer();
+    SDL_Texture *background_tex = SDL_CreateTextureFromSurface(ren, background);
+    SDL_Texture *sheet_tex = SDL_CreateTextureFromSurface(ren, sheet);
+
+    Uint32 last_hash = 0;
+    long frames_read = 0;
+    double read_seconds = 0.0;
+    std::thread consumer([&]()
+    {
+        OffscreenFrame frame;
+        BenchTimer timer;
+        while (target.acquireFrame(frame))
+        {
+            last_hash = hashPixels(frame.pixels, frame.pitch, frame.width, frame.height);
+            if (readDelayMs > 0)
+            {
+                SDL_Delay(readDelayMs);
+            }
+            target.releaseFrame(frame);
+            ++frames_read;
+        }
+        read_seconds = timer.seconds();
+    });
+
+    BenchTimer timer;
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        target.beginFrame();
+        drawScene(ren, background_tex, sheet_tex, frame);
+        target.endFrame();
+    }
+    const double render_seconds = timer.seconds();
+    target.close();
+    consumer.join();
+
+    reportResult(std::cout, name, FRAMES, render_seconds, "frames");
+    reportResult(std::cout, name + "_consumer", frames_read, read_seconds, "frames");
+    reportResult(std::cout, name + "_dropped", target.getDropped(), render_seconds,
+        "frames");
+
+    cleanup(background_tex, sheet_tex);
+    return last_hash;
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    SDL_Surface *background = IMG_Load((get_resource_path("lesson3") + "background.png").c_str());
+    SDL_Surface *sheet = IMG_Load((get_resource_path("lesson5") + "image.png").c_str());
+    if (background == nullptr || sheet == nullptr)
+    {
+        std::cerr << "IMG_Load " << SDL_GetError() << std::endl;
+        cleanup(background, sheet, renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    // Baseline: draw to the window renderer and copy every frame out
+    // with SDL_RenderReadPixels, hashing on the same thread
+    Uint32 readback_hash = 0;
+    {
+        SDL_Texture *background_tex = SDL_CreateTextureFromSurface(renderer, background);
+        SDL_Texture *sheet_tex = SDL_CreateTextureFromSurface(renderer, sheet);
+        const int pitch = BENCH_SCREEN_WIDTH * 4;
+        std::vector<Uint32> pixels(BENCH_SCREEN_WIDTH * BENCH_SCREEN_HEIGHT);
+
+        BenchTimer timer;
+        for (int frame = 0; frame < FRAMES; ++frame)
+        {
+            drawScene(renderer, background_tex, sheet_tex, frame);
+            SDL_RenderReadPixels(renderer, nullptr, OFFSCREEN_PIXEL_FORMAT, pixels.data(), pitch);
+            readback_hash = hashPixels(pixels.data(), pitch, BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT);
+            SDL_RenderPresent(renderer);
+        }
+        reportResult(std::cout, "offscreen_read_pixels", FRAMES, timer.seconds(), "frames");
+        cleanup(background_tex, sheet_tex);
+    }
+
+    // Zero-copy: frames are hashed in place on a consumer thread while
+    // the next ones are drawn
+    const Uint32 double_hash = runOffscreen("offscreen_double", background, sheet, 2, false, 0);
+    const Uint32 triple_hash = runOffscreen("offscreen_triple", background, sheet, 3, false, 0);
+
+    // A consumer slower than the renderer: blocking holds the renderer
+    // back to its pace, dropping keeps rendering and skips frames
+    const Uint32 blocking_hash = runOffscreen("offscreen_slow_blocking", background, sheet,
+        3, false, 2);
+    runOffscreen("offscreen_slow_dropping", background, sheet, 3, true, 2);
+
+    // Every run that reads all frames must end on the frame the window
+    // renderer drew
+    const bool match = readback_hash == double_hash && readback_hash == triple_hash &&
+        readback_hash == blocking_hash;
+    if (!match)
+    {
+        std::cerr << "offscreen_hash: last frames differ, readback=" << std::hex
+                  << readback_hash << " double=" << double_hash << " triple=" << triple_hash
+                  << " slow_blocking=" << blocking_hash << std::dec << std::endl;
+    }
+
+    cleanup(background, sheet, renderer, window);
+    SDL_Quit();
+    return match ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "asset_pack.h"
+#include "atlas_packer.h"
+#include "bench.h"
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+const int NUM_WARM_RUNS = 20;
+const int FONT_SIZE = 32;
+const int ATLAS_PAGE_SIZE = 1024;
+const int ATLAS_PADDING = 1;
+const std::string PACK_FILE = "bench_assets.pack";
+
+// Ask the OS to drop a file from the page cache, so the next load has to
+// go to disk. Only done on Linux, elsewhere the cold run is just the
+// first one in the process.
+void dropFromCache(const std::string &file)
+{
+#ifdef __linux__
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+}
+
+bool hasExtension(const std::string &name, const std::string &ext)
+{
+    return name.size() >= ext.size() &&
+        name.compare(name.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+// Load one asset the way a lesson would and free it again
+// @param rw Where to read the asset from, always closed
+// @return false if the asset could not be loaded
+bool loadAsset(SDL_RWops *rw, const std::string &name, SDL_Renderer *ren)
+{
+    if (rw == nullptr)
+    {
+        return false;
+    }
+    if (hasExtension(name, ".png") || hasExtension(name, ".bmp"))
+    {
+        SDL_Texture *texture = IMG_LoadTexture_RW(ren, rw, 1);
+        cleanup(texture);
+        return texture != nullptr;
+    }
+    if (hasExtension(name, ".ttf"))
+    {
+        TTF_Font *font = TTF_OpenFontRW(rw, 1, FONT_SIZE);
+        if (font != nullptr)
+        {
+            TTF_CloseFont(font);
+        }
+        return font != nullptr;
+    }
+
+    // Anything else is read in full, eg. animation and atlas files
+    std::vector<char> bytes(size_t(SDL_RWsize(rw)));
+    size_t read = bytes.empty() ? 0 : SDL_RWread(rw, bytes.data(), bytes.size(), 1);
+    SDL_RWclose(rw);
+    return bytes.empty() || read == 1;
+}
+
+// Load every asset from loose files under the resource directory
+bool startLoose(const std::string &root, const std::vector<std::string> &names,
+    SDL_Renderer *ren)
+{
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        if (!loadAsset(SDL_RWFromFile((root + names[i]).c_str(), "rb"), names[i], ren))
+        {
+            std::cout << "Failed to load " << root + names[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Map the pack and load every asset from it, including opening the pack
+// as that is part of startup too
+bool startPacked(const std::vector<std::string> &names, SDL_Renderer *ren)
+{
+    AssetPack pack;
+    if (!pack.open(PACK_FILE))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        if (!loadAsset(pack.openRW(names[i]), names[i], ren))
+        {
+            std::cout << "Failed to load " << names[i] << " from the pack" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Pack images into an atlas at runtime with buildAtlas and upload it
+// @return false if an image failed to load or the upload failed
+bool startAtlas(const std::string &root, const std::vector<std::string> &images,
+    SDL_Renderer *ren, TextureAtlas &atlas)
+{
+    std::vector<std::string> files;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        files.push_back(root + images[i]);
+    }
+
+    AtlasLayout layout;
+    if (!buildAtlas(images, files, ATLAS_PAGE_SIZE, ATLAS_PADDING, layout))
+    {
+        std::cerr << "buildAtlas failed" << std::endl;
+        return false;
+    }
+    bool ok = atlas.upload(layout, ren);
+    freeAtlasLayout(layout);
+    if (!ok)
+    {
+        std::cerr << "TextureAtlas::upload failed" << std::endl;
+    }
+    return ok;
+}
+
+// Check every image can be found in the atlas with its own size, and that
+// no two images overlap on a page
+bool checkAtlas(const std::string &root, const std::vector<std::string> &images,
+    const TextureAtlas &atlas)
+{
+    bool ok = true;
+    std::vector<AtlasSprite> sprites(images.size());
+    for (size_t i = 0; i < images.size() && ok; ++i)
+    {
+        SDL_Surface *image = IMG_Load((root + images[i]).c_str());
+        if (image == nullptr || !atlas.find(images[i], &sprites[i]) ||
+            sprites[i].clip.w != image->w || sprites[i].clip.h != image->h)
+        {
+            std::cerr << "Atlas lookup of " << images[i] << " is wrong" << std::endl;
+            ok = false;
+        }
+        cleanup(image);
+        for (size_t j = 0; j < i && ok; ++j)
+        {
+            if (sprites[j].page.texture == sprites[i].page.texture &&
+                SDL_HasIntersection(&sprites[j].clip, &sprites[i].clip))
+            {
+                std::cerr << "Atlas packed " << images[j] << " over "
+                          << images[i] << std::endl;
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG || TTF_Init() != 0 )
+    {
+        std::cout << "IMG_Init/TTF_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        IMG_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Every lesson's assets, packed the same way SDL_AssetPack would
+    const std::string root = get_resource_path();
+    std::vector<std::string> all_names, names;
+    listAssetFiles(root, "", all_names);
+    for (size_t i = 0; i < all_names.size(); ++i)
+    {
+        if (!hasExtension(all_names[i], ".pack"))
+        {
+            names.push_back(all_names[i]);
+        }
+    }
+    bool ok = !names.empty() && writeAssetPack(root, names, PACK_FILE);
+
+    // Cold, with the files pushed out of the page cache first
+    BenchTimer timer;
+    if (ok)
+    {
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            dropFromCache(root + names[i]);
+        }
+        timer.restart();
+        ok = startLoose(root, names, renderer);
+        reportResult(std::cout, "startup_loose_cold", long(names.size()),
+            timer.seconds(), "assets");
+    }
+    if (ok)
+    {
+        dropFromCache(PACK_FILE);
+        timer.restart();
+        ok = startPacked(names, renderer);
+        reportResult(std::cout, "startup_pack_cold", long(names.size()),
+            timer.seconds(), "assets");
+    }
+
+    // Warm, everything already in the page cache
+    if (ok)
+    {
+        timer.restart();
+        for (int run = 0; ok && run < NUM_WARM_RUNS; ++run)
+        {
+            ok = startLoose(root, names, renderer);
+        }
+        reportResult(std::cout, "startup_loose_warm", long(names.size()) * NUM_WARM_RUNS,
+            timer.seconds(), "assets");
+    }
+    if (ok)
+    {
+        timer.restart();
+        for (int run = 0; ok && run < NUM_WARM_RUNS; ++run)
+        {
+            ok = startPacked(names, renderer);
+        }
+        reportResult(std::cout, "startup_pack_warm", long(names.size()) * NUM_WARM_RUNS,
+            timer.seconds(), "assets");
+    }
+
+    // Images packed into an atlas at runtime instead of loaded one by one
+    if (ok)
+    {
+        std::vector<std::string> images;
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            if (hasExtension(names[i], ".png") || hasExtension(names[i], ".bmp"))
+            {
+                images.push_back(names[i]);
+            }
+        }
+        TextureAtlas atlas;
+        timer.restart();
+        ok = !images.empty() && startAtlas(root, images, renderer, atlas);
+        reportResult(std::cout, "startup_atlas_runtime", long(images.size()),
+            timer.seconds(), "images");
+        ok = ok && checkAtlas(root, images, atlas);
+    }
+
+    std::remove(PACK_FILE.c_str());
+    cleanup(renderer, window);
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+    return ok ? 0 : 1;
+}
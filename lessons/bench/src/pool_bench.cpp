@@ -0,0 +1,114 @@
+#include <iostream>
+#include <string>
+#include <SDL2/SDL.h>
+#include "cleanup.h"
+#include "texture.h"
+#include "pixel_convert.h"
+#include "texture_pool.h"
+#include "bench.h"
+
+const int NUM_UPDATES = 10000;
+const int UPDATES_PER_FRAME = 100;
+const int TEXT_HEIGHT = 24;
+
+// Width of the n-th temporary image, varying like lines of text do
+int textWidth(int n)
+{
+    return 40 + (n * 37) % 360;
+}
+
+// Make a surface look like rendered text, so the upload has real work
+void fillSurface(SDL_Surface *surface, int n)
+{
+    SDL_FillRect(surface, nullptr, SDL_MapRGBA(surface->format, 255, 255, 255, Uint8(n)));
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    const Uint32 format = SDL_PIXELFORMAT_ARGB8888;
+
+    // Baseline: a new surface and texture for every update, both freed
+    // straight after drawing
+    {
+        const int allocations = SDL_GetNumAllocations();
+        BenchTimer timer;
+        for (int i = 0; i < NUM_UPDATES; ++i)
+        {
+            SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, textWidth(i), TEXT_HEIGHT,
+                32, format);
+            if (surface == nullptr)
+            {
+                std::cout << "SDL_CreateRGBSurfaceWithFormat" << SDL_GetError() << std::endl;
+                break;
+            }
+            fillSurface(surface, i);
+            Texture tex = makeTexture(createTextureFromSurfaceFast(renderer, surface));
+            SDL_Rect dst = {10, 10, tex.width, tex.height};
+            SDL_RenderCopy(renderer, tex.texture, nullptr, &dst);
+            cleanup(tex.texture, surface);
+
+            if (i % UPDATES_PER_FRAME == 0)
+            {
+                SDL_RenderPresent(renderer);
+            }
+        }
+        const double seconds = timer.seconds();
+        reportResult(std::cout, "pool_transient_unpooled", NUM_UPDATES, seconds, "updates");
+        reportResult(std::cout, "pool_transient_unpooled_sdl_allocations",
+            SDL_GetNumAllocations() - allocations, seconds, "allocations");
+    }
+
+    // The same work with the surface and texture taken from a pool and
+    // handed back to it
+    {
+        TexturePool pool(renderer);
+        const int allocations = SDL_GetNumAllocations();
+        BenchTimer timer;
+        for (int i = 0; i < NUM_UPDATES; ++i)
+        {
+            SDL_Surface *surface = pool.acquireSurface(textWidth(i), TEXT_HEIGHT, format);
+            if (surface == nullptr)
+            {
+                break;
+            }
+            fillSurface(surface, i);
+            Texture tex = createPooledTexture(pool, renderer, surface);
+            SDL_Rect clip = {0, 0, tex.width, tex.height};
+            SDL_Rect dst = {10, 10, tex.width, tex.height};
+            SDL_RenderCopy(renderer, tex.texture, &clip, &dst);
+            pool.release(tex.texture);
+            pool.release(surface);
+
+            if (i % UPDATES_PER_FRAME == 0)
+            {
+                SDL_RenderPresent(renderer);
+            }
+        }
+        const double seconds = timer.seconds();
+        reportResult(std::cout, "pool_transient_pooled", NUM_UPDATES, seconds, "updates");
+
+        // Counts as iterations, hit rate is hits / (hits + misses)
+        const TexturePoolStats &stats = pool.getStats();
+        reportResult(std::cout, "pool_transient_pooled_sdl_allocations",
+            SDL_GetNumAllocations() - allocations, seconds, "allocations");
+        reportResult(std::cout, "pool_transient_pooled_hits",
+            stats.surface_hits + stats.texture_hits, seconds, "hits");
+        reportResult(std::cout, "pool_transient_pooled_misses",
+            stats.surface_misses + stats.texture_misses, seconds, "misses");
+        reportResult(std::cout, "pool_transient_pooled_peak_resident_bytes",
+            long(stats.peak_resident_bytes), seconds, "bytes");
+        reportResult(std::cout, "pool_transient_pooled_destroyed", stats.destroyed, seconds,
+            "objects");
+    }
+
+    cleanup(renderer, window);
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,278 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "tile_raster.h"
+#include "bench.h"
+
+const int FRAMES = 200;
+const int TILE_SIZE = 40;
+const int CLIP_SIZE = 100;
+const int SPRITES = 2000;
+
+// Draws the lesson scenes through either backend. Backend wraps an
+// SDL_Renderer with SDL_Textures, or a TiledRasterizer with RasterImages.
+template<typename Backend, typename Image>
+void drawScene(Backend &backend, Image *images[5], int frame)
+{
+    Image &background_bmp = *images[0];
+    Image &image_bmp = *images[1];
+    Image &background_png = *images[2];
+    Image &sheet = *images[3];
+    Image &text = *images[4];
+
+    backend.setDrawColor(30, 30, 30, 255);
+    backend.clear();
+
+    // lesson3: background scaled down into 40x40 tiles
+    for (int y = 0; y < BENCH_SCREEN_HEIGHT; y += TILE_SIZE)
+    {
+        for (int x = 0; x < BENCH_SCREEN_WIDTH; x += TILE_SIZE)
+        {
+            SDL_Rect dst = {x, y, TILE_SIZE, TILE_SIZE};
+            backend.copy(background_png, nullptr, &dst);
+        }
+    }
+
+    // lesson2: bitmap background and image at their own size
+    SDL_Rect bmp_dst = {0, 0, backend.imageWidth(background_bmp), backend.imageHeight(background_bmp)};
+    backend.copy(background_bmp, nullptr, &bmp_dst);
+    SDL_Rect image_dst = {BENCH_SCREEN_WIDTH / 2 - backend.imageWidth(image_bmp) / 2,
+        BENCH_SCREEN_HEIGHT / 2 - backend.imageHeight(image_bmp) / 2,
+        backend.imageWidth(image_bmp), backend.imageHeight(image_bmp)};
+    backend.copy(image_bmp, nullptr, &image_dst);
+
+    // lesson5: clips of the sprite sheet, some faded, some scaled
+    for (int i = 0; i < SPRITES; ++i)
+    {
+        SDL_Rect clip = {(i % 2) * CLIP_SIZE, ((i / 2) % 2) * CLIP_SIZE, CLIP_SIZE, CLIP_SIZE};
+        SDL_Rect dst = {(i * 97 + frame * 3) % (BENCH_SCREEN_WIDTH + CLIP_SIZE) - CLIP_SIZE,
+            (i * 61) % (BENCH_SCREEN_HEIGHT + CLIP_SIZE) - CLIP_SIZE, CLIP_SIZE, CLIP_SIZE};
+        if (i % 7 == 0)
+        {
+            dst.w = CLIP_SIZE / 2;
+            dst.h = CLIP_SIZE / 2;
+        }
+        backend.setAlphaMod(sheet, i % 5 == 0 ? 128 : 255);
+        backend.copy(sheet, &clip, &dst);
+    }
+    backend.setAlphaMod(sheet, 255);
+
+    // lesson6: the whole line of text, then tinted glyph sized quads
+    SDL_Rect text_dst = {20, 20, backend.imageWidth(text), backend.imageHeight(text)};
+    backend.copy(text, nullptr, &text_dst);
+    backend.setColorMod(text, 255, 220, 0);
+    for (int x = 0; x + 16 <= backend.imageWidth(text); x += 16)
+    {
+        SDL_Rect quad = {x, 0, 16, backend.imageHeight(text)};
+        SDL_Rect dst = {20 + x, 400, 16, backend.imageHeight(text)};
+        backend.copy(text, &quad, &dst);
+    }
+    backend.setColorMod(text, 255, 255, 255);
+
+    // A translucent panel over part of the scene, drawn under a clip rect
+    SDL_Rect clip_rect = {100, 100, 300, 200};
+    backend.setClipRect(&clip_rect);
+    backend.setDrawBlendMode(SDL_BLENDMODE_BLEND);
+    backend.setDrawColor(0, 0, 128, 100);
+    SDL_Rect panel = {50, 50, 400, 300};
+    backend.fillRect(&panel);
+    backend.setDrawBlendMode(SDL_BLENDMODE_NONE);
+    backend.setClipRect(nullptr);
+}
+
+// drawScene backend for SDL's own software renderer
+struct SDLBackend
+{
+    SDL_Renderer *renderer;
+
+    int imageWidth(SDL_Texture &tex) { int w; SDL_QueryTexture(&tex, NULL, NULL, &w, NULL); return w; }
+    int imageHeight(SDL_Texture &tex) { int h; SDL_QueryTexture(&tex, NULL, NULL, NULL, &h); return h; }
+    void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a) { SDL_SetRenderDrawColor(renderer, r, g, b, a); }
+    void setDrawBlendMode(SDL_BlendMode mode) { SDL_SetRenderDrawBlendMode(renderer, mode); }
+    void setClipRect(const SDL_Rect *rect) { SDL_RenderSetClipRect(renderer, rect); }
+    void clear() { SDL_RenderClear(renderer); }
+    void fillRect(const SDL_Rect *rect) { SDL_RenderFillRect(renderer, rect); }
+    void copy(SDL_Texture &tex, const SDL_Rect *src, const SDL_Rect *dst) { SDL_RenderCopy(renderer, &tex, src, dst); }
+    void setAlphaMod(SDL_Texture &tex, Uint8 a) { SDL_SetTextureAlphaMod(&tex, a); }
+    void setColorMod(SDL_Texture &tex, Uint8 r, Uint8 g, Uint8 b) { SDL_SetTextureColorMod(&tex, r, g, b); }
+};
+
+// drawScene backend for the tiled rasterizer
+struct TiledBackend
+{
+    TiledRasterizer *raster;
+
+    int imageWidth(RasterImage &image) { return image.width; }
+    int imageHeight(RasterImage &image) { return image.height; }
+    void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a) { raster->setDrawColor(r, g, b, a); }
+    void setDrawBlendMode(SDL_BlendMode mode) { raster->setDrawBlendMode(mode); }
+    void setClipRect(const SDL_Rect *rect) { raster->setClipRect(rect); }
+    void clear() { raster->clear(); }
+    void fillRect(const SDL_Rect *rect) { raster->fillRect(rect); }
+    void copy(RasterImage &image, const SDL_Rect *src, const SDL_Rect *dst) { raster->copy(image, src, dst); }
+    void setAlphaMod(RasterImage &image, Uint8 a) { image.a = a; }
+    void setColorMod(RasterImage &image, Uint8 r, Uint8 g, Uint8 b) { image.r = r; image.g = g; image.b = b; }
+};
+
+// Count pixels whose color differs, alpha is left out since window
+// surfaces do not have any
+long countMismatches(const Uint32 *a, int pitchA, const Uint32 *b, int pitchB)
+{
+    long mismatched = 0;
+    for (int y = 0; y < BENCH_SCREEN_HEIGHT; ++y)
+    {
+        const Uint32 *row_a = reinterpret_cast<const Uint32*>(reinterpret_cast<const Uint8*>(a) + y * pitchA);
+        const Uint32 *row_b = reinterpret_cast<const Uint32*>(reinterpret_cast<const Uint8*>(b) + y * pitchB);
+        for (int x = 0; x < BENCH_SCREEN_WIDTH; ++x)
+        {
+            if ((row_a[x] ^ row_b[x]) & 0xffffff)
+            {
+                ++mismatched;
+            }
+        }
+    }
+    return mismatched;
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *window_renderer = nullptr;
+    if (!initHeadless(&window, &window_renderer))
+    {
+        return 1;
+    }
+    if (TTF_Init() != 0)
+    {
+        std::cout << "TTF_Init" << SDL_GetError() << std::endl;
+        cleanup(window_renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    // Everything below is freed here whichever way main returns, cleanup
+    // skips what was never created
+    SDL_Surface *all[5] = { nullptr, nullptr, nullptr, nullptr, nullptr };
+    SDL_Texture *textures[5] = { nullptr, nullptr, nullptr, nullptr, nullptr };
+    SDL_Surface *target = nullptr;
+    SDL_Renderer *software = nullptr;
+    auto finish = [&](int code)
+    {
+        for (int i = 0; i < 5; ++i)
+        {
+            cleanup(textures[i], all[i]);
+        }
+        cleanup(software, target, window_renderer, window);
+        TTF_Quit();
+        SDL_Quit();
+        return code;
+    };
+
+    // The images the lesson scenes draw, loaded as surfaces so both SDL's
+    // software renderer and the tiled rasterizer can be fed from them
+    all[0] = SDL_LoadBMP((get_resource_path("lesson2") + "background.bmp").c_str());
+    all[1] = SDL_LoadBMP((get_resource_path("lesson2") + "image.bmp").c_str());
+    all[2] = IMG_Load((get_resource_path("lesson3") + "background.png").c_str());
+    all[3] = IMG_Load((get_resource_path("lesson5") + "image.png").c_str());
+    TTF_Font *font = TTF_OpenFont((get_resource_path("lesson6") + "sample.ttf").c_str(), 64);
+    if (font != nullptr)
+    {
+        SDL_Color white = {255, 255, 255, 255};
+        all[4] = TTF_RenderText_Blended(font, "TTF fonts are cool!", white);
+        TTF_CloseFont(font);
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        if (all[i] == nullptr)
+        {
+            std::cout << "Loading scene images" << SDL_GetError() << std::endl;
+            return finish(1);
+        }
+    }
+
+    // Reference: SDL's software renderer drawing into an ARGB8888 surface
+    target = SDL_CreateRGBSurfaceWithFormat(0, BENCH_SCREEN_WIDTH,
+        BENCH_SCREEN_HEIGHT, 32, RASTER_PIXEL_FORMAT);
+    software = target != nullptr ? SDL_CreateSoftwareRenderer(target) : nullptr;
+    if (software == nullptr)
+    {
+        std::cout << "SDL_CreateSoftwareRenderer" << SDL_GetError() << std::endl;
+        return finish(1);
+    }
+    RasterImage images[5];
+    SDL_Texture *texture_ptrs[5];
+    RasterImage *image_ptrs[5];
+    for (int i = 0; i < 5; ++i)
+    {
+        textures[i] = SDL_CreateTextureFromSurface(software, all[i]);
+        if (textures[i] == nullptr || !makeRasterImage(all[i], images[i]))
+        {
+            std::cout << "Creating scene images" << SDL_GetError() << std::endl;
+            return finish(1);
+        }
+        texture_ptrs[i] = textures[i];
+        image_ptrs[i] = &images[i];
+    }
+
+    SDLBackend sdl_backend = { software };
+    BenchTimer timer;
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        drawScene(sdl_backend, texture_ptrs, frame);
+        SDL_RenderPresent(software);
+    }
+    reportResult(std::cout, "raster_sdl_software", FRAMES, timer.seconds(), "frames");
+
+    // The frame both backends are compared on
+    drawScene(sdl_backend, texture_ptrs, 0);
+    SDL_RenderPresent(software);
+
+    // Tiled rasterizer from one thread up to one per CPU
+    const int cpus = SDL_GetCPUCount();
+    std::vector<int> counts;
+    for (int threads = 1; threads < cpus; threads *= 2)
+    {
+        counts.push_back(threads);
+    }
+    counts.push_back(cpus);
+
+    bool failed = false;
+    for (size_t c = 0; c < counts.size(); ++c)
+    {
+        TiledRasterizer raster(BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT, counts[c]);
+        TiledBackend tiled_backend = { &raster };
+
+        drawScene(tiled_backend, image_ptrs, 0);
+        raster.flush();
+        const long mismatched = countMismatches(raster.getPixels(), raster.getPitch(),
+            static_cast<Uint32*>(target->pixels), target->pitch);
+
+        timer.restart();
+        for (int frame = 0; frame < FRAMES; ++frame)
+        {
+            drawScene(tiled_backend, image_ptrs, frame);
+            raster.flush();
+        }
+        const double seconds = timer.seconds();
+
+        // Speedups are the ratio of the rates, the counts are iterations
+        const std::string name = "raster_tiled_" + std::to_string(counts[c]) + "_threads";
+        reportResult(std::cout, name, FRAMES, seconds, "frames");
+        reportResult(std::cout, name + "_mismatched", mismatched, seconds, "pixels");
+        reportResult(std::cout, name + "_steals", raster.getStats().steals, seconds,
+            "steals");
+        if (mismatched > 0)
+        {
+            std::cerr << name << ": " << mismatched
+                      << " pixels differ from SDL's software renderer" << std::endl;
+            failed = true;
+        }
+    }
+
+    return finish(failed ? 1 : 0);
+}
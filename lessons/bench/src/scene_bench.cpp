@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "texture.h"
+#include "render_helpers.h"
+#include "scene_graph.h"
+#include "bench.h"
+
+const int NUM_OBJECTS = 1000000;
+
+// 100 x 100 screens, so about 100 objects are in view at a time
+const int WORLD_WIDTH = BENCH_SCREEN_WIDTH * 100;
+const int WORLD_HEIGHT = BENCH_SCREEN_HEIGHT * 100;
+const int NUM_QUERIES = 10000;
+const int NUM_BRUTE_QUERIES = 20;
+const int NUM_FRAMES = 200;
+const int CLIP_SIZE = 100;
+
+// Camera position for a step of a fixed sweep across the world
+Camera cameraAt(int step)
+{
+    Camera camera;
+    camera.x = float((step * 997) % (WORLD_WIDTH - BENCH_SCREEN_WIDTH));
+    camera.y = float((step * 631) % (WORLD_HEIGHT - BENCH_SCREEN_HEIGHT));
+    camera.width = BENCH_SCREEN_WIDTH;
+    camera.height = BENCH_SCREEN_HEIGHT;
+    return camera;
+}
+
+// Find the visible objects overlapping an area by testing every object
+// @param found Filled with their ids, in increasing order
+void bruteForceQuery(const SceneGraph &scene, const SDL_Rect &area, std::vector<int> &found)
+{
+    found.clear();
+    const float right = float(area.x + area.w);
+    const float bottom = float(area.y + area.h);
+    for (int id = 0; id < NUM_OBJECTS; ++id)
+    {
+        const SceneObject &object = scene.object(id);
+        if (object.visible &&
+            object.world_x < right && object.world_x + object.width > area.x &&
+            object.world_y < bottom && object.world_y + object.height > area.y)
+        {
+            found.push_back(id);
+        }
+    }
+}
+
+// A second way to find what overlaps an area, sharing no code with the
+// grid: every object sorted by its left edge, so a query only has to
+// look at the objects whose left edge is within the widest object of
+// the area
+class SortedQuery
+{
+public:
+    // Takes a copy of where the objects are, so later changes to the
+    // scene are not seen
+    SortedQuery(const SceneGraph &scene, int count)
+        : max_width(0)
+    {
+        for (int id = 0; id < count; ++id)
+        {
+            const SceneObject &object = scene.object(id);
+            if (object.visible)
+            {
+                Entry entry = {object.world_x, object.world_y, object.width, object.height, id};
+                entries.push_back(entry);
+                max_width = std::max(max_width, object.width);
+            }
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+        {
+            return a.x < b.x;
+        });
+    }
+
+    // @param found Filled with the ids of the visible objects overlapping
+    //        the area, in increasing order
+    void query(const SDL_Rect &area, std::vector<int> &found) const
+    {
+        found.clear();
+        const float left = float(area.x - max_width);
+        const float right = float(area.x + area.w);
+        const float bottom = float(area.y + area.h);
+        auto it = std::upper_bound(entries.begin(), entries.end(), left,
+            [](float x, const Entry &entry)
+            {
+                return x < entry.x;
+            });
+        for (; it != entries.end() && it->x < right; ++it)
+        {
+            if (it->x + it->width > area.x && it->y < bottom && it->y + it->height > area.y)
+            {
+                found.push_back(it->id);
+            }
+        }
+        std::sort(found.begin(), found.end());
+    }
+
+private:
+    struct Entry
+    {
+        float x;
+        float y;
+        int width;
+        int height;
+        int id;
+    };
+
+    int max_width;
+    std::vector<Entry> entries;
+};
+
+// Check the grid finds exactly the same objects as the sorted query for
+// every view in the sweep, and for views on and past the world's edges.
+// The sorted query is itself checked against testing every object for
+// the views the brute force case times
+// @return false if any view differs, which is logged to stderr
+bool checkQueries(const SceneGraph &scene)
+{
+    const SortedQuery sorted(scene, NUM_OBJECTS);
+    std::vector<SDL_Rect> views;
+    for (int i = 0; i < NUM_QUERIES; ++i)
+    {
+        Camera camera = cameraAt(i);
+        SDL_Rect view = {int(camera.x), int(camera.y), camera.width, camera.height};
+        views.push_back(view);
+    }
+    const int w = BENCH_SCREEN_WIDTH;
+    const int h = BENCH_SCREEN_HEIGHT;
+    const SDL_Rect edges[] = {
+        {0, 0, w, h}, {WORLD_WIDTH - w, WORLD_HEIGHT - h, w, h},
+        {-w / 2, -h / 2, w, h}, {WORLD_WIDTH - w / 2, WORLD_HEIGHT - h / 2, w, h},
+        {0, 0, WORLD_WIDTH, CLIP_SIZE}
+    };
+    views.insert(views.end(), edges, edges + sizeof(edges) / sizeof(edges[0]));
+
+    std::vector<int> grid, expected, brute;
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        scene.query(views[i], grid);
+        std::sort(grid.begin(), grid.end());
+        sorted.query(views[i], expected);
+        if (i < size_t(NUM_BRUTE_QUERIES))
+        {
+            bruteForceQuery(scene, views[i], brute);
+            if (brute != expected)
+            {
+                std::cerr << "scene_query: sorted query disagrees with testing every object"
+                          << std::endl;
+                return false;
+            }
+        }
+        if (grid != expected)
+        {
+            std::cerr << "scene_query: view " << views[i].x << "," << views[i].y
+                      << " " << views[i].w << "x" << views[i].h << " grid found "
+                      << grid.size() << " objects, expected " << expected.size() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG )
+    {
+        std::cout << "IMG_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    Texture sheet = makeTexture(IMG_LoadTexture(renderer,
+        (get_resource_path("lesson5") + "image.png").c_str()));
+    if (sheet.texture == nullptr)
+    {
+        std::cout << "LoadTexture" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        IMG_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Fixed pseudo random placement so every run builds the same world
+    SceneGraph scene(WORLD_WIDTH, WORLD_HEIGHT);
+    BenchTimer timer;
+    Uint32 seed = 12345;
+    for (int i = 0; i < NUM_OBJECTS; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        float x = float(seed % WORLD_WIDTH);
+        seed = seed * 1664525u + 1013904223u;
+        float y = float(seed % WORLD_HEIGHT);
+        SDL_Rect clip = {(i & 1) * CLIP_SIZE, ((i >> 1) & 1) * CLIP_SIZE, CLIP_SIZE, CLIP_SIZE};
+        scene.add(sheet, x, y, &clip);
+    }
+    reportResult(std::cout, "scene_build", NUM_OBJECTS, timer.seconds(), "objects");
+
+    // Grid query for what is in view
+    std::vector<int> found;
+    long visible = 0;
+    long checked = 0;
+    timer.restart();
+    for (int i = 0; i < NUM_QUERIES; ++i)
+    {
+        Camera camera = cameraAt(i);
+        SDL_Rect view = {int(camera.x), int(camera.y), camera.width, camera.height};
+        checked += scene.query(view, found);
+        visible += long(found.size());
+    }
+    reportResult(std::cout, "scene_query_grid", NUM_QUERIES, timer.seconds(), "queries");
+    reportResult(std::cout, "scene_query_visible", visible, timer.seconds(), "objects");
+    reportResult(std::cout, "scene_query_checked", checked, timer.seconds(), "objects");
+
+    // Testing every object, what drawing without a spatial index costs
+    timer.restart();
+    for (int i = 0; i < NUM_BRUTE_QUERIES; ++i)
+    {
+        Camera camera = cameraAt(i);
+        SDL_Rect view = {int(camera.x), int(camera.y), camera.width, camera.height};
+        bruteForceQuery(scene, view, found);
+    }
+    reportResult(std::cout, "scene_query_brute_force", NUM_BRUTE_QUERIES, timer.seconds(), "queries");
+
+    // The grid has to find exactly the objects a query that does not
+    // use it finds, for every view. Reported on stderr so
+    // bench_output.txt keeps one line per case
+    if (!checkQueries(scene))
+    {
+        cleanup(sheet.texture, renderer, window);
+        IMG_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Culled frames, the iteration count of scene_draw_calls is how
+    // many draws the culled frames needed in total
+    long draws = 0;
+    timer.restart();
+    for (int frame = 0; frame < NUM_FRAMES; ++frame)
+    {
+        SDL_RenderClear(renderer);
+        draws += scene.draw(cameraAt(frame), [&](const Texture &tex, const SDL_Rect *clip,
+            const SDL_Rect &dst)
+        {
+            renderTexture(tex, renderer, dst, clip);
+        });
+        SDL_RenderPresent(renderer);
+    }
+    reportResult(std::cout, "scene_draw_frames", NUM_FRAMES, timer.seconds(), "frames");
+    reportResult(std::cout, "scene_draw_calls", draws, timer.seconds(), "draws");
+
+    cleanup(sheet.texture, renderer, window);
+    IMG_Quit();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "sprite_batch.h"
+#include "bench.h"
+
+const int NUM_SPRITES = 100000;
+const int NUM_FRAMES = 10;
+const int CLIP_WIDTH = 100;
+const int CLIP_HEIGHT = 100;
+
+// Same as the clip-aware renderTexture from lesson5, kept here as the
+// baseline the sprite batch is compared against
+void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y, SDL_Rect *clip = nullptr)
+{
+    SDL_Rect dst;
+    dst.x = x;
+    dst.y = y;
+    if (clip != nullptr)
+    {
+        dst.w = clip->w;
+        dst.h = clip->h;
+    }
+    else
+    {
+        SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
+    }
+    SDL_RenderCopy(ren, tex, clip, &dst);
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG )
+    {
+        std::cout << "IMG_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    SDL_Texture *sheet = IMG_LoadTexture(renderer,
+        (get_resource_path("lesson5") + "image.png").c_str());
+    if (sheet == nullptr)
+    {
+        std::cout << "LoadTexture" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        IMG_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Same 2x2 layout as lesson5
+    SDL_Rect clips[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        clips[i].x = (i / 2) * CLIP_WIDTH;
+        clips[i].y = (i % 2) * CLIP_HEIGHT;
+        clips[i].w = CLIP_WIDTH;
+        clips[i].h = CLIP_HEIGHT;
+    }
+
+    // Fixed pseudo random positions so every run draws the same scene
+    std::vector<SDL_Point> positions(NUM_SPRITES);
+    Uint32 seed = 12345;
+    for (int i = 0; i < NUM_SPRITES; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        positions[i].x = int(seed % (BENCH_SCREEN_WIDTH - CLIP_WIDTH));
+        seed = seed * 1664525u + 1013904223u;
+        positions[i].y = int(seed % (BENCH_SCREEN_HEIGHT - CLIP_HEIGHT));
+    }
+
+    // One SDL_RenderCopy per sprite
+    BenchTimer timer;
+    for (int frame = 0; frame < NUM_FRAMES; ++frame)
+    {
+        SDL_RenderClear(renderer);
+        for (int i = 0; i < NUM_SPRITES; ++i)
+        {
+            renderTexture(sheet, renderer, positions[i].x, positions[i].y, &clips[i % 4]);
+        }
+        SDL_RenderPresent(renderer);
+    }
+    reportResult(std::cout, "sprites_render_copy", long(NUM_SPRITES) * NUM_FRAMES,
+        timer.seconds(), "sprites");
+
+    // Queued and submitted with SDL_RenderGeometry per texture
+    SpriteBatch batch(renderer, NUM_SPRITES);
+    timer.restart();
+    for (int frame = 0; frame < NUM_FRAMES; ++frame)
+    {
+        SDL_RenderClear(renderer);
+        for (int i = 0; i < NUM_SPRITES; ++i)
+        {
+            batch.draw(sheet, clips[i % 4], positions[i].x, positions[i].y);
+        }
+        batch.flush();
+        SDL_RenderPresent(renderer);
+    }
+    reportResult(std::cout, "sprites_batch", long(NUM_SPRITES) * NUM_FRAMES,
+        timer.seconds(), "sprites");
+
+    cleanup(sheet, renderer, window);
+    IMG_Quit();
+    SDL_Quit();
+    return 0;
+}
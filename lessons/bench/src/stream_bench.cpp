@@ -0,0 +1,121 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "cleanup.h"
+#include "texture.h"
+#include "streaming_texture.h"
+#include "bench.h"
+
+const int IMAGE_SIZE = 4096;
+const int UPLOAD_BUDGET = 1024 * 1024;
+const std::string IMAGE_FILE = "bench_stream.bmp";
+
+// Write a large gradient image to load back in, big enough that loading
+// it in one go shows up as a long frame
+bool writeTestImage()
+{
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, IMAGE_SIZE, IMAGE_SIZE,
+        32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == nullptr)
+    {
+        std::cerr << "SDL_CreateRGBSurfaceWithFormat" << SDL_GetError() << std::endl;
+        return false;
+    }
+    for (int y = 0; y < IMAGE_SIZE; ++y)
+    {
+        Uint32 *row = (Uint32*)((Uint8*)surface->pixels + y * surface->pitch);
+        for (int x = 0; x < IMAGE_SIZE; ++x)
+        {
+            row[x] = 0xff000000u | (Uint32(x & 0xff) << 16) | (Uint32(y & 0xff) << 8);
+        }
+    }
+    bool ok = SDL_SaveBMP(surface, IMAGE_FILE.c_str()) == 0;
+    if (!ok)
+    {
+        std::cerr << "SDL_SaveBMP" << SDL_GetError() << std::endl;
+    }
+    cleanup(surface);
+    return ok;
+}
+
+// Draw the part of the image that is loaded and present it, the same
+// work every frame in both cases
+void drawFrame(SDL_Renderer *ren, const Texture &tex, const SDL_Rect &loaded)
+{
+    SDL_RenderClear(ren);
+    if (tex.texture != nullptr && loaded.h > 0)
+    {
+        SDL_Rect dst = { 0, 0, BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT };
+        SDL_RenderCopy(ren, tex.texture, &loaded, &dst);
+    }
+    SDL_RenderPresent(ren);
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG || !writeTestImage() )
+    {
+        std::cerr << "IMG_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        IMG_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Whole image in one frame, the way loadTexture does it
+    BenchTimer timer;
+    Texture whole = makeTexture(IMG_LoadTexture(renderer, IMAGE_FILE.c_str()));
+    if (whole.texture == nullptr)
+    {
+        std::cerr << "IMG_LoadTexture " << SDL_GetError() << std::endl;
+        std::remove(IMAGE_FILE.c_str());
+        cleanup(renderer, window);
+        IMG_Quit();
+        SDL_Quit();
+        return 1;
+    }
+    SDL_Rect all = { 0, 0, whole.width, whole.height };
+    drawFrame(renderer, whole, all);
+    reportResult(std::cout, "stream_whole_frame", 1, timer.seconds(), "frames");
+    cleanup(whole.texture);
+
+    // Streamed in over as many frames as the budget needs
+    long frames = 0;
+    double worst = 0.0;
+    BenchTimer total;
+    {
+        TextureStreamer streamer(renderer, UPLOAD_BUDGET);
+        StreamingTextureHandle handle = streamer.load(IMAGE_FILE);
+        while (!handle.ready())
+        {
+            timer.restart();
+            streamer.update();
+            drawFrame(renderer, handle.texture(), handle.loadedRect());
+            double seconds = timer.seconds();
+            worst = seconds > worst ? seconds : worst;
+            ++frames;
+        }
+        if (handle.failed())
+        {
+            std::cerr << "TextureStreamer failed to load " << handle.path() << std::endl;
+            frames = 0;
+        }
+    }
+    reportResult(std::cout, "stream_frames", frames, total.seconds(), "frames");
+    reportResult(std::cout, "stream_worst_frame", 1, worst, "frames");
+
+    std::remove(IMAGE_FILE.c_str());
+    cleanup(renderer, window);
+    IMG_Quit();
+    SDL_Quit();
+    return frames > 0 ? 0 : 1;
+}
@@ -0,0 +1,322 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "texture.h"
+#include "render_helpers.h"
+#include "texture_cache.h"
+#include "tile_layer.h"
+#include "glyph_atlas.h"
+#include "retained_scene.h"
+#include "bench.h"
+
+// Iteration counts are fixed so results can be compared between commits
+const int BMP_LOADS = 500;
+const int PNG_LOADS = 500;
+const int TILE_FRAMES = 500;
+const int SPRITE_FRAMES = 500;
+const int SPRITES_PER_FRAME = 1000;
+const int TEXT_STRINGS = 2000;
+const int SCENE_FRAMES = 500;
+const int TILE_SIZE = 40;
+const int CLIP_SIZE = 100;
+
+// Log how many loads in a case failed
+// @return true if none did
+bool reportFailures(const std::string &name, int failed)
+{
+    if (failed > 0)
+    {
+        std::cerr << name << ": " << failed << " loads failed " << SDL_GetError() << std::endl;
+    }
+    return failed == 0;
+}
+
+// lesson2: SDL_LoadBMP then SDL_CreateTextureFromSurface
+bool benchBmpLoad(SDL_Renderer *renderer)
+{
+    const std::string path = get_resource_path("lesson2");
+    const char *files[] = {"background.bmp", "image.bmp"};
+
+    int failed = 0;
+    BenchTimer timer;
+    for (int i = 0; i < BMP_LOADS; ++i)
+    {
+        SDL_Surface *surf = SDL_LoadBMP((path + files[i % 2]).c_str());
+        SDL_Texture *tex = surf ? SDL_CreateTextureFromSurface(renderer, surf) : nullptr;
+        failed += tex == nullptr ? 1 : 0;
+        cleanup(surf, tex);
+    }
+    reportResult(std::cout, "lesson2_bmp_load", BMP_LOADS, timer.seconds(), "images");
+    return reportFailures("lesson2_bmp_load", failed);
+}
+
+// lesson3 to lesson5: IMG_LoadTexture
+bool benchPngLoad(SDL_Renderer *renderer)
+{
+    std::vector<std::string> files;
+    files.push_back(get_resource_path("lesson3") + "background.png");
+    files.push_back(get_resource_path("lesson3") + "image.png");
+    files.push_back(get_resource_path("lesson4") + "image.png");
+    files.push_back(get_resource_path("lesson5") + "image.png");
+
+    int failed = 0;
+    BenchTimer timer;
+    for (int i = 0; i < PNG_LOADS; ++i)
+    {
+        SDL_Texture *tex = IMG_LoadTexture(renderer, files[i % files.size()].c_str());
+        failed += tex == nullptr ? 1 : 0;
+        cleanup(tex);
+    }
+    reportResult(std::cout, "lesson3_5_png_load", PNG_LOADS, timer.seconds(), "images");
+    bool ok = reportFailures("lesson3_5_png_load", failed);
+
+    // The same loads through a TextureCache, which only goes to disk the
+    // first time it sees each file
+    failed = 0;
+    {
+        TextureCache cache(renderer, loadTexture);
+        timer.restart();
+        for (int i = 0; i < PNG_LOADS; ++i)
+        {
+            TextureHandle handle = cache.acquire(files[i % files.size()]);
+            failed += handle.texture().width > 0 ? 0 : 1;
+        }
+        reportResult(std::cout, "lesson3_5_png_load_cached", PNG_LOADS, timer.seconds(), "images");
+        if (failed == 0 && cache.getMisses() != long(files.size()))
+        {
+            std::cerr << "lesson3_5_png_load_cached: expected " << files.size()
+                      << " misses, got " << cache.getMisses() << std::endl;
+            ok = false;
+        }
+    }
+    return reportFailures("lesson3_5_png_load_cached", failed) && ok;
+}
+
+// lesson3: 16x12 grid of 40x40 tiles, drawn tile by tile and
+// through a TileLayer
+bool benchTiles(SDL_Renderer *renderer)
+{
+    Texture bg = makeTexture(IMG_LoadTexture(renderer,
+        (get_resource_path("lesson3") + "background.png").c_str()));
+    if (bg.texture == nullptr)
+    {
+        std::cerr << "LoadTexture " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    const int tiles_x = BENCH_SCREEN_WIDTH / TILE_SIZE;
+    const int tiles_y = BENCH_SCREEN_HEIGHT / TILE_SIZE;
+
+    BenchTimer timer;
+    for (int frame = 0; frame < TILE_FRAMES; ++frame)
+    {
+        SDL_RenderClear(renderer);
+        for (int i = 0; i < tiles_x * tiles_y; ++i)
+        {
+            SDL_Rect dst = {(i % tiles_x) * TILE_SIZE, (i / tiles_x) * TILE_SIZE, TILE_SIZE, TILE_SIZE};
+            SDL_RenderCopy(renderer, bg.texture, NULL, &dst);
+        }
+        SDL_RenderPresent(renderer);
+    }
+    reportResult(std::cout, "lesson3_tiles_per_tile", TILE_FRAMES, timer.seconds(), "frames");
+
+    std::vector<SDL_Rect> clips(1);
+    clips[0].x = 0;
+    clips[0].y = 0;
+    clips[0].w = bg.width;
+    clips[0].h = bg.height;
+    {
+        TileLayer layer(renderer, bg, clips, tiles_x, tiles_y, TILE_SIZE);
+        layer.fill(0);
+        SDL_Rect view = {0, 0, BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT};
+
+        timer.restart();
+        for (int frame = 0; frame < TILE_FRAMES; ++frame)
+        {
+            SDL_RenderClear(renderer);
+            layer.draw(view);
+            SDL_RenderPresent(renderer);
+        }
+        reportResult(std::cout, "lesson3_tiles_layer", TILE_FRAMES, timer.seconds(), "frames");
+    }
+    cleanup(bg.texture);
+    return true;
+}
+
+// lesson5: clipped draws out of the 2x2 sprite sheet
+bool benchSprites(SDL_Renderer *renderer)
+{
+    SDL_Texture *sheet = IMG_LoadTexture(renderer,
+        (get_resource_path("lesson5") + "image.png").c_str());
+    if (sheet == nullptr)
+    {
+        std::cerr << "LoadTexture " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    SDL_Rect clips[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        clips[i].x = (i / 2) * CLIP_SIZE;
+        clips[i].y = (i % 2) * CLIP_SIZE;
+        clips[i].w = CLIP_SIZE;
+        clips[i].h = CLIP_SIZE;
+    }
+
+    BenchTimer timer;
+    for (int frame = 0; frame < SPRITE_FRAMES; ++frame)
+    {
+        SDL_RenderClear(renderer);
+        for (int i = 0; i < SPRITES_PER_FRAME; ++i)
+        {
+            SDL_Rect dst = {(i * 37) % (BENCH_SCREEN_WIDTH - CLIP_SIZE),
+                (i * 53) % (BENCH_SCREEN_HEIGHT - CLIP_SIZE), CLIP_SIZE, CLIP_SIZE};
+            SDL_RenderCopy(renderer, sheet, &clips[i % 4], &dst);
+        }
+        SDL_RenderPresent(renderer);
+    }
+    reportResult(std::cout, "lesson5_clipped_sprites", long(SPRITE_FRAMES) * SPRITES_PER_FRAME,
+        timer.seconds(), "sprites");
+
+    cleanup(sheet);
+    return true;
+}
+
+// lesson6: renderText style open/rasterize/upload per string, and the
+// glyph atlas
+bool benchText(SDL_Renderer *renderer)
+{
+    const std::string font_file = get_resource_path("lesson6") + "sample.ttf";
+    SDL_Color color = {255, 255, 255, 255};
+
+    int failed = 0;
+    BenchTimer timer;
+    for (int i = 0; i < TEXT_STRINGS; ++i)
+    {
+        TTF_Font *font = TTF_OpenFont(font_file.c_str(), 16);
+        SDL_Surface *surf = font ? TTF_RenderText_Blended(font, ("Score: " + std::to_string(i)).c_str(), color) : nullptr;
+        SDL_Texture *tex = surf ? SDL_CreateTextureFromSurface(renderer, surf) : nullptr;
+        if (tex != nullptr)
+        {
+            SDL_Rect dst = {10, 10, surf->w, surf->h};
+            SDL_RenderCopy(renderer, tex, NULL, &dst);
+        }
+        failed += tex == nullptr ? 1 : 0;
+        cleanup(tex, surf);
+        if (font != nullptr)
+        {
+            TTF_CloseFont(font);
+        }
+    }
+    SDL_RenderPresent(renderer);
+    reportResult(std::cout, "lesson6_text_render_text", TEXT_STRINGS, timer.seconds(), "strings");
+    bool ok = reportFailures("lesson6_text_render_text", failed);
+
+    failed = 0;
+    timer.restart();
+    TextEngine text_engine(renderer);
+    for (int i = 0; i < TEXT_STRINGS; ++i)
+    {
+        if (!text_engine.drawText("Score: " + std::to_string(i), font_file, color, 16, 10, 10))
+        {
+            ++failed;
+        }
+    }
+    SDL_RenderPresent(renderer);
+    reportResult(std::cout, "lesson6_text_glyph_atlas", TEXT_STRINGS, timer.seconds(), "strings");
+    return reportFailures("lesson6_text_glyph_atlas", failed) && ok;
+}
+
+// lesson4-6: a mostly static scene redrawn in full every frame, kept in
+// a retained scene with nothing changing, and with one small sprite
+// moving so only its old and new rectangles are repainted
+bool benchScene(SDL_Renderer *renderer)
+{
+    Texture image = makeTexture(IMG_LoadTexture(renderer,
+        (get_resource_path("lesson4") + "image.png").c_str()));
+    Texture sheet = makeTexture(IMG_LoadTexture(renderer,
+        (get_resource_path("lesson5") + "image.png").c_str()));
+    if (image.texture == nullptr || sheet.texture == nullptr)
+    {
+        std::cerr << "LoadTexture " << SDL_GetError() << std::endl;
+        cleanup(image.texture, sheet.texture);
+        return false;
+    }
+    SDL_Rect image_dst = {(BENCH_SCREEN_WIDTH - image.width) / 2,
+        (BENCH_SCREEN_HEIGHT - image.height) / 2, image.width, image.height};
+    SDL_Rect clip = {0, 0, CLIP_SIZE, CLIP_SIZE};
+
+    BenchTimer timer;
+    for (int frame = 0; frame < SCENE_FRAMES; ++frame)
+    {
+        SDL_RenderClear(renderer);
+        SDL_RenderCopy(renderer, image.texture, NULL, &image_dst);
+        SDL_RenderPresent(renderer);
+    }
+    reportResult(std::cout, "scene_static_full_redraw", SCENE_FRAMES, timer.seconds(), "frames");
+
+    RetainedScene scene(renderer, BENCH_SCREEN_WIDTH, BENCH_SCREEN_HEIGHT);
+    scene.add(image, image_dst.x, image_dst.y);
+    timer.restart();
+    for (int frame = 0; frame < SCENE_FRAMES; ++frame)
+    {
+        if (scene.render())
+        {
+            SDL_RenderPresent(renderer);
+        }
+    }
+    reportResult(std::cout, "scene_static_retained", SCENE_FRAMES, timer.seconds(), "frames");
+
+    const int sprite = scene.add(sheet, 0, 0, &clip, 1);
+    timer.restart();
+    for (int frame = 0; frame < SCENE_FRAMES; ++frame)
+    {
+        scene.setPosition(sprite, (frame * 3) % (BENCH_SCREEN_WIDTH - CLIP_SIZE), 10);
+        if (scene.render())
+        {
+            SDL_RenderPresent(renderer);
+        }
+    }
+    reportResult(std::cout, "scene_moving_sprite_retained", SCENE_FRAMES, timer.seconds(), "frames");
+
+    cleanup(image.texture, sheet.texture);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG || TTF_Init() != 0 )
+    {
+        std::cerr << "IMG_Init/TTF_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    // Every scene runs even if an earlier one failed, so one bad asset
+    // does not hide the rest of the results
+    bool ok = benchBmpLoad(renderer);
+    ok = benchPngLoad(renderer) && ok;
+    ok = benchTiles(renderer) && ok;
+    ok = benchSprites(renderer) && ok;
+    ok = benchText(renderer) && ok;
+    ok = benchScene(renderer) && ok;
+
+    cleanup(renderer, window);
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <string>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "glyph_atlas.h"
+#include "bench.h"
+
+const int NUM_STRINGS = 5000;
+const int FONT_SIZE = 16;
+const int STRINGS_PER_FRAME = 100;
+
+// Same as renderText from lesson6, kept here as the baseline to
+// compare the glyph atlas against
+SDL_Texture* renderText(const std::string &message, const std::string &fontFile,
+    SDL_Color color, int fontSize, SDL_Renderer *renderer)
+{
+    TTF_Font *font = TTF_OpenFont(fontFile.c_str(), fontSize);
+    if (font == nullptr)
+    {
+        return nullptr;
+    }
+
+    SDL_Surface *surf = TTF_RenderText_Blended(font, message.c_str(), color);
+    if (surf == nullptr)
+    {
+        TTF_CloseFont(font);
+        return nullptr;
+    }
+
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surf);
+    SDL_FreeSurface(surf);
+    TTF_CloseFont(font);
+    return texture;
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if (TTF_Init() != 0)
+    {
+        std::cout << "TTF_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    const std::string font_file = get_resource_path("lesson6") + "sample.ttf";
+    SDL_Color color = {255, 255, 255, 255};
+
+    // Baseline: open the font, rasterize and upload every string
+    BenchTimer timer;
+    for (int i = 0; i < NUM_STRINGS; ++i)
+    {
+        SDL_Texture *tex = renderText("Score: " + std::to_string(i),
+            font_file, color, FONT_SIZE, renderer);
+        if (tex == nullptr)
+        {
+            std::cout << "renderText" << SDL_GetError() << std::endl;
+            break;
+        }
+
+        int w, h;
+        SDL_QueryTexture(tex, NULL, NULL, &w, &h);
+        SDL_Rect dst = {10, 10, w, h};
+        SDL_RenderCopy(renderer, tex, NULL, &dst);
+        cleanup(tex);
+
+        if (i % STRINGS_PER_FRAME == 0)
+        {
+            SDL_RenderPresent(renderer);
+        }
+    }
+    SDL_RenderPresent(renderer);
+    reportResult(std::cout, "text_render_text", NUM_STRINGS, timer.seconds(), "strings");
+
+    // Glyph atlas: font opened once, glyphs rasterized on first use.
+    // Construction is inside the timed region so the first-use
+    // rasterization cost is counted too. The engine goes out of scope
+    // before the renderer it draws with is destroyed
+    timer.restart();
+    {
+        TextEngine text_engine(renderer);
+        for (int i = 0; i < NUM_STRINGS; ++i)
+        {
+            text_engine.drawText("Score: " + std::to_string(i),
+                font_file, color, FONT_SIZE, 10, 10);
+
+            if (i % STRINGS_PER_FRAME == 0)
+            {
+                SDL_RenderPresent(renderer);
+            }
+        }
+        SDL_RenderPresent(renderer);
+        reportResult(std::cout, "text_glyph_atlas", NUM_STRINGS, timer.seconds(), "strings");
+    }
+
+    cleanup(renderer, window);
+    TTF_Quit();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include "res_path.h"
+#include "cleanup.h"
+#include "glyph_atlas.h"
+#include "text_object.h"
+#include "bench.h"
+
+const int NUM_UPDATES = 10000;
+const int FONT_SIZE = 16;
+const int UPDATES_PER_FRAME = 100;
+
+// Every C++ allocation made by the program, counted by the operators below
+static long heap_allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++heap_allocations;
+    void *ptr = std::malloc(size != 0 ? size : 1);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+// Allocations made by C++ and by SDL itself since the last call
+class AllocationCounter
+{
+public:
+    AllocationCounter()
+    {
+        restart();
+    }
+
+    void restart()
+    {
+        heap_start = heap_allocations;
+        sdl_start = SDL_GetNumAllocations();
+    }
+
+    long count() const
+    {
+        return (heap_allocations - heap_start) + (SDL_GetNumAllocations() - sdl_start);
+    }
+
+private:
+    long heap_start;
+    long sdl_start;
+};
+
+// Same as renderText from lesson6 before text objects, kept here as the
+// baseline: the font is opened once but every new string is rasterized
+// into a new texture
+SDL_Texture* renderText(const std::string &message, TTF_Font *font, SDL_Color color,
+    SDL_Renderer *renderer)
+{
+    SDL_Surface *surf = TTF_RenderText_Blended(font, message.c_str(), color);
+    if (surf == nullptr)
+    {
+        return nullptr;
+    }
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surf);
+    SDL_FreeSurface(surf);
+    return texture;
+}
+
+// Update a counter NUM_UPDATES times with a TextObject, drawing it after
+// each update
+void benchTextObject(const std::string &name, TextEngine &engine,
+    const std::string &fontFile, SDL_Color color, TextLayoutCache *cache)
+{
+    TextObject counter(engine, fontFile, FONT_SIZE, color, cache);
+    std::string text;
+    char buffer[32];
+
+    // Draw once so the font is open and the digits are in the atlas
+    counter.setText("Score: 0123456789");
+    counter.draw(10, 10);
+
+    long glyphs = 0;
+    AllocationCounter allocations;
+    BenchTimer timer;
+    for (int i = 0; i < NUM_UPDATES; ++i)
+    {
+        std::snprintf(buffer, sizeof(buffer), "Score: %d", i);
+        text.assign(buffer);
+        counter.setText(text);
+        counter.draw(10, 10);
+        glyphs += counter.getGlyphsDrawn();
+
+        if (i % UPDATES_PER_FRAME == 0)
+        {
+            SDL_RenderPresent(engine.getRenderer());
+        }
+    }
+    const double seconds = timer.seconds();
+    const long allocated = allocations.count();
+
+    reportResult(std::cout, name, NUM_UPDATES, seconds, "updates");
+    reportResult(std::cout, name + "_allocations", allocated, seconds, "allocations");
+    reportResult(std::cout, name + "_glyphs", glyphs, seconds, "glyphs");
+    reportResult(std::cout, name + "_texture_creates", counter.getTextureCreates(), seconds,
+        "creates");
+    if (cache != nullptr)
+    {
+        reportResult(std::cout, name + "_layout_hits", cache->getHits(), seconds, "hits");
+        reportResult(std::cout, name + "_layout_misses", cache->getMisses(), seconds, "misses");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    if (TTF_Init() != 0)
+    {
+        std::cout << "TTF_Init" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    const std::string font_file = get_resource_path("lesson6") + "sample.ttf";
+    SDL_Color color = {255, 255, 255, 255};
+
+    TTF_Font *font = TTF_OpenFont(font_file.c_str(), FONT_SIZE);
+    if (font == nullptr)
+    {
+        std::cout << "TTF_OpenFont" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        TTF_Quit();
+        SDL_Quit();
+        return 1;
+    }
+
+    // Baseline: rasterize the whole line into a new texture every update
+    {
+        std::string text;
+        char buffer[32];
+        AllocationCounter allocations;
+        BenchTimer timer;
+        for (int i = 0; i < NUM_UPDATES; ++i)
+        {
+            std::snprintf(buffer, sizeof(buffer), "Score: %d", i);
+            text.assign(buffer);
+            SDL_Texture *tex = renderText(text, font, color, renderer);
+            if (tex == nullptr)
+            {
+                std::cout << "renderText" << SDL_GetError() << std::endl;
+                break;
+            }
+
+            int w, h;
+            SDL_QueryTexture(tex, NULL, NULL, &w, &h);
+            SDL_Rect dst = {10, 10, w, h};
+            SDL_RenderCopy(renderer, tex, NULL, &dst);
+            cleanup(tex);
+
+            if (i % UPDATES_PER_FRAME == 0)
+            {
+                SDL_RenderPresent(renderer);
+            }
+        }
+        const double seconds = timer.seconds();
+        const long allocated = allocations.count();
+        reportResult(std::cout, "text_counter_render_text", NUM_UPDATES, seconds, "updates");
+        reportResult(std::cout, "text_counter_render_text_allocations", allocated, seconds,
+            "allocations");
+    }
+    TTF_CloseFont(font);
+
+    {
+        TextEngine engine(renderer);
+        benchTextObject("text_counter_object", engine, font_file, color, nullptr);
+
+        TextLayoutCache cache;
+        benchTextObject("text_counter_object_cached", engine, font_file, color, &cache);
+    }
+
+    cleanup(renderer, window);
+    TTF_Quit();
+    SDL_Quit();
+    return 0;
+}
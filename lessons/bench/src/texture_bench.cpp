@@ -0,0 +1,98 @@
+#include <iostream>
+#include <string>
+#include <SDL2/SDL.h>
+#include "cleanup.h"
+#include "texture.h"
+#include "bench.h"
+
+const int NUM_DRAWS = 1000000;
+const int DRAWS_PER_FRAME = 10000;
+
+// The texture is tiny so the cost of getting its size is not
+// hidden behind the cost of filling pixels
+const int TEXTURE_SIZE = 4;
+
+int main(int argc, char **argv)
+{
+    SDL_Window *window = nullptr;
+    SDL_Renderer *renderer = nullptr;
+    if (!initHeadless(&window, &renderer))
+    {
+        return 1;
+    }
+
+    Texture tex = makeTexture(SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC, TEXTURE_SIZE, TEXTURE_SIZE));
+    if (tex.texture == nullptr)
+    {
+        std::cout << "CreateTexture" << SDL_GetError() << std::endl;
+        cleanup(renderer, window);
+        SDL_Quit();
+        return 1;
+    }
+
+    // Metadata only: what the old renderTexture paid per draw before
+    // it even got to SDL_RenderCopy
+    long checksum = 0;
+    BenchTimer timer;
+    for (int i = 0; i < NUM_DRAWS; ++i)
+    {
+        int w, h;
+        SDL_QueryTexture(tex.texture, NULL, NULL, &w, &h);
+        checksum += w + h;
+    }
+    reportResult(std::cout, "texture_size_query", NUM_DRAWS, timer.seconds(), "lookups");
+
+    timer.restart();
+    for (int i = 0; i < NUM_DRAWS; ++i)
+    {
+        // volatile read so the loop is not folded away
+        const volatile int *w = &tex.width;
+        const volatile int *h = &tex.height;
+        checksum += *w + *h;
+    }
+    reportResult(std::cout, "texture_size_cached", NUM_DRAWS, timer.seconds(), "lookups");
+
+    // Full draws, old path: query then copy
+    timer.restart();
+    for (int i = 0; i < NUM_DRAWS; ++i)
+    {
+        SDL_Rect dst;
+        dst.x = i % BENCH_SCREEN_WIDTH;
+        dst.y = (i / BENCH_SCREEN_WIDTH) % BENCH_SCREEN_HEIGHT;
+        SDL_QueryTexture(tex.texture, NULL, NULL, &dst.w, &dst.h);
+        SDL_RenderCopy(renderer, tex.texture, NULL, &dst);
+        if (i % DRAWS_PER_FRAME == 0)
+        {
+            SDL_RenderPresent(renderer);
+        }
+    }
+    reportResult(std::cout, "draw_with_query", NUM_DRAWS, timer.seconds(), "draws");
+
+    // Full draws, new path: size comes from the wrapper
+    timer.restart();
+    for (int i = 0; i < NUM_DRAWS; ++i)
+    {
+        SDL_Rect dst;
+        dst.x = i % BENCH_SCREEN_WIDTH;
+        dst.y = (i / BENCH_SCREEN_WIDTH) % BENCH_SCREEN_HEIGHT;
+        dst.w = tex.width;
+        dst.h = tex.height;
+        SDL_RenderCopy(renderer, tex.texture, NULL, &dst);
+        if (i % DRAWS_PER_FRAME == 0)
+        {
+            SDL_RenderPresent(renderer);
+        }
+    }
+    reportResult(std::cout, "draw_with_cached_size", NUM_DRAWS, timer.seconds(), "draws");
+
+    // Keeps the metadata loops from being optimized out
+    if (checksum == 0)
+    {
+        std::cout << "unexpected empty texture" << std::endl;
+    }
+
+    cleanup(tex.texture, renderer, window);
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include <SDL2/SDL_image.h>
+#include "render_helpers.h"
+#include "profiler.h"
+
+void logSDLError(std::ostream &os, const std::string &msg)
+{
+    os << msg << SDL_GetError() << std::endl;
+}
+
+Texture loadTexture(const std::string &file, SDL_Renderer *ren)
+{
+    SDL_Texture *texture = IMG_LoadTexture(ren, file.c_str());
+    if (texture == nullptr)
+    {
+        logSDLError(std::cout, "LoadTexture");
+    }
+    return makeTexture(texture);
+}
+
+void renderTexture(const Texture &tex, SDL_Renderer *ren, int x, int y, int w, int h)
+{
+    // Setup the destination rectangle to be at the position we want
+    SDL_Rect dst;
+    dst.x = x;
+    dst.y = y;
+    dst.w = w;
+    dst.h = h;
+    renderTexture(tex, ren, dst);
+}
+
+void renderTexture(const Texture &tex, SDL_Renderer *ren, SDL_Rect dst, const SDL_Rect *clip)
+{
+    // Without a clip only the part of the texture that holds the image
+    // is drawn, pooled textures can be bigger than that
+    SDL_Rect content = {0, 0, tex.width, tex.height};
+    SDL_RenderCopy(ren, tex.texture, clip != nullptr ? clip : &content, &dst);
+    PROFILE_DRAW_CALL();
+}
+
+void renderTexture(const Texture &tex, SDL_Renderer *ren, int x, int y, const SDL_Rect *clip)
+{
+    SDL_Rect dst;
+    dst.x = x;
+    dst.y = y;
+    if (clip != nullptr)
+    {
+        dst.w = clip->w;
+        dst.h = clip->h;
+    }
+    else
+    {
+        dst.w = tex.width;
+        dst.h = tex.height;
+    }
+
+    renderTexture(tex, ren, dst, clip);
+}
@@ -0,0 +1,17 @@
+#include "texture.h"
+
+Texture makeTexture(SDL_Texture *tex)
+{
+    Texture wrapped;
+    wrapped.texture = tex;
+    wrapped.width = 0;
+    wrapped.height = 0;
+    wrapped.format = SDL_PIXELFORMAT_UNKNOWN;
+    wrapped.access = SDL_TEXTUREACCESS_STATIC;
+    if (tex != nullptr)
+    {
+        SDL_QueryTexture(tex, &wrapped.format, &wrapped.access,
+            &wrapped.width, &wrapped.height);
+    }
+    return wrapped;
+}
@@ -0,0 +1,339 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL2/SDL.h>
+
+// A named run of frames out of a sprite sheet
+struct AnimationClip
+{
+    std::string name;
+
+    // Index of the first frame of the clip in AnimationLibrary::clipFrames()
+    int first;
+    int count;
+    float fps;
+    bool loop;
+};
+
+// The frames of a sprite sheet and the clips built out of them, loaded
+// from a small text file, eg. for lesson5's 2x2 sheet of 100x100 frames:
+//
+//   # frame_w frame_h columns rows order
+//   sheet 100 100 2 2 column_major
+//   # name fps loop|once frames...
+//   clip one 1 once 0
+//   clip cycle 4 loop 0 1 2 3
+//
+// Frames are numbered along rows (row_major) or down columns
+// (column_major) starting from the top left.
+class AnimationLibrary
+{
+public:
+    // Read a sheet layout and its clips from a file
+    // @param file Path of the layout file
+    // @return false if the file could not be read or is malformed
+    bool load(const std::string &file)
+    {
+        std::ifstream in(file.c_str());
+        if (!in)
+        {
+            std::cout << "Could not open animation file " << file << std::endl;
+            return false;
+        }
+
+        std::string line;
+        int line_number = 0;
+        while (std::getline(in, line))
+        {
+            ++line_number;
+            std::istringstream words(line);
+            std::string kind;
+            if (!(words >> kind) || kind[0] == '#')
+            {
+                continue;
+            }
+
+            bool ok = false;
+            if (kind == "sheet")
+            {
+                ok = parseSheet(words);
+            }
+            else if (kind == "clip")
+            {
+                ok = parseClip(words);
+            }
+
+            if (!ok)
+            {
+                std::cout << file << ":" << line_number << ": bad line \""
+                          << line << "\"" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // @return the id of a clip, or -1 if there is no clip with that name
+    int findClip(const std::string &name) const
+    {
+        auto found = clip_ids.find(name);
+        return found != clip_ids.end() ? found->second : -1;
+    }
+
+    const AnimationClip& clip(int id) const
+    {
+        return clips[id];
+    }
+
+    // @return where in the sheet a frame is
+    const SDL_Rect& frame(int index) const
+    {
+        return frames[index];
+    }
+
+    int frameCount() const
+    {
+        return int(frames.size());
+    }
+
+    // @return sheet frame numbers of every clip, back to back
+    const std::vector<int>& clipFrames() const
+    {
+        return clip_frames;
+    }
+
+private:
+    bool parseSheet(std::istringstream &words)
+    {
+        int w, h, columns, rows;
+        std::string order = "row_major";
+        if (!(words >> w >> h >> columns >> rows) || w <= 0 || h <= 0)
+        {
+            return false;
+        }
+        words >> order;
+
+        frames.clear();
+        for (int i = 0; i < columns * rows; ++i)
+        {
+            SDL_Rect rect;
+            if (order == "column_major")
+            {
+                rect.x = (i / rows) * w;
+                rect.y = (i % rows) * h;
+            }
+            else
+            {
+                rect.x = (i % columns) * w;
+                rect.y = (i / columns) * h;
+            }
+            rect.w = w;
+            rect.h = h;
+            frames.push_back(rect);
+        }
+        return true;
+    }
+
+    bool parseClip(std::istringstream &words)
+    {
+        AnimationClip clip;
+        std::string mode;
+        if (!(words >> clip.name >> clip.fps >> mode) || clip.fps <= 0.0f)
+        {
+            return false;
+        }
+        clip.loop = (mode == "loop");
+        clip.first = int(clip_frames.size());
+
+        int index;
+        while (words >> index)
+        {
+            if (index < 0 || index >= int(frames.size()))
+            {
+                return false;
+            }
+            clip_frames.push_back(index);
+        }
+        clip.count = int(clip_frames.size()) - clip.first;
+        if (clip.count == 0)
+        {
+            return false;
+        }
+
+        clip_ids[clip.name] = int(clips.size());
+        clips.push_back(clip);
+        return true;
+    }
+
+    std::vector<SDL_Rect> frames;
+    std::vector<int> clip_frames;
+    std::vector<AnimationClip> clips;
+    std::unordered_map<std::string, int> clip_ids;
+};
+
+// Plays clips from an AnimationLibrary on many sprites at once. State is
+// kept as one array per field (structure of arrays) and each instance
+// caches what it needs from its clip when the clip starts, so update()
+// is a straight branch-free pass over flat arrays that the compiler can
+// vectorize.
+class AnimationSystem
+{
+public:
+    explicit AnimationSystem(const AnimationLibrary &library)
+        : library(library)
+    {
+    }
+
+    // Add an animated sprite
+    // @param clipId The clip to start playing, from findClip
+    // @param x The x coordinate to draw the sprite at
+    // @param y The y coordinate to draw the sprite at
+    // @return the id of the new instance
+    int add(int clipId, float x, float y)
+    {
+        pos_x.push_back(x);
+        pos_y.push_back(y);
+        time.push_back(0.0f);
+        speed.push_back(1.0f);
+        rate.push_back(0.0f);
+        duration.push_back(0.0f);
+        looping.push_back(0.0f);
+        first.push_back(0);
+        last.push_back(0);
+        frame.push_back(0);
+
+        const int id = int(pos_x.size()) - 1;
+        play(id, clipId);
+        return id;
+    }
+
+    // Start an instance on a clip from its first frame
+    void play(int id, int clipId)
+    {
+        const AnimationClip &clip = library.clip(clipId);
+        time[id] = 0.0f;
+        rate[id] = clip.fps;
+        duration[id] = clip.count / clip.fps;
+        looping[id] = clip.loop ? 1.0f : 0.0f;
+        first[id] = clip.first;
+        last[id] = clip.count - 1;
+        frame[id] = library.clipFrames()[clip.first];
+    }
+
+    // Playback speed of one instance, 1 is normal. A negative speed plays
+    // backwards, a clip that does not loop then holds its first frame
+    void setSpeed(int id, float value)
+    {
+        speed[id] = value;
+    }
+
+    void setPosition(int id, float x, float y)
+    {
+        pos_x[id] = x;
+        pos_y[id] = y;
+    }
+
+    // Advance every instance
+    // @param dt Seconds since the last update
+    void update(float dt)
+    {
+        const int n = size();
+        float *t = time.data();
+        const float *s = speed.data();
+        const float *r = rate.data();
+        const float *d = duration.data();
+        const float *l = looping.data();
+        const int *f = first.data();
+        const int *e = last.data();
+        int *local = scratch(n);
+
+        for (int i = 0; i < n; ++i)
+        {
+            float now = t[i] + dt * s[i];
+
+            // Looping clips wrap back into [0, duration), the others
+            // hold at either end and get clamped to [0, last frame] below
+            float wrapped = now - std::floor(now / d[i]) * d[i];
+            float held = now < d[i] ? now : d[i];
+            held = held > 0.0f ? held : 0.0f;
+            now = l[i] > 0.0f ? wrapped : held;
+            t[i] = now;
+
+            int index = int(now * r[i]);
+            index = index > 0 ? index : 0;
+            local[i] = f[i] + (index < e[i] ? index : e[i]);
+        }
+
+        // Second pass for the table lookup, which does not vectorize
+        const int *clip_frames = library.clipFrames().data();
+        for (int i = 0; i < n; ++i)
+        {
+            frame[i] = clip_frames[local[i]];
+        }
+    }
+
+    // Call draw(x, y, clip) for every instance, where clip is the part
+    // of the sheet to show, eg. with the clip-aware renderTexture
+    //   anims.draw([&](int x, int y, SDL_Rect clip)
+    //   {
+    //       renderTexture(sheet, ren, x, y, &clip);
+    //   });
+    template<typename DrawFunc>
+    void draw(DrawFunc draw) const
+    {
+        const int n = size();
+        for (int i = 0; i < n; ++i)
+        {
+            SDL_Rect clip = library.frame(frame[i]);
+            draw(int(pos_x[i]), int(pos_y[i]), clip);
+        }
+    }
+
+    // @return the part of the sheet an instance is currently showing
+    const SDL_Rect& clipOf(int id) const
+    {
+        return library.frame(frame[id]);
+    }
+
+    int size() const
+    {
+        return int(pos_x.size());
+    }
+
+private:
+    int* scratch(int n)
+    {
+        if (int(local_frames.size()) < n)
+        {
+            local_frames.resize(n);
+        }
+        return local_frames.data();
+    }
+
+    const AnimationLibrary &library;
+
+    std::vector<float> pos_x;
+    std::vector<float> pos_y;
+    std::vector<float> time;
+    std::vector<float> speed;
+
+    // Copied from the clip when it starts playing
+    std::vector<float> rate;
+    std::vector<float> duration;
+    std::vector<float> looping;
+    std::vector<int> first;
+    std::vector<int> last;
+
+    // Sheet frame each instance is showing
+    std::vector<int> frame;
+    std::vector<int> local_frames;
+};
+
+#endif
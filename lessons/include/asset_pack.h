@@ -0,0 +1,511 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Everything under a resource directory bundled into one file, so startup
+// opens and maps a single file instead of looking up every asset. Layout,
+// all numbers little endian:
+//
+//   header    "SDLPACK" 0, Uint32 version, Uint32 entry count
+//   index     per entry: Uint64 offset, Uint64 size, Uint32 name length,
+//             name bytes (no terminator)
+//   data      each entry's bytes, starting on a 16 byte boundary
+//
+// Names are paths relative to the packed directory with '/' separators,
+// eg. "lesson5/image.png", the same as get_resource_path(sub_dir) + file.
+const char ASSET_PACK_MAGIC[8] = { 'S', 'D', 'L', 'P', 'A', 'C', 'K', 0 };
+const Uint32 ASSET_PACK_VERSION = 1;
+const Uint64 ASSET_PACK_ALIGN = 16;
+
+// Where one asset lives in the pack
+struct AssetPackEntry
+{
+    std::string name;
+    Uint64 offset;
+    Uint64 size;
+};
+
+// List every file under a directory, recursing into subdirectories
+// @param root The directory to list, ending in a path separator
+// @param prefix Prepended to every name, used for the recursion
+// @param names Filled with paths relative to root, using '/'
+inline void listAssetFiles(const std::string &root, const std::string &prefix,
+    std::vector<std::string> &names)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((root + prefix + "*").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    do
+    {
+        const std::string name = data.cFileName;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            listAssetFiles(root, prefix + name + "/", names);
+        }
+        else
+        {
+            names.push_back(prefix + name);
+        }
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR *dir = opendir((root + prefix).c_str());
+    if (dir == nullptr)
+    {
+        return;
+    }
+    while (dirent *item = readdir(dir))
+    {
+        const std::string name = item->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+        struct stat info;
+        if (stat((root + prefix + name).c_str(), &info) != 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode))
+        {
+            listAssetFiles(root, prefix + name + "/", names);
+        }
+        else
+        {
+            names.push_back(prefix + name);
+        }
+    }
+    closedir(dir);
+#endif
+}
+
+// Write a pack holding the given files
+// @param root Directory the names are relative to, ending in a separator
+// @param names Files to pack, relative to root
+// @param file Path of the pack to write
+// @return false if a file could not be read or the pack written
+inline bool writeAssetPack(const std::string &root, std::vector<std::string> names,
+    const std::string &file)
+{
+    // Sorted so the same tree always gives the same pack
+    std::sort(names.begin(), names.end());
+
+    std::vector<AssetPackEntry> entries(names.size());
+    Uint64 index_size = 16;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        std::ifstream in((root + names[i]).c_str(), std::ios::binary | std::ios::ate);
+        if (!in)
+        {
+            std::cout << "Could not open asset " << root + names[i] << std::endl;
+            return false;
+        }
+        entries[i].name = names[i];
+        entries[i].size = Uint64(in.tellg());
+        index_size += 8 + 8 + 4 + names[i].size();
+    }
+
+    Uint64 offset = index_size;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        offset = (offset + ASSET_PACK_ALIGN - 1) / ASSET_PACK_ALIGN * ASSET_PACK_ALIGN;
+        entries[i].offset = offset;
+        offset += entries[i].size;
+    }
+
+    std::ofstream out(file.c_str(), std::ios::binary);
+    if (!out)
+    {
+        std::cout << "Could not create asset pack " << file << std::endl;
+        return false;
+    }
+
+    const Uint32 version = SDL_SwapLE32(ASSET_PACK_VERSION);
+    const Uint32 count = SDL_SwapLE32(Uint32(entries.size()));
+    out.write(ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC));
+    out.write((const char*)&version, 4);
+    out.write((const char*)&count, 4);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        const Uint64 entry_offset = SDL_SwapLE64(entries[i].offset);
+        const Uint64 entry_size = SDL_SwapLE64(entries[i].size);
+        const Uint32 name_length = SDL_SwapLE32(Uint32(entries[i].name.size()));
+        out.write((const char*)&entry_offset, 8);
+        out.write((const char*)&entry_size, 8);
+        out.write((const char*)&name_length, 4);
+        out.write(entries[i].name.data(), entries[i].name.size());
+    }
+
+    std::vector<char> bytes;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        while (Uint64(out.tellp()) < entries[i].offset)
+        {
+            out.put(0);
+        }
+        std::ifstream in((root + entries[i].name).c_str(), std::ios::binary);
+        bytes.resize(size_t(entries[i].size));
+        if (!in.read(bytes.data(), bytes.size()))
+        {
+            std::cout << "Could not read asset " << root + entries[i].name << std::endl;
+            return false;
+        }
+        out.write(bytes.data(), bytes.size());
+    }
+
+    if (!out)
+    {
+        std::cout << "Could not write asset pack " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// A pack file mapped into memory. Assets are handed out as read only
+// SDL_RWops pointing straight into the mapping, so SDL_image and SDL_ttf
+// decode from the page cache without a copy or any per-asset file
+// lookups. The pack has to stay open while anything reads from those
+// RWops, fonts in particular keep reading from theirs until closed.
+class AssetPack
+{
+public:
+    AssetPack()
+        : data(nullptr), size(0)
+#ifdef _WIN32
+        , file_handle(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+    {
+    }
+
+    ~AssetPack()
+    {
+        close();
+    }
+
+    // Map a pack and read its index
+    // @param file Path of the pack
+    // @return false if the file could not be mapped or is not a pack
+    bool open(const std::string &file)
+    {
+        close();
+        if (!map(file))
+        {
+            std::cout << "Could not map asset pack " << file << std::endl;
+            return false;
+        }
+        if (!readIndex())
+        {
+            std::cout << file << " is not a valid asset pack" << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        entries.clear();
+        entry_ids.clear();
+        unmap();
+    }
+
+    bool isOpen() const
+    {
+        return data != nullptr;
+    }
+
+    // @return the entry for an asset, or nullptr if it is not in the pack
+    const AssetPackEntry* find(const std::string &name) const
+    {
+        auto found = entry_ids.find(name);
+        return found != entry_ids.end() ? &entries[found->second] : nullptr;
+    }
+
+    // @return a pointer to the bytes of an asset, or nullptr if it is not
+    //         in the pack
+    const void* bytes(const std::string &name, size_t *length = nullptr) const
+    {
+        const AssetPackEntry *entry = find(name);
+        if (entry == nullptr)
+        {
+            return nullptr;
+        }
+        if (length != nullptr)
+        {
+            *length = size_t(entry->size);
+        }
+        return data + entry->offset;
+    }
+
+    // Open an asset for reading without copying it
+    // @param name Path of the asset inside the pack
+    // @return a read only SDL_RWops over the asset, or nullptr if it is
+    //         not in the pack or too big for SDL_RWFromConstMem, which
+    //         takes an int size. Free it with SDL_RWclose or pass it to
+    //         a loader that takes ownership.
+    SDL_RWops* openRW(const std::string &name) const
+    {
+        size_t length = 0;
+        const void *asset = bytes(name, &length);
+        if (asset == nullptr)
+        {
+            std::cout << "Asset not in pack " << name << std::endl;
+            return nullptr;
+        }
+        if (length > size_t(INT_MAX))
+        {
+            std::cout << "Asset too big to open " << name << std::endl;
+            return nullptr;
+        }
+        return SDL_RWFromConstMem(asset, int(length));
+    }
+
+    const std::vector<AssetPackEntry>& getEntries() const
+    {
+        return entries;
+    }
+
+private:
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    bool map(const std::string &file)
+    {
+#ifdef _WIN32
+        file_handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_handle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0)
+        {
+            unmap();
+            return false;
+        }
+        mapping = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            unmap();
+            return false;
+        }
+        data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        size = size_t(file_size.QuadPart);
+#else
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void *mapped = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps the file alive, the descriptor is not needed
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            return false;
+        }
+        data = (const char*)mapped;
+        size = size_t(info.st_size);
+#endif
+        if (data == nullptr)
+        {
+            unmap();
+            return false;
+        }
+        return true;
+    }
+
+    void unmap()
+    {
+#ifdef _WIN32
+        if (data != nullptr)
+        {
+            UnmapViewOfFile(data);
+        }
+        if (mapping != nullptr)
+        {
+            CloseHandle(mapping);
+        }
+        if (file_handle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_handle);
+        }
+        mapping = nullptr;
+        file_handle = INVALID_HANDLE_VALUE;
+#else
+        if (data != nullptr)
+        {
+            munmap((void*)data, size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    // Little endian values may not be aligned in the index, so copy
+    // them out rather than casting the pointer
+    template<typename T>
+    bool readValue(size_t &at, T &value) const
+    {
+        if (at + sizeof(T) > size)
+        {
+            return false;
+        }
+        std::memcpy(&value, data + at, sizeof(T));
+        at += sizeof(T);
+        return true;
+    }
+
+    bool readIndex()
+    {
+        if (size < 16 || std::memcmp(data, ASSET_PACK_MAGIC, sizeof(ASSET_PACK_MAGIC)) != 0)
+        {
+            return false;
+        }
+
+        size_t at = sizeof(ASSET_PACK_MAGIC);
+        Uint32 version, count;
+        if (!readValue(at, version) || !readValue(at, count) ||
+            SDL_SwapLE32(version) != ASSET_PACK_VERSION)
+        {
+            return false;
+        }
+        count = SDL_SwapLE32(count);
+
+        // Every entry takes at least its offset, size and name length, so
+        // a count the rest of the file cannot hold is corrupt. Checked
+        // before resizing so a bad count cannot ask for gigabytes
+        const size_t min_entry = sizeof(Uint64) + sizeof(Uint64) + sizeof(Uint32);
+        if (count > (size - at) / min_entry)
+        {
+            return false;
+        }
+
+        entries.resize(count);
+        for (Uint32 i = 0; i < count; ++i)
+        {
+            AssetPackEntry &entry = entries[i];
+            Uint32 name_length;
+            if (!readValue(at, entry.offset) || !readValue(at, entry.size) ||
+                !readValue(at, name_length))
+            {
+                return false;
+            }
+            entry.offset = SDL_SwapLE64(entry.offset);
+            entry.size = SDL_SwapLE64(entry.size);
+            name_length = SDL_SwapLE32(name_length);
+            if (at + name_length > size || entry.offset > size ||
+                entry.size > size - entry.offset)
+            {
+                return false;
+            }
+            entry.name.assign(data + at, name_length);
+            at += name_length;
+            entry_ids[entry.name] = i;
+        }
+        return true;
+    }
+
+    const char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file_handle;
+    HANDLE mapping;
+#endif
+    std::vector<AssetPackEntry> entries;
+    std::unordered_map<std::string, size_t> entry_ids;
+};
+
+// Loads an image out of a pack into a texture on the rendering device
+// @param pack The open pack to load from
+// @param name Path of the image inside the pack
+// @param ren The renderer to load the texture onto
+// @return the loaded texture, or nullptr if something went wrong
+inline SDL_Texture* loadPackedTexture(const AssetPack &pack, const std::string &name,
+    SDL_Renderer *ren)
+{
+    SDL_RWops *rw = pack.openRW(name);
+    if (rw == nullptr)
+    {
+        return nullptr;
+    }
+    SDL_Texture *texture = IMG_LoadTexture_RW(ren, rw, 1);
+    if (texture == nullptr)
+    {
+        std::cout << "IMG_LoadTexture_RW" << SDL_GetError() << std::endl;
+    }
+    return texture;
+}
+
+// Loads a BMP out of a pack into a surface
+// @return the loaded surface, or nullptr if something went wrong
+inline SDL_Surface* loadPackedBMP(const AssetPack &pack, const std::string &name)
+{
+    SDL_RWops *rw = pack.openRW(name);
+    if (rw == nullptr)
+    {
+        return nullptr;
+    }
+    SDL_Surface *surface = SDL_LoadBMP_RW(rw, 1);
+    if (surface == nullptr)
+    {
+        std::cout << "SDL_LoadBMP_RW" << SDL_GetError() << std::endl;
+    }
+    return surface;
+}
+
+// Opens a font out of a pack. The font reads glyphs from the pack for as
+// long as it is open, so close it before the pack.
+// @return the opened font, or nullptr if something went wrong
+inline TTF_Font* openPackedFont(const AssetPack &pack, const std::string &name, int fontSize)
+{
+    SDL_RWops *rw = pack.openRW(name);
+    if (rw == nullptr)
+    {
+        return nullptr;
+    }
+    TTF_Font *font = TTF_OpenFontRW(rw, 1, fontSize);
+    if (font == nullptr)
+    {
+        std::cout << "TTF_OpenFontRW" << SDL_GetError() << std::endl;
+    }
+    return font;
+}
+
+#endif
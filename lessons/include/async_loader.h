@@ -0,0 +1,290 @@
+#ifndef ASYNC_LOADER_H
+#define ASYNC_LOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+// Progress of a single file going through the AsyncImageLoader
+struct ImageLoadState
+{
+    std::string path;
+
+    // Written by a worker thread, read by the render thread once the
+    // request has come back through the decoded queue
+    SDL_Surface *surface;
+
+    // Only ever touched on the render thread
+    SDL_Texture *texture;
+    bool done;
+    bool failed;
+};
+
+// Handle to an image that has been queued with AsyncImageLoader::load.
+// Only use it from the thread that owns the renderer.
+class ImageLoadHandle
+{
+public:
+    ImageLoadHandle()
+    {
+    }
+
+    explicit ImageLoadHandle(const std::shared_ptr<ImageLoadState> &state)
+        : state(state)
+    {
+    }
+
+    // @return true once the image has been decoded and uploaded (or failed)
+    bool ready() const
+    {
+        return state && state->done;
+    }
+
+    // @return true if the image could not be decoded or uploaded
+    bool failed() const
+    {
+        return state && state->failed;
+    }
+
+    // Take ownership of the loaded texture. The caller is responsible
+    // for freeing it with cleanup() like any other texture, and later
+    // calls return nullptr
+    // @return the texture, or nullptr if not ready, failed or already taken
+    SDL_Texture* take()
+    {
+        if (!ready())
+        {
+            return nullptr;
+        }
+        SDL_Texture *texture = state->texture;
+        state->texture = nullptr;
+        return texture;
+    }
+
+    // @return the file this handle is loading, empty for a default
+    // constructed handle
+    const std::string& path() const
+    {
+        static const std::string no_path;
+        return state ? state->path : no_path;
+    }
+
+private:
+    std::shared_ptr<ImageLoadState> state;
+};
+
+// Decodes image files into surfaces with IMG_Load on a pool of worker
+// threads. The renderer is not thread safe, so turning the surfaces into
+// textures is left to the render thread, which picks them up in batches
+// by calling uploadReady (eg. once per frame) or finishAll.
+class AsyncImageLoader
+{
+public:
+    // @param ren The renderer textures will be created on
+    // @param numThreads How many decode threads to start, 0 for one per CPU
+    explicit AsyncImageLoader(SDL_Renderer *ren, int numThreads = 0)
+        : renderer(ren), in_flight(0), stopping(false)
+    {
+        if (numThreads <= 0)
+        {
+            numThreads = SDL_GetCPUCount();
+        }
+        for (int i = 0; i < numThreads; ++i)
+        {
+            workers.push_back(std::thread(&AsyncImageLoader::workerLoop, this));
+        }
+    }
+
+    // Stops the workers and frees any surfaces that were never uploaded.
+    // Textures that were uploaded but never taken are destroyed too.
+    ~AsyncImageLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_ready.notify_all();
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+
+        for (size_t i = 0; i < decoded.size(); ++i)
+        {
+            if (decoded[i]->surface != nullptr)
+            {
+                SDL_FreeSurface(decoded[i]->surface);
+            }
+        }
+        for (size_t i = 0; i < uploaded.size(); ++i)
+        {
+            if (uploaded[i]->texture != nullptr)
+            {
+                SDL_DestroyTexture(uploaded[i]->texture);
+            }
+        }
+    }
+
+    // Queue a file to be decoded in the background
+    // @param file The image file to load
+    // @return a handle that becomes ready after a later uploadReady call
+    ImageLoadHandle load(const std::string &file)
+    {
+        std::shared_ptr<ImageLoadState> state(new ImageLoadState());
+        state->path = file;
+        state->surface = nullptr;
+        state->texture = nullptr;
+        state->done = false;
+        state->failed = false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(state);
+            ++in_flight;
+        }
+        work_ready.notify_one();
+        return ImageLoadHandle(state);
+    }
+
+    // Create textures for images the workers have finished decoding.
+    // Must be called on the thread that owns the renderer.
+    // @param maxTextures Upload at most this many textures, -1 for no limit
+    // @return how many requests were completed by this call
+    int uploadReady(int maxTextures = -1)
+    {
+        std::vector<std::shared_ptr<ImageLoadState> > batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (!decoded.empty() && (maxTextures < 0 || int(batch.size()) < maxTextures))
+            {
+                batch.push_back(decoded.front());
+                decoded.pop_front();
+            }
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            ImageLoadState &state = *batch[i];
+            if (state.surface == nullptr)
+            {
+                std::cout << "IMG_Load " << state.path << std::endl;
+                state.failed = true;
+            }
+            else
+            {
+                state.texture = SDL_CreateTextureFromSurface(renderer, state.surface);
+                SDL_FreeSurface(state.surface);
+                state.surface = nullptr;
+                if (state.texture == nullptr)
+                {
+                    std::cout << "CreateTextureFromSurface" << SDL_GetError() << std::endl;
+                    state.failed = true;
+                }
+            }
+            state.done = true;
+            uploaded.push_back(batch[i]);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            in_flight -= int(batch.size());
+        }
+        forgetTaken();
+        return int(batch.size());
+    }
+
+    // Block until everything queued so far has been decoded and uploaded
+    void finishAll()
+    {
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (in_flight == 0)
+                {
+                    return;
+                }
+                decode_done.wait(lock, [this] { return !decoded.empty(); });
+            }
+            uploadReady();
+        }
+    }
+
+    // @return how many requests have not been uploaded yet
+    int getInFlight()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return in_flight;
+    }
+
+private:
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::shared_ptr<ImageLoadState> state;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_ready.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (stopping)
+                {
+                    return;
+                }
+                state = pending.front();
+                pending.pop_front();
+            }
+
+            // The slow part, done without holding the lock
+            state->surface = IMG_Load(state->path.c_str());
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                decoded.push_back(state);
+            }
+            decode_done.notify_one();
+        }
+    }
+
+    // Stop tracking uploaded textures whose owner has taken them, so the
+    // destructor only frees textures nobody claimed
+    void forgetTaken()
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < uploaded.size(); ++i)
+        {
+            if (uploaded[i]->texture != nullptr && uploaded[i].use_count() > 1)
+            {
+                uploaded[kept++] = uploaded[i];
+            }
+            else if (uploaded[i]->texture != nullptr)
+            {
+                // Every handle is gone, nobody can take it any more
+                SDL_DestroyTexture(uploaded[i]->texture);
+            }
+        }
+        uploaded.resize(kept);
+    }
+
+    AsyncImageLoader(const AsyncImageLoader&) = delete;
+    AsyncImageLoader& operator=(const AsyncImageLoader&) = delete;
+
+    SDL_Renderer *renderer;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable decode_done;
+    std::deque<std::shared_ptr<ImageLoadState> > pending;
+    std::deque<std::shared_ptr<ImageLoadState> > decoded;
+    std::vector<std::shared_ptr<ImageLoadState> > uploaded;
+    int in_flight;
+    bool stopping;
+};
+
+#endif
@@ -0,0 +1,463 @@
+#ifndef ATLAS_PACKER_H
+#define ATLAS_PACKER_H
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "texture.h"
+
+// Packs rectangles into a fixed size page using the skyline bottom-left
+// heuristic: the page keeps a list of horizontal segments making up the
+// top edge of everything placed so far, and each rectangle goes where
+// its top would end up lowest.
+class SkylinePacker
+{
+public:
+    // @param width Width of the page in pixels
+    // @param height Height of the page in pixels
+    SkylinePacker(int width, int height)
+        : width(width), height(height)
+    {
+        SkylineNode node = {0, 0, width};
+        skyline.push_back(node);
+    }
+
+    // Find room for a rectangle and claim it
+    // @param w Width of the rectangle
+    // @param h Height of the rectangle
+    // @param out Filled with where the rectangle was placed
+    // @return false if it does not fit in what is left of the page
+    bool insert(int w, int h, SDL_Rect *out)
+    {
+        int best_index = -1;
+        int best_top = height + 1;
+        int best_width = width + 1;
+        int best_y = 0;
+
+        for (size_t i = 0; i < skyline.size(); ++i)
+        {
+            int y;
+            if (!fits(i, w, h, &y))
+            {
+                continue;
+            }
+            if (y + h < best_top || (y + h == best_top && skyline[i].width < best_width))
+            {
+                best_index = int(i);
+                best_top = y + h;
+                best_width = skyline[i].width;
+                best_y = y;
+            }
+        }
+
+        if (best_index < 0)
+        {
+            return false;
+        }
+
+        out->x = skyline[best_index].x;
+        out->y = best_y;
+        out->w = w;
+        out->h = h;
+        addLevel(best_index, *out);
+        return true;
+    }
+
+private:
+    struct SkylineNode
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    // Can a w x h rectangle sit with its left edge on node i?
+    // @param y Filled with how high it would have to sit
+    bool fits(size_t i, int w, int h, int *y) const
+    {
+        const int x = skyline[i].x;
+        if (x + w > width)
+        {
+            return false;
+        }
+
+        int top = 0;
+        int remaining = w;
+        while (remaining > 0)
+        {
+            if (i >= skyline.size())
+            {
+                return false;
+            }
+            top = std::max(top, skyline[i].y);
+            if (top + h > height)
+            {
+                return false;
+            }
+            remaining -= skyline[i].width;
+            ++i;
+        }
+
+        *y = top;
+        return true;
+    }
+
+    // Raise the skyline over a newly placed rectangle
+    void addLevel(int index, const SDL_Rect &rect)
+    {
+        SkylineNode node = {rect.x, rect.y + rect.h, rect.w};
+        skyline.insert(skyline.begin() + index, node);
+
+        // Trim or drop the nodes the new one now covers
+        for (size_t i = index + 1; i < skyline.size(); )
+        {
+            const SkylineNode &prev = skyline[i - 1];
+            SkylineNode &cur = skyline[i];
+            const int prev_end = prev.x + prev.width;
+            if (cur.x >= prev_end)
+            {
+                break;
+            }
+
+            const int shrink = prev_end - cur.x;
+            cur.x += shrink;
+            cur.width -= shrink;
+            if (cur.width <= 0)
+            {
+                skyline.erase(skyline.begin() + i);
+                continue;
+            }
+            break;
+        }
+
+        // Merge neighbours at the same height
+        for (size_t i = 0; i + 1 < skyline.size(); )
+        {
+            if (skyline[i].y == skyline[i + 1].y)
+            {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    int width;
+    int height;
+    std::vector<SkylineNode> skyline;
+};
+
+// Where one image ended up inside an atlas
+struct AtlasRegion
+{
+    int page;
+    SDL_Rect clip;
+};
+
+// One image as stored in an atlas: the page texture to draw from and the
+// part of it to draw. Pass both to the clip-aware renderTexture, eg.
+//   renderTexture(sprite.page, ren, x, y, &sprite.clip);
+struct AtlasSprite
+{
+    Texture page;
+    SDL_Rect clip;
+};
+
+// A set of page surfaces with many images packed into them, along with
+// where each image went. Built either from loose files at runtime with
+// buildAtlas, or loaded back from a manifest written by writeAtlas (see
+// the SDL_AtlasPack tool).
+struct AtlasLayout
+{
+    std::vector<SDL_Surface*> pages;
+    std::unordered_map<std::string, AtlasRegion> regions;
+};
+
+// Free the page surfaces of a layout
+inline void freeAtlasLayout(AtlasLayout &layout)
+{
+    for (size_t i = 0; i < layout.pages.size(); ++i)
+    {
+        SDL_FreeSurface(layout.pages[i]);
+    }
+    layout.pages.clear();
+    layout.regions.clear();
+}
+
+// Pack loose image files into as few pages as possible
+// @param names Name to store each image under, eg. "lesson3/image.png"
+// @param files Path of each image, loaded with IMG_Load
+// @param pageSize Width and height of each page
+// @param padding Empty pixels to leave around each image so filtering
+//                does not bleed neighbours into each other
+// @param layout Filled with the pages and regions
+// @return false if an image failed to load or is too big for a page
+inline bool buildAtlas(const std::vector<std::string> &names, const std::vector<std::string> &files,
+    int pageSize, int padding, AtlasLayout &layout)
+{
+    std::vector<SDL_Surface*> images(files.size(), nullptr);
+    bool ok = true;
+    for (size_t i = 0; i < files.size() && ok; ++i)
+    {
+        images[i] = IMG_Load(files[i].c_str());
+        if (images[i] == nullptr)
+        {
+            std::cout << "IMG_Load " << files[i] << " " << SDL_GetError() << std::endl;
+            ok = false;
+        }
+        else if (images[i]->w + padding * 2 > pageSize || images[i]->h + padding * 2 > pageSize)
+        {
+            std::cout << files[i] << " does not fit in a " << pageSize << " page" << std::endl;
+            ok = false;
+        }
+    }
+
+    // Tallest first packs noticeably tighter with a skyline
+    std::vector<size_t> order;
+    for (size_t i = 0; i < files.size() && ok; ++i)
+    {
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&images](size_t a, size_t b)
+    {
+        return images[a]->h > images[b]->h;
+    });
+
+    std::vector<SkylinePacker> packers;
+    for (size_t n = 0; n < order.size() && ok; ++n)
+    {
+        SDL_Surface *image = images[order[n]];
+        SDL_Rect slot = {0, 0, 0, 0};
+        size_t page = 0;
+        while (page < packers.size() &&
+               !packers[page].insert(image->w + padding * 2, image->h + padding * 2, &slot))
+        {
+            ++page;
+        }
+
+        if (page == packers.size())
+        {
+            packers.push_back(SkylinePacker(pageSize, pageSize));
+            SDL_Surface *surf = SDL_CreateRGBSurfaceWithFormat(0, pageSize, pageSize, 32,
+                SDL_PIXELFORMAT_ARGB8888);
+            if (surf == nullptr)
+            {
+                std::cout << "CreateRGBSurface" << SDL_GetError() << std::endl;
+                ok = false;
+                break;
+            }
+            SDL_FillRect(surf, NULL, 0);
+            layout.pages.push_back(surf);
+            packers.back().insert(image->w + padding * 2, image->h + padding * 2, &slot);
+        }
+
+        AtlasRegion region;
+        region.page = int(page);
+        region.clip.x = slot.x + padding;
+        region.clip.y = slot.y + padding;
+        region.clip.w = image->w;
+        region.clip.h = image->h;
+
+        // Copy the pixels as they are, including alpha. Color keyed
+        // pixels are skipped, leaving them transparent in the page
+        SDL_SetSurfaceBlendMode(image, SDL_BLENDMODE_NONE);
+        SDL_Rect dst = region.clip;
+        SDL_BlitSurface(image, NULL, layout.pages[page], &dst);
+        layout.regions[names[order[n]]] = region;
+    }
+
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        if (images[i] != nullptr)
+        {
+            SDL_FreeSurface(images[i]);
+        }
+    }
+    if (!ok)
+    {
+        freeAtlasLayout(layout);
+    }
+    return ok;
+}
+
+// Save the pages as PNGs and the regions as a manifest next to them.
+// The manifest is plain text, first the page count and page files,
+// then one "name page x y w h" line per image.
+// @param layout The atlas to save
+// @param dir Directory to write to, ending in a path separator
+// @param name Base name for the manifest and pages, eg. "atlas" gives
+//             atlas.txt, atlas0.png, atlas1.png...
+// @return false if anything failed to write
+inline bool writeAtlas(const AtlasLayout &layout, const std::string &dir, const std::string &name)
+{
+    std::ofstream manifest((dir + name + ".txt").c_str());
+    if (!manifest)
+    {
+        std::cout << "Could not write " << dir << name << ".txt" << std::endl;
+        return false;
+    }
+
+    manifest << "pages " << layout.pages.size() << "\n";
+    for (size_t i = 0; i < layout.pages.size(); ++i)
+    {
+        std::ostringstream file;
+        file << name << i << ".png";
+        if (IMG_SavePNG(layout.pages[i], (dir + file.str()).c_str()) != 0)
+        {
+            std::cout << "IMG_SavePNG" << SDL_GetError() << std::endl;
+            return false;
+        }
+        manifest << file.str() << "\n";
+    }
+
+    // Sorted so the manifest does not change between runs
+    std::vector<std::string> keys;
+    for (auto &entry : layout.regions)
+    {
+        keys.push_back(entry.first);
+    }
+    std::sort(keys.begin(), keys.end());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        const AtlasRegion &region = layout.regions.find(keys[i])->second;
+        manifest << keys[i] << " " << region.page << " "
+                 << region.clip.x << " " << region.clip.y << " "
+                 << region.clip.w << " " << region.clip.h << "\n";
+    }
+    return bool(manifest);
+}
+
+// Page textures plus where each image lives in them, ready to draw
+class TextureAtlas
+{
+public:
+    TextureAtlas()
+    {
+    }
+
+    ~TextureAtlas()
+    {
+        for (size_t i = 0; i < pages.size(); ++i)
+        {
+            SDL_DestroyTexture(pages[i].texture);
+        }
+    }
+
+    // Upload the pages of a layout, taking its regions. The layout's
+    // surfaces are left for the caller to free
+    // @return false if a page could not be turned into a texture
+    bool upload(const AtlasLayout &layout, SDL_Renderer *ren)
+    {
+        for (size_t i = 0; i < layout.pages.size(); ++i)
+        {
+            SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, layout.pages[i]);
+            if (tex == nullptr)
+            {
+                std::cout << "CreateTextureFromSurface" << SDL_GetError() << std::endl;
+                return false;
+            }
+            pages.push_back(makeTexture(tex));
+        }
+        regions = layout.regions;
+        return true;
+    }
+
+    // Load an atlas saved by writeAtlas
+    // @param dir Directory holding the manifest, ending in a path separator
+    // @param name Base name the atlas was saved under
+    // @return false if the manifest or a page failed to load
+    bool load(const std::string &dir, const std::string &name, SDL_Renderer *ren)
+    {
+        std::ifstream manifest((dir + name + ".txt").c_str());
+        std::string word;
+        size_t page_count = 0;
+        if (!(manifest >> word >> page_count) || word != "pages")
+        {
+            std::cout << "Bad atlas manifest " << dir << name << ".txt" << std::endl;
+            return false;
+        }
+
+        for (size_t i = 0; i < page_count; ++i)
+        {
+            std::string file;
+            manifest >> file;
+            SDL_Texture *tex = IMG_LoadTexture(ren, (dir + file).c_str());
+            if (tex == nullptr)
+            {
+                std::cout << "LoadTexture" << SDL_GetError() << std::endl;
+                return false;
+            }
+            pages.push_back(makeTexture(tex));
+        }
+
+        std::string key;
+        AtlasRegion region;
+        while (manifest >> key >> region.page >> region.clip.x >> region.clip.y
+               >> region.clip.w >> region.clip.h)
+        {
+            regions[key] = region;
+        }
+        return true;
+    }
+
+    // Find an image in the atlas
+    // @param name The name the image was packed under
+    // @param sprite Filled with the page and clip to draw
+    // @return false if there is no image with that name, or its page is
+    //         not one of the atlas's pages (eg. a bad manifest)
+    bool find(const std::string &name, AtlasSprite *sprite) const
+    {
+        auto found = regions.find(name);
+        if (found == regions.end() || found->second.page < 0 ||
+            size_t(found->second.page) >= pages.size())
+        {
+            return false;
+        }
+        sprite->page = pages[found->second.page];
+        sprite->clip = found->second.clip;
+        return true;
+    }
+
+    size_t pageCount() const
+    {
+        return pages.size();
+    }
+
+private:
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    std::vector<Texture> pages;
+    std::unordered_map<std::string, AtlasRegion> regions;
+};
+
+// The atlas version of loadTexture: look an image up by name and get
+// back the page and clip to draw it with
+// @param atlas The atlas the image was packed into
+// @param name The name it was packed under
+// @return the sprite, page.texture is nullptr if it was not found
+inline AtlasSprite loadTexture(const TextureAtlas &atlas, const std::string &name)
+{
+    AtlasSprite sprite;
+    if (!atlas.find(name, &sprite))
+    {
+        std::cout << "No image named " << name << " in atlas" << std::endl;
+        sprite.page = makeTexture(nullptr);
+        sprite.clip.x = 0;
+        sprite.clip.y = 0;
+        sprite.clip.w = 0;
+        sprite.clip.h = 0;
+    }
+    return sprite;
+}
+
+#endif
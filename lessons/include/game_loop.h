@@ -0,0 +1,333 @@
+#ifndef GAME_LOOP_H
+#define GAME_LOOP_H
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <SDL2/SDL.h>
+#include "profiler.h"
+#include "input.h"
+#include "replay.h"
+
+// Settings for a GameLoop
+struct GameLoopConfig
+{
+    GameLoopConfig()
+        : update_hz(60.0), max_fps(60), max_updates_per_frame(5),
+          headless_frames(0), offscreen(false)
+    {
+    }
+
+    // How many fixed simulation steps to run per second
+    double update_hz;
+
+    // Most frames to render per second, 0 for no cap (eg. with vsync)
+    int max_fps;
+
+    // Most simulation steps to run before rendering, so a long stall
+    // does not turn into a spiral of catch-up updates
+    int max_updates_per_frame;
+
+    // If more than 0, run exactly this many frames as fast as possible
+    // with one update per frame and no frame cap, then stop. Used to
+    // run scenes for benchmarking.
+    long headless_frames;
+
+    // Render into memory through an OffscreenTarget instead of a window
+    bool offscreen;
+
+    // Record the run to this file if not empty, see ReplayLog
+    std::string record_file;
+
+    // Play back the run recorded in this file if not empty, headless
+    // and offscreen
+    std::string replay_file;
+};
+
+// Look for "--frames N" on the command line and turn on headless mode
+// for N frames if it is there, for "--offscreen" to render into memory
+// instead of a window, and for "--record FILE" and "--replay FILE"
+// @param argc Argument count passed to main
+// @param argv Arguments passed to main
+// @param config The config to update
+inline void parseLoopArgs(int argc, char **argv, GameLoopConfig &config)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            config.headless_frames = std::atol(argv[i + 1]);
+        }
+        if (std::strcmp(argv[i], "--offscreen") == 0)
+        {
+            config.offscreen = true;
+        }
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            config.record_file = argv[i + 1];
+        }
+        if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            // Replays are hashed, which needs the frames in memory
+            config.replay_file = argv[i + 1];
+            config.offscreen = true;
+        }
+    }
+}
+
+// Drives a main loop with simulation updates at a fixed rate, decoupled
+// from how often frames are rendered. Each frame it drains the event
+// queue, runs as many fixed updates as real time calls for, then renders
+// with how far we are between the last update and the next (0 to 1) so
+// the render can interpolate. When frames are capped the loop sleeps
+// until the next frame is due rather than spinning.
+class GameLoop
+{
+public:
+    // Called for every event polled
+    typedef std::function<void(const SDL_Event&)> EventFunc;
+
+    // Called for every fixed step, with the step length in seconds
+    typedef std::function<void(double)> UpdateFunc;
+
+    // Called once per frame, with the interpolation factor 0 to 1
+    typedef std::function<void(double)> RenderFunc;
+
+    // Called after each frame, returns true if nothing will change
+    // until the next event arrives
+    typedef std::function<bool()> IdleFunc;
+
+    explicit GameLoop(const GameLoopConfig &config = GameLoopConfig())
+        : config(config), running(false), frames(0), updates(0), seconds(0.0),
+          input(nullptr), recorder(nullptr), playback(nullptr)
+    {
+    }
+
+    void onEvent(const EventFunc &func) { event_func = func; }
+    void onUpdate(const UpdateFunc &func) { update_func = func; }
+    void onRender(const RenderFunc &func) { render_func = func; }
+
+    // When the idle check says nothing will change, the loop sleeps in
+    // SDL_WaitEvent instead of waking up every frame, so a static scene
+    // uses next to no CPU. Ignored headless and offscreen, where every
+    // frame is produced and there may be no window to wake the loop.
+    void onIdle(const IdleFunc &func) { idle_func = func; }
+
+    // Drain events through an InputSystem, which updates its action
+    // states before each event is passed on to the event callback. Its
+    // frame starts before events are read and ends after rendering.
+    void setInput(InputSystem *system) { input = system; }
+
+    // Record every frame's events, update count and time into a log.
+    // Draws and hashes are recorded by whoever does them.
+    void setRecorder(ReplayLog *log) { recorder = log; }
+
+    // Feed a recorded run back in: each frame the live event queue is
+    // thrown away and replaced by the frame's recorded events, and the
+    // recorded number of updates is run. Implies headless, the loop
+    // stops after the last recorded frame.
+    void setPlayback(const ReplayLog *log) { playback = log; }
+
+    // Stop the loop after the current frame
+    void quit()
+    {
+        running = false;
+    }
+
+    // Run until quit is called, or for the configured number of
+    // frames in headless mode
+    // @return how many frames were rendered
+    long run()
+    {
+        const double frequency = double(SDL_GetPerformanceFrequency());
+        const double step = 1.0 / config.update_hz;
+        const bool headless = config.headless_frames > 0 || playback != nullptr;
+        const double frame_time = (!headless && config.max_fps > 0) ? 1.0 / config.max_fps : 0.0;
+        const bool can_idle = !headless && !config.offscreen;
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        Uint64 previous = start;
+        double accumulator = 0.0;
+        running = true;
+
+        while (running)
+        {
+            if (playback != nullptr && size_t(frames) >= playback->getFrameCount())
+            {
+                break;
+            }
+
+            PROFILE_FRAME();
+            Uint64 frame_start = SDL_GetPerformanceCounter();
+            const long updates_before = updates;
+            if (recorder != nullptr)
+            {
+                recorder->beginFrame();
+            }
+
+            {
+                PROFILE_ZONE("events");
+                if (playback != nullptr)
+                {
+                    SDL_PumpEvents();
+                    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+                    playback->pushEvents(size_t(frames));
+                }
+                if (input != nullptr)
+                {
+                    input->beginFrame();
+                    input->pump([this](const SDL_Event &event)
+                    {
+                        dispatch(event);
+                    });
+                }
+                else
+                {
+                    SDL_Event event;
+                    while (SDL_PollEvent(&event))
+                    {
+                        dispatch(event);
+                    }
+                }
+            }
+
+            {
+                PROFILE_ZONE("update");
+                if (playback != nullptr)
+                {
+                    // As many updates as the recorded frame ran
+                    accumulator = step * playback->frame(size_t(frames)).updates;
+                }
+                else if (headless)
+                {
+                    // Same work every frame no matter how fast we go
+                    accumulator = step;
+                }
+                else
+                {
+                    accumulator += double(frame_start - previous) / frequency;
+                    double max_lag = step * config.max_updates_per_frame;
+                    if (accumulator > max_lag)
+                    {
+                        accumulator = max_lag;
+                    }
+                }
+                previous = frame_start;
+
+                while (accumulator >= step)
+                {
+                    if (update_func)
+                    {
+                        update_func(step);
+                    }
+                    accumulator -= step;
+                    ++updates;
+                }
+            }
+
+            if (render_func)
+            {
+                render_func(accumulator / step);
+            }
+            if (input != nullptr)
+            {
+                input->endFrame();
+            }
+            if (recorder != nullptr)
+            {
+                recorder->recordUpdates(Uint32(updates - updates_before));
+                recorder->endFrame(Uint32((SDL_GetPerformanceCounter() - frame_start) *
+                    1000000 / SDL_GetPerformanceFrequency()));
+            }
+            ++frames;
+
+            if (config.headless_frames > 0 && frames >= config.headless_frames)
+            {
+                running = false;
+            }
+
+            if (running && can_idle && idle_func && idle_func())
+            {
+                PROFILE_ZONE("idle");
+                SDL_WaitEvent(nullptr);
+
+                // Time spent waiting is not simulation time to catch up on
+                previous = SDL_GetPerformanceCounter();
+                accumulator = 0.0;
+                continue;
+            }
+
+            if (running && frame_time > 0.0)
+            {
+                PROFILE_ZONE("sleep");
+                waitUntil(frame_start + Uint64(frame_time * frequency));
+            }
+        }
+
+        seconds = double(SDL_GetPerformanceCounter() - start) / frequency;
+        return frames;
+    }
+
+    long getFrames() const { return frames; }
+    long getUpdates() const { return updates; }
+    double getSeconds() const { return seconds; }
+
+    // @return average frames per second of the last run
+    double getFps() const
+    {
+        return seconds > 0.0 ? frames / seconds : 0.0;
+    }
+
+private:
+    void dispatch(const SDL_Event &event)
+    {
+        if (recorder != nullptr)
+        {
+            recorder->recordEvent(event);
+        }
+        if (event_func)
+        {
+            event_func(event);
+        }
+    }
+
+    // Sleep until the performance counter reaches a deadline. SDL_Delay
+    // only has millisecond resolution and can oversleep by about as much
+    // again, so sleep until we are close and spin for the last stretch.
+    static void waitUntil(Uint64 deadline)
+    {
+        const Uint64 frequency = SDL_GetPerformanceFrequency();
+        const Uint64 spin_ticks = frequency / 1000;   // last 1ms
+        Uint64 now = SDL_GetPerformanceCounter();
+        while (now + spin_ticks < deadline)
+        {
+            Uint32 ms = Uint32((deadline - now - spin_ticks) * 1000 / frequency);
+            if (ms == 0)
+            {
+                break;
+            }
+            SDL_Delay(ms);
+            now = SDL_GetPerformanceCounter();
+        }
+        while (now < deadline)
+        {
+            now = SDL_GetPerformanceCounter();
+        }
+    }
+
+    GameLoopConfig config;
+    bool running;
+    long frames;
+    long updates;
+    double seconds;
+    EventFunc event_func;
+    UpdateFunc update_func;
+    RenderFunc render_func;
+    IdleFunc idle_func;
+    InputSystem *input;
+    ReplayLog *recorder;
+    const ReplayLog *playback;
+};
+
+#endif
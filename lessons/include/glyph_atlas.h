@@ -0,0 +1,390 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+// A single glyph that has been rasterized into an atlas
+struct Glyph
+{
+    // Location of the glyph's pixels inside the atlas texture
+    SDL_Rect clip;
+
+    // Horizontal offset from the pen position to draw the glyph at
+    int offset_x;
+
+    // How far to move the pen after drawing this glyph
+    int advance;
+
+    bool cached;
+};
+
+// Holds every glyph of one font at one size inside a single texture.
+// Glyphs are rasterized the first time they are asked for and packed
+// into the texture in rows (shelves), so drawing a string is just one
+// clipped SDL_RenderCopy per character out of the shared texture.
+// Text is treated as Latin-1, the same as TTF_RenderText.
+class GlyphAtlas
+{
+public:
+    // @param ren The renderer the atlas texture will live on
+    // @param font The font to rasterize glyphs from, the atlas takes
+    //             ownership of it and closes it when destroyed
+    // @param atlasSize Width and height of the atlas texture in pixels
+    GlyphAtlas(SDL_Renderer *ren, TTF_Font *font, int atlasSize = 512)
+        : renderer(ren), font(font), texture(nullptr), size(atlasSize),
+          shelf_x(0), shelf_y(0), shelf_height(0), resets(0)
+    {
+        for (int i = 0; i < NUM_GLYPHS; ++i)
+        {
+            glyphs[i].cached = false;
+        }
+
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STATIC, size, size);
+        if (texture == nullptr)
+        {
+            std::cout << "GlyphAtlas CreateTexture" << SDL_GetError() << std::endl;
+            return;
+        }
+
+        // Glyphs are rasterized in white and tinted with the
+        // texture color mod when drawn
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    }
+
+    ~GlyphAtlas()
+    {
+        if (texture != nullptr)
+        {
+            SDL_DestroyTexture(texture);
+        }
+        TTF_CloseFont(font);
+    }
+
+    // Look up a glyph, rasterizing it into the atlas if this is the
+    // first time it has been used
+    // @param ch The Latin-1 character to look up
+    // @return the cached glyph, or nullptr if it could not be rasterized
+    const Glyph* getGlyph(unsigned char ch)
+    {
+        Glyph &glyph = glyphs[ch];
+        if (glyph.cached)
+        {
+            return &glyph;
+        }
+        return rasterize(ch) ? &glyph : nullptr;
+    }
+
+    // Draw a string with its top left corner at x, y
+    // @param message The text to draw
+    // @param color The color to tint the text with
+    // @param x The x coordinate to draw to
+    // @param y The y coordinate to draw to
+    // @return the width in pixels of the text that was drawn
+    int drawText(const std::string &message, SDL_Color color, int x, int y)
+    {
+        if (texture == nullptr)
+        {
+            return 0;
+        }
+
+        SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+        SDL_SetTextureAlphaMod(texture, color.a);
+
+        int pen_x = x;
+        Uint16 prev = 0;
+        for (size_t i = 0; i < message.size(); ++i)
+        {
+            unsigned char ch = static_cast<unsigned char>(message[i]);
+            const Glyph *glyph = getGlyph(ch);
+            if (glyph == nullptr)
+            {
+                continue;
+            }
+
+            if (prev != 0)
+            {
+                pen_x += TTF_GetFontKerningSizeGlyphs(font, prev, ch);
+            }
+
+            if (glyph->clip.w > 0)
+            {
+                SDL_Rect dst;
+                dst.x = pen_x + glyph->offset_x;
+                dst.y = y;
+                dst.w = glyph->clip.w;
+                dst.h = glyph->clip.h;
+                SDL_RenderCopy(renderer, texture, &glyph->clip, &dst);
+            }
+
+            pen_x += glyph->advance;
+            prev = ch;
+        }
+
+        return pen_x - x;
+    }
+
+    // Measure a string without drawing it
+    // @param message The text to measure
+    // @param w Filled with the width of the text in pixels
+    // @param h Filled with the height of the text in pixels
+    void sizeText(const std::string &message, int *w, int *h)
+    {
+        int width = 0;
+        Uint16 prev = 0;
+        for (size_t i = 0; i < message.size(); ++i)
+        {
+            unsigned char ch = static_cast<unsigned char>(message[i]);
+            const Glyph *glyph = getGlyph(ch);
+            if (glyph == nullptr)
+            {
+                continue;
+            }
+            if (prev != 0)
+            {
+                width += TTF_GetFontKerningSizeGlyphs(font, prev, ch);
+            }
+            width += glyph->advance;
+            prev = ch;
+        }
+
+        if (w != nullptr)
+        {
+            *w = width;
+        }
+        if (h != nullptr)
+        {
+            *h = TTF_FontHeight(font);
+        }
+    }
+
+    // Extra space to add between two characters
+    int getKerning(unsigned char prev, unsigned char ch)
+    {
+        return TTF_GetFontKerningSizeGlyphs(font, prev, ch);
+    }
+
+    // @return the height of a line of text in pixels
+    int getLineHeight()
+    {
+        return TTF_FontHeight(font);
+    }
+
+    // The atlas texture, for drawing glyphs from getGlyph directly. Its
+    // color and alpha mod are changed by drawText.
+    SDL_Texture* getTexture() const
+    {
+        return texture;
+    }
+
+    // Number of times the atlas filled up and had to be flushed
+    int getResets() const
+    {
+        return resets;
+    }
+
+private:
+    static const int NUM_GLYPHS = 256;
+
+    // Render a glyph to a surface and copy it into the next free spot
+    // in the atlas. If the atlas is full every cached glyph is dropped
+    // and packing starts over from the top left corner.
+    bool rasterize(unsigned char ch)
+    {
+        if (texture == nullptr)
+        {
+            return false;
+        }
+
+        int min_x, max_x, min_y, max_y, advance;
+        if (TTF_GlyphMetrics(font, ch, &min_x, &max_x, &min_y, &max_y, &advance) != 0)
+        {
+            return false;
+        }
+
+        Glyph &glyph = glyphs[ch];
+        glyph.offset_x = min_x < 0 ? min_x : 0;
+        glyph.advance = advance;
+        glyph.clip.x = 0;
+        glyph.clip.y = 0;
+        glyph.clip.w = 0;
+        glyph.clip.h = 0;
+
+        // Whitespace has nothing to draw, only an advance
+        SDL_Color white = {255, 255, 255, 255};
+        SDL_Surface *rendered = TTF_RenderGlyph_Blended(font, ch, white);
+        if (rendered == nullptr)
+        {
+            glyph.cached = true;
+            return true;
+        }
+
+        SDL_Surface *surf = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(rendered);
+        if (surf == nullptr)
+        {
+            std::cout << "GlyphAtlas ConvertSurface" << SDL_GetError() << std::endl;
+            return false;
+        }
+
+        if (surf->w > size || surf->h > size)
+        {
+            SDL_FreeSurface(surf);
+            return false;
+        }
+
+        // Move down to a new shelf if this row is out of space,
+        // and start over if the whole atlas is out of space
+        if (shelf_x + surf->w > size)
+        {
+            shelf_x = 0;
+            shelf_y += shelf_height;
+            shelf_height = 0;
+        }
+        if (shelf_y + surf->h > size)
+        {
+            flush();
+        }
+
+        glyph.clip.x = shelf_x;
+        glyph.clip.y = shelf_y;
+        glyph.clip.w = surf->w;
+        glyph.clip.h = surf->h;
+        SDL_UpdateTexture(texture, &glyph.clip, surf->pixels, surf->pitch);
+        SDL_FreeSurface(surf);
+
+        shelf_x += glyph.clip.w;
+        if (glyph.clip.h > shelf_height)
+        {
+            shelf_height = glyph.clip.h;
+        }
+
+        glyph.cached = true;
+        return true;
+    }
+
+    // Forget every cached glyph and reuse the atlas from the top
+    void flush()
+    {
+        for (int i = 0; i < NUM_GLYPHS; ++i)
+        {
+            glyphs[i].cached = false;
+        }
+        shelf_x = 0;
+        shelf_y = 0;
+        shelf_height = 0;
+        ++resets;
+    }
+
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    SDL_Renderer *renderer;
+    TTF_Font *font;
+    SDL_Texture *texture;
+    int size;
+    int shelf_x;
+    int shelf_y;
+    int shelf_height;
+    int resets;
+    Glyph glyphs[NUM_GLYPHS];
+};
+
+// Owns one GlyphAtlas per (font file, font size) pair, opening each
+// font only the first time it is used. This is the persistent
+// replacement for calling renderText every time a string changes.
+class TextEngine
+{
+public:
+    // @param ren The renderer text will be drawn with
+    explicit TextEngine(SDL_Renderer *ren)
+        : renderer(ren)
+    {
+    }
+
+    ~TextEngine()
+    {
+        for (auto &entry : atlases)
+        {
+            delete entry.second;
+        }
+    }
+
+    // Get the atlas for a font at a given size, opening the font
+    // if it has not been used yet
+    // @param fontFile The font file to use
+    // @param fontSize The point size of the font
+    // @return the atlas for the font, or nullptr if the font failed to open
+    GlyphAtlas* getAtlas(const std::string &fontFile, int fontSize)
+    {
+        const std::string key = fontFile + ":" + std::to_string(fontSize);
+        auto found = atlases.find(key);
+        if (found != atlases.end())
+        {
+            return found->second;
+        }
+
+        TTF_Font *font = TTF_OpenFont(fontFile.c_str(), fontSize);
+        if (font == nullptr)
+        {
+            std::cout << "TTF_OpenFont" << SDL_GetError() << std::endl;
+            return nullptr;
+        }
+
+        GlyphAtlas *atlas = new GlyphAtlas(renderer, font);
+        atlases[key] = atlas;
+        return atlas;
+    }
+
+    // Draw a string with its top left corner at x, y
+    // @param message The message we want to display
+    // @param fontFile The font we want to use to render the text
+    // @param color The color we want the text to be
+    // @param fontSize The size we want the font to be
+    // @param x The x coordinate to draw to
+    // @param y The y coordinate to draw to
+    // @return false if the font could not be opened
+    bool drawText(const std::string &message, const std::string &fontFile,
+        SDL_Color color, int fontSize, int x, int y)
+    {
+        GlyphAtlas *atlas = getAtlas(fontFile, fontSize);
+        if (atlas == nullptr)
+        {
+            return false;
+        }
+        atlas->drawText(message, color, x, y);
+        return true;
+    }
+
+    // Measure a string as it would be drawn by drawText
+    // @return false if the font could not be opened
+    bool sizeText(const std::string &message, const std::string &fontFile,
+        int fontSize, int *w, int *h)
+    {
+        GlyphAtlas *atlas = getAtlas(fontFile, fontSize);
+        if (atlas == nullptr)
+        {
+            return false;
+        }
+        atlas->sizeText(message, w, h);
+        return true;
+    }
+
+    SDL_Renderer* getRenderer() const
+    {
+        return renderer;
+    }
+
+private:
+    TextEngine(const TextEngine&) = delete;
+    TextEngine& operator=(const TextEngine&) = delete;
+
+    SDL_Renderer *renderer;
+    std::unordered_map<std::string, GlyphAtlas*> atlases;
+};
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+
+// Golden images are what a scene is expected to look like, kept small
+// enough to commit: the frame box filtered down to GOLDEN_WIDTH by
+// GOLDEN_HEIGHT RGB pixels, plus a 64 bit perceptual hash. A new render
+// is compared against both with some tolerance, so faster drawing paths
+// that round a little differently still pass while a missing sprite or a
+// wrong color does not. Layout of a golden file, numbers little endian:
+//
+//   header    "SDLGOLDN", Uint32 version, Uint32 width, Uint32 height,
+//             Uint64 hash
+//   pixels    width * height RGB triples, row by row
+const char GOLDEN_MAGIC[8] = { 'S', 'D', 'L', 'G', 'O', 'L', 'D', 'N' };
+const Uint32 GOLDEN_VERSION = 1;
+const int GOLDEN_WIDTH = 80;
+const int GOLDEN_HEIGHT = 60;
+
+// A frame reduced to what is compared
+struct GoldenImage
+{
+    int width;
+    int height;
+
+    // Difference hash: the frame's brightness at 9x8, one bit per pair
+    // of horizontal neighbours set if the left one is brighter
+    Uint64 hash;
+
+    // width * height RGB triples
+    std::vector<Uint8> pixels;
+};
+
+// How far a render may stray from its golden image and still pass
+struct GoldenTolerance
+{
+    GoldenTolerance()
+        : max_hash_distance(4), max_channel_diff(48), max_mean_diff(1.5)
+    {
+    }
+
+    // Most hash bits that may differ, out of 64
+    int max_hash_distance;
+
+    // Most any one channel of any downscaled pixel may differ, 0 to 255
+    int max_channel_diff;
+
+    // Most the channels may differ on average
+    double max_mean_diff;
+};
+
+// How a render compared to its golden image
+struct GoldenResult
+{
+    int hash_distance;
+    int max_channel_diff;
+    double mean_diff;
+    bool passed;
+};
+
+// Average a block of ARGB8888 pixels into one RGB value
+// @param pixels The frame
+// @param pitch Bytes from one row of the frame to the next
+// @param area The block to average, must not be empty
+// @param rgb Filled with the average red, green and blue
+inline void averageBlock(const Uint32 *pixels, int pitch, const SDL_Rect &area, Uint8 rgb[3])
+{
+    Uint32 r = 0;
+    Uint32 g = 0;
+    Uint32 b = 0;
+    for (int y = area.y; y < area.y + area.h; ++y)
+    {
+        const Uint32 *row = reinterpret_cast<const Uint32*>(
+            reinterpret_cast<const Uint8*>(pixels) + y * pitch);
+        for (int x = area.x; x < area.x + area.w; ++x)
+        {
+            r += (row[x] >> 16) & 0xff;
+            g += (row[x] >> 8) & 0xff;
+            b += row[x] & 0xff;
+        }
+    }
+    const Uint32 count = Uint32(area.w * area.h);
+    rgb[0] = Uint8((r + count / 2) / count);
+    rgb[1] = Uint8((g + count / 2) / count);
+    rgb[2] = Uint8((b + count / 2) / count);
+}
+
+// Reduce a frame to a golden image
+// @param pixels The frame's pixels in SDL_PIXELFORMAT_ARGB8888
+// @param pitch Bytes from one row of the frame to the next
+// @param width Width of the frame, at least GOLDEN_WIDTH
+// @param height Height of the frame, at least GOLDEN_HEIGHT
+// @param golden Filled with the reduced frame
+inline void makeGoldenImage(const Uint32 *pixels, int pitch, int width, int height,
+    GoldenImage &golden)
+{
+    golden.width = GOLDEN_WIDTH;
+    golden.height = GOLDEN_HEIGHT;
+    golden.pixels.resize(GOLDEN_WIDTH * GOLDEN_HEIGHT * 3);
+    for (int y = 0; y < GOLDEN_HEIGHT; ++y)
+    {
+        for (int x = 0; x < GOLDEN_WIDTH; ++x)
+        {
+            SDL_Rect area;
+            area.x = x * width / GOLDEN_WIDTH;
+            area.y = y * height / GOLDEN_HEIGHT;
+            area.w = (x + 1) * width / GOLDEN_WIDTH - area.x;
+            area.h = (y + 1) * height / GOLDEN_HEIGHT - area.y;
+            averageBlock(pixels, pitch, area, &golden.pixels[(y * GOLDEN_WIDTH + x) * 3]);
+        }
+    }
+
+    // Brightness at 9x8 from the downscaled image, then compare
+    // neighbours. Gradients survive small changes in exact values
+    int luma[8][9];
+    for (int y = 0; y < 8; ++y)
+    {
+        for (int x = 0; x < 9; ++x)
+        {
+            const int x0 = x * GOLDEN_WIDTH / 9;
+            const int x1 = (x + 1) * GOLDEN_WIDTH / 9;
+            const int y0 = y * GOLDEN_HEIGHT / 8;
+            const int y1 = (y + 1) * GOLDEN_HEIGHT / 8;
+            int total = 0;
+            for (int sy = y0; sy < y1; ++sy)
+            {
+                for (int sx = x0; sx < x1; ++sx)
+                {
+                    const Uint8 *rgb = &golden.pixels[(sy * GOLDEN_WIDTH + sx) * 3];
+                    total += rgb[0] * 299 + rgb[1] * 587 + rgb[2] * 114;
+                }
+            }
+            luma[y][x] = total / ((x1 - x0) * (y1 - y0));
+        }
+    }
+    golden.hash = 0;
+    for (int y = 0; y < 8; ++y)
+    {
+        for (int x = 0; x < 8; ++x)
+        {
+            if (luma[y][x] > luma[y][x + 1])
+            {
+                golden.hash |= Uint64(1) << (y * 8 + x);
+            }
+        }
+    }
+}
+
+// @return how many bits differ between two hashes
+inline int goldenHashDistance(Uint64 a, Uint64 b)
+{
+    Uint64 bits = a ^ b;
+    int count = 0;
+    while (bits != 0)
+    {
+        bits &= bits - 1;
+        ++count;
+    }
+    return count;
+}
+
+// Compare a render against its golden image
+// @param reference The golden image
+// @param image The render, reduced with makeGoldenImage
+// @param tolerance How far the render may stray
+// @return the differences found and whether they are within tolerance
+inline GoldenResult compareGoldenImage(const GoldenImage &reference, const GoldenImage &image,
+    const GoldenTolerance &tolerance = GoldenTolerance())
+{
+    GoldenResult result;
+    result.hash_distance = goldenHashDistance(reference.hash, image.hash);
+    result.max_channel_diff = 0;
+    result.mean_diff = 0.0;
+    if (reference.width != image.width || reference.height != image.height ||
+        reference.pixels.size() != image.pixels.size())
+    {
+        result.max_channel_diff = 255;
+        result.mean_diff = 255.0;
+        result.passed = false;
+        return result;
+    }
+
+    Uint64 total = 0;
+    for (size_t i = 0; i < image.pixels.size(); ++i)
+    {
+        const int diff = std::abs(int(reference.pixels[i]) - int(image.pixels[i]));
+        total += diff;
+        result.max_channel_diff = std::max(result.max_channel_diff, diff);
+    }
+    result.mean_diff = image.pixels.empty() ? 0.0 : double(total) / image.pixels.size();
+    result.passed = result.hash_distance <= tolerance.max_hash_distance &&
+        result.max_channel_diff <= tolerance.max_channel_diff &&
+        result.mean_diff <= tolerance.max_mean_diff;
+    return result;
+}
+
+// Write a golden image to a file
+// @return false if the file could not be written
+inline bool saveGoldenImage(const std::string &file, const GoldenImage &golden)
+{
+    std::ofstream out(file.c_str(), std::ios::binary);
+    if (!out)
+    {
+        std::cout << "Could not create golden image " << file << std::endl;
+        return false;
+    }
+    const Uint32 version = SDL_SwapLE32(GOLDEN_VERSION);
+    const Uint32 width = SDL_SwapLE32(Uint32(golden.width));
+    const Uint32 height = SDL_SwapLE32(Uint32(golden.height));
+    const Uint64 hash = SDL_SwapLE64(golden.hash);
+    out.write(GOLDEN_MAGIC, sizeof(GOLDEN_MAGIC));
+    out.write((const char*)&version, 4);
+    out.write((const char*)&width, 4);
+    out.write((const char*)&height, 4);
+    out.write((const char*)&hash, 8);
+    out.write((const char*)golden.pixels.data(), golden.pixels.size());
+    if (!out)
+    {
+        std::cerr << "Could not write golden image " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Read a golden image written by saveGoldenImage
+// @return false if the file is missing or not a golden image, without
+//         logging, the caller reports which scene it was for
+inline bool loadGoldenImage(const std::string &file, GoldenImage &golden)
+{
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+        std::istreambuf_iterator<char>());
+    const size_t header = sizeof(GOLDEN_MAGIC) + 4 + 4 + 4 + 8;
+    if (bytes.size() < header || std::memcmp(bytes.data(), GOLDEN_MAGIC, sizeof(GOLDEN_MAGIC)) != 0)
+    {
+        return false;
+    }
+
+    Uint32 version, width, height;
+    Uint64 hash;
+    size_t at = sizeof(GOLDEN_MAGIC);
+    std::memcpy(&version, &bytes[at], 4);
+    std::memcpy(&width, &bytes[at + 4], 4);
+    std::memcpy(&height, &bytes[at + 8], 4);
+    std::memcpy(&hash, &bytes[at + 12], 8);
+    width = SDL_SwapLE32(width);
+    height = SDL_SwapLE32(height);
+    if (SDL_SwapLE32(version) != GOLDEN_VERSION || width > 4096 || height > 4096 ||
+        bytes.size() - header != size_t(width) * height * 3)
+    {
+        return false;
+    }
+
+    golden.width = int(width);
+    golden.height = int(height);
+    golden.hash = SDL_SwapLE64(hash);
+    golden.pixels.assign(bytes.begin() + header, bytes.end());
+    return true;
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef HANDLES_H
+#define HANDLES_H
+
+#include <memory>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_ttf.h>
+#include "cleanup.h"
+
+// Fonts are not covered in cleanup.h since most lessons do not use
+// SDL_ttf, it is here so fonts can be cleaned up the same way
+template<>
+inline void cleanup<TTF_Font>(TTF_Font *font)
+{
+    if (!font)
+    {
+        return;
+    }
+    TTF_CloseFont(font);
+}
+
+// Deleter that frees through the matching cleanup() specialization.
+// It has no state, so a handle using it is the size of a raw pointer
+template<typename T>
+struct CleanupDeleter
+{
+    void operator()(T *t) const
+    {
+        cleanup(t);
+    }
+};
+
+// Move-only owner of an SDL object that frees it when it goes out of
+// scope, so early returns no longer need to list everything to clean
+// up. Pools and caches can pass their own deleter to take objects back
+// instead of freeing them. Code that only draws with an object should
+// take the raw pointer from get() rather than the handle, ownership
+// never has to move on the hot path.
+template<typename T, typename Deleter = CleanupDeleter<T> >
+using UniqueHandle = std::unique_ptr<T, Deleter>;
+
+typedef UniqueHandle<SDL_Window> UniqueWindow;
+typedef UniqueHandle<SDL_Renderer> UniqueRenderer;
+typedef UniqueHandle<SDL_Texture> UniqueTexture;
+typedef UniqueHandle<SDL_Surface> UniqueSurface;
+typedef UniqueHandle<TTF_Font> UniqueFont;
+
+// Initializes SDL subsystems for as long as it is in scope. Declare it
+// before any handles so it is destroyed after them.
+class SDLInitGuard
+{
+public:
+    // @param flags The SDL_INIT_* subsystems to start
+    explicit SDLInitGuard(Uint32 flags)
+        : flags(flags), ok(SDL_InitSubSystem(flags) == 0)
+    {
+    }
+
+    ~SDLInitGuard()
+    {
+        if (ok)
+        {
+            SDL_QuitSubSystem(flags);
+        }
+        if (SDL_WasInit(0) == 0)
+        {
+            SDL_Quit();
+        }
+    }
+
+    // @return true if the subsystems started
+    bool good() const
+    {
+        return ok;
+    }
+
+private:
+    SDLInitGuard(const SDLInitGuard&) = delete;
+    SDLInitGuard& operator=(const SDLInitGuard&) = delete;
+
+    Uint32 flags;
+    bool ok;
+};
+
+// Initializes SDL_image loaders for as long as it is in scope
+class ImageInitGuard
+{
+public:
+    // @param flags The IMG_INIT_* loaders that must be available
+    explicit ImageInitGuard(int flags)
+        : ok((IMG_Init(flags) & flags) == flags)
+    {
+    }
+
+    ~ImageInitGuard()
+    {
+        IMG_Quit();
+    }
+
+    // @return true if every requested loader is available
+    bool good() const
+    {
+        return ok;
+    }
+
+private:
+    ImageInitGuard(const ImageInitGuard&) = delete;
+    ImageInitGuard& operator=(const ImageInitGuard&) = delete;
+
+    bool ok;
+};
+
+// Initializes SDL_ttf for as long as it is in scope
+class TTFInitGuard
+{
+public:
+    TTFInitGuard()
+        : ok(TTF_Init() == 0)
+    {
+    }
+
+    ~TTFInitGuard()
+    {
+        if (ok)
+        {
+            TTF_Quit();
+        }
+    }
+
+    // @return true if SDL_ttf started
+    bool good() const
+    {
+        return ok;
+    }
+
+private:
+    TTFInitGuard(const TTFInitGuard&) = delete;
+    TTFInitGuard& operator=(const TTFInitGuard&) = delete;
+
+    bool ok;
+};
+
+#endif
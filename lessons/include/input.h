@@ -0,0 +1,441 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+
+// How many events are taken off the queue per SDL_PeepEvents call
+const int INPUT_EVENT_BATCH = 64;
+
+// Most actions and bindings an InputSystem can hold
+const int INPUT_MAX_ACTIONS = 32;
+const int INPUT_MAX_BINDINGS = 128;
+
+// Most action events per frame whose latency is measured, the rest of a
+// burst is not sampled
+const int INPUT_MAX_PENDING = 64;
+
+// Latencies are kept in 1ms buckets, anything longer lands in the last
+const int INPUT_LATENCY_BUCKETS = 256;
+
+// What an InputBinding listens to
+enum InputDevice
+{
+    INPUT_KEY = 0,
+    INPUT_MOUSE_BUTTON = 1
+};
+
+// A key or mouse button that drives an action
+struct InputBinding
+{
+    int device;
+    Sint32 code;
+    int action;
+
+    // Held down since it was bound, so a release or a rebind knows
+    // whether it is holding its action
+    bool pressed;
+};
+
+// What an action did this frame
+struct ActionState
+{
+    // Held at the end of the frame, by any of its bindings
+    bool down;
+
+    // How many times it was pressed and released during the frame, more
+    // than one if the user is faster than the frame rate. With several
+    // bindings only going from none held to one held is a press, and
+    // back a release
+    Uint8 presses;
+    Uint8 releases;
+
+    // How many of its bindings are held
+    Uint8 held;
+};
+
+// Maps keys and mouse buttons to named actions, eg. "jump" or "quit", so
+// game code asks whether an action happened instead of switching on
+// SDLK_* codes, and bindings can be changed without touching that code.
+//
+// Each frame the event queue is drained in batches with SDL_PeepEvents
+// into a fixed buffer, bound events update the action states, and every
+// event is also handed to a callback for anything else (quit, window
+// events). Actions are defined up front, after that polling and reading
+// action state never allocate.
+//
+// For every press or release that changes an action, the time from the
+// event's timestamp to the end of the frame that handled it is recorded
+// as input latency. SDL timestamps are in milliseconds, so so are the
+// latencies.
+class InputSystem
+{
+public:
+    InputSystem()
+        : num_bindings(0), num_pending(0), frame_events(0)
+    {
+        std::memset(states, 0, sizeof(states));
+        resetLatency();
+    }
+
+    // Add a named action
+    // @param name The name of the action, must be unique
+    // @return the id of the action, or -1 if there are already
+    //         INPUT_MAX_ACTIONS actions
+    int defineAction(const std::string &name)
+    {
+        const int existing = findAction(name);
+        if (existing >= 0)
+        {
+            return existing;
+        }
+        if (int(names.size()) >= INPUT_MAX_ACTIONS)
+        {
+            return -1;
+        }
+        names.push_back(name);
+        return int(names.size()) - 1;
+    }
+
+    // @return the id of a named action, or -1 if there is none
+    int findAction(const std::string &name) const
+    {
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            if (names[i] == name)
+            {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+
+    // @return the name of an action, empty if it is not defined
+    const std::string& actionName(int action) const
+    {
+        static const std::string no_name;
+        return validAction(action) ? names[action] : no_name;
+    }
+
+    // Make a key trigger an action, taking it off whatever it was bound
+    // to before. A key can only drive one action, an action can have
+    // any number of keys. If the key is held, it lets go of the old
+    // action now and only drives the new one from its next press.
+    // @return false if the binding table is full or the action is not
+    //         defined, eg. -1 from a defineAction that failed
+    bool bindKey(SDL_Keycode key, int action)
+    {
+        return bind(INPUT_KEY, key, action);
+    }
+
+    // Make a mouse button (SDL_BUTTON_LEFT etc.) trigger an action
+    // @return false if the binding table is full or the action is not
+    //         defined
+    bool bindMouseButton(Uint8 button, int action)
+    {
+        return bind(INPUT_MOUSE_BUTTON, button, action);
+    }
+
+    // Remove every key and button bound to an action, it is no longer
+    // held by any of them
+    void unbindAction(int action)
+    {
+        if (!validAction(action))
+        {
+            return;
+        }
+        states[action].held = 0;
+        states[action].down = false;
+        int kept = 0;
+        for (int i = 0; i < num_bindings; ++i)
+        {
+            if (bindings[i].action != action)
+            {
+                bindings[kept++] = bindings[i];
+            }
+        }
+        num_bindings = kept;
+    }
+
+    // @return the action a key triggers, or -1 if it is not bound
+    int actionForKey(SDL_Keycode key) const
+    {
+        const int binding = lookup(INPUT_KEY, key);
+        return binding >= 0 ? bindings[binding].action : -1;
+    }
+
+    // Clear the presses and releases of the last frame. Call once at the
+    // start of every frame, before pump.
+    void beginFrame()
+    {
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            states[i].presses = 0;
+            states[i].releases = 0;
+        }
+        frame_events = 0;
+    }
+
+    // Drain the event queue, updating action states and calling
+    //   func(const SDL_Event &event)
+    // for every event, bound or not
+    // @return how many events were taken off the queue
+    template<typename EventFunc>
+    int pump(EventFunc func)
+    {
+        SDL_PumpEvents();
+        int total = 0;
+        int count = 0;
+        do
+        {
+            count = SDL_PeepEvents(buffer, INPUT_EVENT_BATCH, SDL_GETEVENT,
+                SDL_FIRSTEVENT, SDL_LASTEVENT);
+            for (int i = 0; i < count; ++i)
+            {
+                handleEvent(buffer[i]);
+                func(buffer[i]);
+            }
+            total += std::max(count, 0);
+        }
+        while (count == INPUT_EVENT_BATCH);
+        frame_events += total;
+        return total;
+    }
+
+    // Update action states from one event, for events that did not come
+    // through pump
+    void handleEvent(const SDL_Event &event)
+    {
+        int binding = -1;
+        bool pressed = false;
+        switch (event.type)
+        {
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                // Key repeat is not a new press
+                if (event.key.repeat != 0)
+                {
+                    return;
+                }
+                binding = lookup(INPUT_KEY, event.key.keysym.sym);
+                pressed = event.type == SDL_KEYDOWN;
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+                binding = lookup(INPUT_MOUSE_BUTTON, event.button.button);
+                pressed = event.type == SDL_MOUSEBUTTONDOWN;
+                break;
+            default:
+                return;
+        }
+
+        // A release without a press is a key that was already down when
+        // it was bound, it does not take away another binding's hold.
+        // A second press without a release is ignored the same way
+        if (binding < 0 || bindings[binding].pressed == pressed)
+        {
+            return;
+        }
+        bindings[binding].pressed = pressed;
+        const bool changed = setHeld(bindings[binding].action, pressed);
+        if (changed && num_pending < INPUT_MAX_PENDING)
+        {
+            pending[num_pending++] = event.common.timestamp;
+        }
+    }
+
+    // Record the latency of every action event handled this frame. Call
+    // once the frame that reacted to them has been presented.
+    void endFrame()
+    {
+        const Uint32 now = SDL_GetTicks();
+        for (int i = 0; i < num_pending; ++i)
+        {
+            // Timestamps from before SDL_GetTicks wrapped still subtract
+            // correctly as unsigned values
+            const Uint32 latency = now - pending[i];
+            ++latency_counts[std::min<Uint32>(latency, INPUT_LATENCY_BUCKETS - 1)];
+            latency_total += latency;
+            latency_max = std::max(latency_max, latency);
+            ++latency_samples;
+        }
+        num_pending = 0;
+    }
+
+    // @return the state of an action this frame, all zero if the action
+    //         is not defined
+    const ActionState& state(int action) const
+    {
+        static const ActionState no_state = ActionState();
+        return validAction(action) ? states[action] : no_state;
+    }
+
+    // @return true if the action is held
+    bool isDown(int action) const
+    {
+        return state(action).down;
+    }
+
+    // @return true if the action was pressed at least once this frame
+    bool wasPressed(int action) const
+    {
+        return state(action).presses > 0;
+    }
+
+    // @return true if the action was released at least once this frame
+    bool wasReleased(int action) const
+    {
+        return state(action).releases > 0;
+    }
+
+    // @return how many events the last pump took off the queue
+    int getFrameEvents() const
+    {
+        return frame_events;
+    }
+
+    // @return how many action events have had their latency measured
+    long getLatencySamples() const
+    {
+        return latency_samples;
+    }
+
+    // @return the mean input latency in milliseconds
+    double getMeanLatency() const
+    {
+        return latency_samples > 0 ? double(latency_total) / latency_samples : 0.0;
+    }
+
+    // @return the worst input latency in milliseconds
+    Uint32 getMaxLatency() const
+    {
+        return latency_max;
+    }
+
+    // @param fraction Which percentile to get, eg. 0.99
+    // @return the latency in milliseconds that this fraction of samples
+    //         were at or under
+    Uint32 getLatencyPercentile(double fraction) const
+    {
+        const long target = long(fraction * latency_samples + 0.5);
+        long seen = 0;
+        for (int i = 0; i < INPUT_LATENCY_BUCKETS; ++i)
+        {
+            seen += latency_counts[i];
+            if (seen >= target && seen > 0)
+            {
+                return Uint32(i);
+            }
+        }
+        return latency_max;
+    }
+
+    void resetLatency()
+    {
+        std::memset(latency_counts, 0, sizeof(latency_counts));
+        latency_total = 0;
+        latency_max = 0;
+        latency_samples = 0;
+    }
+
+private:
+    bool validAction(int action) const
+    {
+        return action >= 0 && action < int(names.size());
+    }
+
+    bool bind(int device, Sint32 code, int action)
+    {
+        if (!validAction(action))
+        {
+            return false;
+        }
+        const int existing = lookup(device, code);
+        if (existing >= 0)
+        {
+            InputBinding &binding = bindings[existing];
+            if (binding.action != action && binding.pressed)
+            {
+                // Let go of the old action as if the key was released
+                setHeld(binding.action, false);
+                binding.pressed = false;
+            }
+            binding.action = action;
+            return true;
+        }
+        if (num_bindings >= INPUT_MAX_BINDINGS)
+        {
+            return false;
+        }
+        bindings[num_bindings].device = device;
+        bindings[num_bindings].code = code;
+        bindings[num_bindings].action = action;
+        bindings[num_bindings].pressed = false;
+        ++num_bindings;
+        return true;
+    }
+
+    // Count one binding more or less holding an action, turning the
+    // first hold into a press and the last release into a release
+    // @return true if the action went up or down
+    bool setHeld(int action, bool pressed)
+    {
+        ActionState &state = states[action];
+        if (pressed)
+        {
+            if (state.held == 0 && state.presses < 255)
+            {
+                ++state.presses;
+            }
+            if (state.held < 255)
+            {
+                ++state.held;
+            }
+        }
+        else if (state.held > 0)
+        {
+            --state.held;
+            if (state.held == 0 && state.releases < 255)
+            {
+                ++state.releases;
+            }
+        }
+        const bool changed = state.down != (state.held > 0);
+        state.down = state.held > 0;
+        return changed;
+    }
+
+    // The table is small, a linear scan beats hashing here
+    // @return the index of the binding, or -1 if there is none
+    int lookup(int device, Sint32 code) const
+    {
+        for (int i = 0; i < num_bindings; ++i)
+        {
+            if (bindings[i].device == device && bindings[i].code == code)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    std::vector<std::string> names;
+    ActionState states[INPUT_MAX_ACTIONS];
+    InputBinding bindings[INPUT_MAX_BINDINGS];
+    int num_bindings;
+
+    SDL_Event buffer[INPUT_EVENT_BATCH];
+    Uint32 pending[INPUT_MAX_PENDING];
+    int num_pending;
+    int frame_events;
+
+    long latency_counts[INPUT_LATENCY_BUCKETS];
+    Uint64 latency_total;
+    Uint32 latency_max;
+    long latency_samples;
+};
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <SDL2/SDL.h>
+
+// Pixel format of offscreen frames
+const Uint32 OFFSCREEN_PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+// A finished frame handed to the consumer. The pixels stay untouched
+// until the frame is released.
+struct OffscreenFrame
+{
+    const Uint32 *pixels;
+    int pitch;
+    int width;
+    int height;
+
+    // Frames are numbered from 0 in the order they were finished
+    long number;
+
+    // SDL_GetPerformanceCounter when the frame was finished
+    Uint64 finished;
+
+    // Which buffer holds the frame, used to release it
+    int buffer;
+};
+
+// FNV-1a hash of an image's pixels, row by row so padding at the end of
+// rows is ignored. Only the color channels are hashed: a window's
+// surface has no alpha and reads back as opaque, while an offscreen
+// buffer keeps the alpha the blending left behind, and the same frame
+// should hash the same from either
+// @param pixels The first row, in OFFSCREEN_PIXEL_FORMAT
+// @param pitch Bytes from one row to the next
+// @param width Pixels per row to hash
+// @param height Rows to hash
+// @return the hash, never 0 so a replay can tell a hashed frame from
+//         one that was not
+inline Uint32 hashPixels(const Uint32 *pixels, int pitch, int width, int height)
+{
+    Uint32 hash = 2166136261u;
+    for (int y = 0; y < height; ++y)
+    {
+        const Uint32 *row = reinterpret_cast<const Uint32*>(
+            reinterpret_cast<const Uint8*>(pixels) + y * pitch);
+        for (int x = 0; x < width; ++x)
+        {
+            hash = (hash ^ (row[x] & 0x00ffffffu)) * 16777619u;
+        }
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// Renders into memory instead of a window, for running scenes on
+// machines without a display to produce frames for encoding or testing.
+// An SDL software renderer draws into one of several buffers (two for
+// double buffering, three for triple). When a frame is done its buffer
+// is handed to a consumer, usually on another thread, which reads the
+// pixels in place and hands the buffer back. Frames are never copied,
+// and nothing goes through SDL_RenderReadPixels.
+//
+// The renderer is pointed at a different buffer each frame, so what was
+// drawn last frame is not there at the start of the next: draw every
+// frame in full (eg. RetainedScene with partial repaint turned off).
+class OffscreenTarget
+{
+public:
+    // @param width Width of a frame in pixels
+    // @param height Height of a frame in pixels
+    // @param buffers How many frames can be in flight, at least 2
+    // @param memory Memory for the buffers, buffers * height * pitch
+    //        bytes the caller owns, or nullptr to allocate it here
+    // @param pitch Bytes from one row to the next in memory, 0 for width * 4
+    // @param dropWhenFull If the consumer falls behind, reuse the oldest
+    //        unread frame instead of waiting for the consumer
+    OffscreenTarget(int width, int height, int buffers = 3, void *memory = nullptr,
+        int pitch = 0, bool dropWhenFull = false)
+        : width(width), height(height), pitch(pitch > 0 ? pitch : width * 4),
+          drop_when_full(dropWhenFull), surface(nullptr), renderer(nullptr),
+          current(-1), closed(false), produced(0), consumed(0), dropped(0),
+          first_start(0), last_finish(0)
+    {
+        const int count = buffers < 2 ? 2 : buffers;
+        Uint8 *base = static_cast<Uint8*>(memory);
+        if (base == nullptr)
+        {
+            owned.resize(size_t(count) * height * this->pitch);
+            base = owned.data();
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            pixels.push_back(base + size_t(i) * height * this->pitch);
+            states.push_back(BUFFER_FREE);
+        }
+        numbers.resize(count);
+        finished_at.resize(count);
+        ready.reserve(count);
+
+        // The surface does not own its pixels, so it can be pointed at
+        // each buffer in turn
+        surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels[0], width, height, 32,
+            this->pitch, OFFSCREEN_PIXEL_FORMAT);
+        if (surface == nullptr)
+        {
+            std::cout << "OffscreenTarget CreateSurface" << SDL_GetError() << std::endl;
+            return;
+        }
+        renderer = SDL_CreateSoftwareRenderer(surface);
+        if (renderer == nullptr)
+        {
+            std::cout << "SDL_CreateSoftwareRenderer" << SDL_GetError() << std::endl;
+        }
+    }
+
+    // The consumer must have stopped using frames by now
+    ~OffscreenTarget()
+    {
+        if (renderer != nullptr)
+        {
+            SDL_DestroyRenderer(renderer);
+        }
+        if (surface != nullptr)
+        {
+            SDL_FreeSurface(surface);
+        }
+    }
+
+    // @return true if the renderer was created
+    bool good() const
+    {
+        return renderer != nullptr;
+    }
+
+    // The renderer to draw frames with. Textures for it are created on
+    // it like on any other renderer.
+    SDL_Renderer* getRenderer() const
+    {
+        return renderer;
+    }
+
+    // Start drawing a frame, waiting for the consumer to hand back a
+    // buffer if every one is in use
+    // @return the pixels the frame is drawn into, for drawing into
+    //         directly (eg. with a TiledRasterizer) as well as through
+    //         the renderer
+    Uint32* beginFrame()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (first_start == 0)
+        {
+            first_start = SDL_GetPerformanceCounter();
+        }
+        if (current < 0)
+        {
+            current = takeBuffer(lock);
+        }
+        surface->pixels = pixels[current];
+        return reinterpret_cast<Uint32*>(pixels[current]);
+    }
+
+    // Finish the frame started by beginFrame and hand it to the consumer
+    void endFrame()
+    {
+        // The renderer queues draws, make sure they have all landed
+        SDL_RenderFlush(renderer);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current < 0)
+        {
+            return;
+        }
+        last_finish = SDL_GetPerformanceCounter();
+        states[current] = BUFFER_READY;
+        numbers[current] = produced++;
+        finished_at[current] = last_finish;
+        ready.push_back(current);
+        current = -1;
+        frame_ready.notify_one();
+    }
+
+    // Wait for the next finished frame, oldest first
+    // @param frame Filled with the frame
+    // @param timeoutMs How long to wait, 0xffffffff for no limit
+    // @return false on timeout, or once the target is closed and every
+    //         frame has been read
+    bool acquireFrame(OffscreenFrame &frame, Uint32 timeoutMs = 0xffffffff)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto has_frame = [this]() { return !ready.empty() || closed; };
+        if (timeoutMs == 0xffffffff)
+        {
+            frame_ready.wait(lock, has_frame);
+        }
+        else if (!frame_ready.wait_for(lock, std::chrono::milliseconds(timeoutMs), has_frame))
+        {
+            return false;
+        }
+        if (ready.empty())
+        {
+            return false;
+        }
+
+        const int index = ready.front();
+        ready.erase(ready.begin());
+        states[index] = BUFFER_READING;
+        frame.pixels = reinterpret_cast<const Uint32*>(pixels[index]);
+        frame.pitch = pitch;
+        frame.width = width;
+        frame.height = height;
+        frame.number = numbers[index];
+        frame.finished = finished_at[index];
+        frame.buffer = index;
+        return true;
+    }
+
+    // Hand a frame's buffer back to be drawn into again
+    void releaseFrame(const OffscreenFrame &frame)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        states[frame.buffer] = BUFFER_FREE;
+        ++consumed;
+        buffer_free.notify_one();
+    }
+
+    // No more frames are coming, wakes a consumer waiting for one
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        frame_ready.notify_all();
+    }
+
+    long getProduced() const { return produced; }
+    long getConsumed() const { return consumed; }
+
+    // @return frames thrown away unread because the consumer fell behind
+    long getDropped() const { return dropped; }
+
+    // @return frames finished per second so far
+    double getFps() const
+    {
+        if (last_finish <= first_start)
+        {
+            return 0.0;
+        }
+        return produced / (double(last_finish - first_start) / SDL_GetPerformanceFrequency());
+    }
+
+private:
+    enum BufferState
+    {
+        BUFFER_FREE,
+        BUFFER_DRAWING,
+        BUFFER_READY,
+        BUFFER_READING
+    };
+
+    // Find a buffer to draw into, the mutex must be held
+    int takeBuffer(std::unique_lock<std::mutex> &lock)
+    {
+        while (true)
+        {
+            for (size_t i = 0; i < states.size(); ++i)
+            {
+                if (states[i] == BUFFER_FREE)
+                {
+                    states[i] = BUFFER_DRAWING;
+                    return int(i);
+                }
+            }
+            if (drop_when_full && !ready.empty())
+            {
+                const int index = ready.front();
+                ready.erase(ready.begin());
+                states[index] = BUFFER_DRAWING;
+                ++dropped;
+                return index;
+            }
+            buffer_free.wait(lock);
+        }
+    }
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    int width;
+    int height;
+    int pitch;
+    bool drop_when_full;
+    std::vector<Uint8> owned;
+    std::vector<Uint8*> pixels;
+    std::vector<int> states;
+    std::vector<long> numbers;
+    std::vector<Uint64> finished_at;
+    std::vector<int> ready;
+    SDL_Surface *surface;
+    SDL_Renderer *renderer;
+    int current;
+    bool closed;
+    long produced;
+    long consumed;
+    long dropped;
+    Uint64 first_start;
+    Uint64 last_finish;
+    std::mutex mutex;
+    std::condition_variable frame_ready;
+    std::condition_variable buffer_free;
+};
+
+#endif
@@ -0,0 +1,674 @@
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <SDL2/SDL.h>
+
+// SIMD kernels are built on x86 unless PIXEL_CONVERT_NO_SIMD is defined.
+// The AVX2 ones are compiled for AVX2 with a function attribute, so the
+// rest of the program does not need -mavx2, and are only called after
+// SDL_HasAVX2 says the CPU has it.
+#if !defined(PIXEL_CONVERT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define PIXEL_CONVERT_SSE2 1
+    #include <emmintrin.h>
+    #if defined(__GNUC__) || defined(__clang__)
+        #define PIXEL_CONVERT_AVX2 1
+        #define PIXEL_CONVERT_TARGET_AVX2 __attribute__((target("avx2")))
+        #include <immintrin.h>
+    #elif defined(_MSC_VER)
+        #define PIXEL_CONVERT_AVX2 1
+        #define PIXEL_CONVERT_TARGET_AVX2
+        #include <immintrin.h>
+    #endif
+#endif
+
+// Options for convertPixels and createTextureFromSurfaceFast
+enum PixelConvertFlags
+{
+    // Multiply color by alpha, for textures drawn with a premultiplied
+    // blend mode
+    PIXEL_CONVERT_PREMULTIPLY = 1,
+
+    // Make pixels matching the surface's color key fully transparent,
+    // like SDL_CreateTextureFromSurface does
+    PIXEL_CONVERT_COLORKEY = 2
+};
+
+// Which set of kernels does the work
+enum PixelKernelLevel
+{
+    PIXEL_KERNELS_SCALAR = 0,
+    PIXEL_KERNELS_SSE2 = 1,
+    PIXEL_KERNELS_AVX2 = 2
+};
+
+// Where the channels of a pixel are. For 4 byte pixels r, g, b and a are
+// bit shifts within the Uint32, for 3 byte pixels they are byte offsets.
+// a is -1 if the format has no alpha.
+struct PixelLayout
+{
+    int bytes;
+    int r;
+    int g;
+    int b;
+    int a;
+};
+
+// Work out the channel layout of a pixel format
+// @param format The SDL_PIXELFORMAT_* to look at
+// @param layout Filled with where the channels are
+// @return false if the format is not one the kernels handle, ie. not
+//         RGB24/BGR24 or a 32 bit format with whole byte channels
+inline bool getPixelLayout(Uint32 format, PixelLayout &layout)
+{
+    if (format == SDL_PIXELFORMAT_RGB24 || format == SDL_PIXELFORMAT_BGR24)
+    {
+        // Byte order in memory, the same on every platform
+        layout.bytes = 3;
+        layout.r = format == SDL_PIXELFORMAT_RGB24 ? 0 : 2;
+        layout.g = 1;
+        layout.b = format == SDL_PIXELFORMAT_RGB24 ? 2 : 0;
+        layout.a = -1;
+        return true;
+    }
+
+    int bpp;
+    Uint32 masks[4];
+    if (!SDL_PixelFormatEnumToMasks(format, &bpp, &masks[0], &masks[1], &masks[2], &masks[3]) ||
+        bpp != 32 || SDL_BYTESPERPIXEL(format) != 4)
+    {
+        return false;
+    }
+
+    int shifts[4];
+    for (int c = 0; c < 4; ++c)
+    {
+        shifts[c] = -1;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            if (masks[c] == (0xffu << shift))
+            {
+                shifts[c] = shift;
+            }
+        }
+        // Only alpha may be missing
+        if (shifts[c] < 0 && (c < 3 || masks[c] != 0))
+        {
+            return false;
+        }
+    }
+
+    layout.bytes = 4;
+    layout.r = shifts[0];
+    layout.g = shifts[1];
+    layout.b = shifts[2];
+    layout.a = shifts[3];
+    return true;
+}
+
+// Scalar kernels, used on their own without SIMD and for the pixels left
+// over at the end of a row by the SIMD ones
+
+inline void convertRow32Scalar(const Uint8 *src, Uint32 *dst, int n,
+    const PixelLayout &from, const PixelLayout &to)
+{
+    const Uint32 *in = (const Uint32*)src;
+    const Uint32 fill = from.a < 0 ? 0xffu << to.a : 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const Uint32 p = in[i];
+        Uint32 out = fill;
+        out |= ((p >> from.r) & 0xff) << to.r;
+        out |= ((p >> from.g) & 0xff) << to.g;
+        out |= ((p >> from.b) & 0xff) << to.b;
+        if (from.a >= 0)
+        {
+            out |= ((p >> from.a) & 0xff) << to.a;
+        }
+        dst[i] = out;
+    }
+}
+
+inline void convertRow24Scalar(const Uint8 *src, Uint32 *dst, int n,
+    const PixelLayout &from, const PixelLayout &to)
+{
+    const Uint32 fill = 0xffu << to.a;
+    for (int i = 0; i < n; ++i)
+    {
+        const Uint8 *p = src + i * 3;
+        dst[i] = fill | (Uint32(p[from.r]) << to.r) | (Uint32(p[from.g]) << to.g) |
+            (Uint32(p[from.b]) << to.b);
+    }
+}
+
+inline void premultiplyRowScalar(Uint32 *px, int n, int aShift)
+{
+    const Uint32 alpha_mask = 0xffu << aShift;
+    for (int i = 0; i < n; ++i)
+    {
+        const Uint32 p = px[i];
+        const Uint32 a = (p >> aShift) & 0xff;
+        Uint32 out = p & alpha_mask;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            if (shift != aShift)
+            {
+                // x * a / 255, rounded
+                Uint32 t = ((p >> shift) & 0xff) * a + 128;
+                out |= (((t + (t >> 8)) >> 8) & 0xff) << shift;
+            }
+        }
+        px[i] = out;
+    }
+}
+
+inline void colorKeyRowScalar(Uint32 *px, int n, Uint32 key, Uint32 rgbMask)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        if ((px[i] & rgbMask) == key)
+        {
+            px[i] = 0;
+        }
+    }
+}
+
+#ifdef PIXEL_CONVERT_SSE2
+// SSE2 has no byte shuffle, so channels are moved with 32 bit shifts,
+// which works for any pair of layouts. 24 bit sources stay scalar.
+inline void convertRow32SSE2(const Uint8 *src, Uint32 *dst, int n,
+    const PixelLayout &from, const PixelLayout &to)
+{
+    const __m128i byte_mask = _mm_set1_epi32(0xff);
+    const __m128i fill = _mm_set1_epi32(from.a < 0 ? int(0xffu << to.a) : 0);
+    const int channels = from.a < 0 ? 3 : 4;
+    const __m128i in_shift[4] = { _mm_cvtsi32_si128(from.r), _mm_cvtsi32_si128(from.g),
+        _mm_cvtsi32_si128(from.b), _mm_cvtsi32_si128(from.a) };
+    const __m128i out_shift[4] = { _mm_cvtsi32_si128(to.r), _mm_cvtsi32_si128(to.g),
+        _mm_cvtsi32_si128(to.b), _mm_cvtsi32_si128(to.a) };
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i out = fill;
+        for (int c = 0; c < channels; ++c)
+        {
+            __m128i channel = _mm_and_si128(_mm_srl_epi32(p, in_shift[c]), byte_mask);
+            out = _mm_or_si128(out, _mm_sll_epi32(channel, out_shift[c]));
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+    }
+    convertRow32Scalar(src + i * 4, dst + i, n - i, from, to);
+}
+
+// Multiply two pixels widened to 16 bits per channel by their alpha
+inline __m128i premultiplyWideSSE2(__m128i wide, __m128i alpha)
+{
+    const __m128i round = _mm_set1_epi16(128);
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(wide, alpha), round);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+inline void premultiplyRowSSE2(Uint32 *px, int n, int aShift)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32(int(0xffu << aShift));
+    const __m128i byte_mask = _mm_set1_epi32(0xff);
+    const __m128i shift = _mm_cvtsi32_si128(aShift);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(px + i));
+
+        // Alpha of each pixel in both 16 bit halves of its 32 bit lane,
+        // then spread over the four 16 bit channels of that pixel
+        __m128i a = _mm_and_si128(_mm_srl_epi32(p, shift), byte_mask);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        const __m128i a_lo = _mm_unpacklo_epi32(a, a);
+        const __m128i a_hi = _mm_unpackhi_epi32(a, a);
+
+        __m128i lo = premultiplyWideSSE2(_mm_unpacklo_epi8(p, zero), a_lo);
+        __m128i hi = premultiplyWideSSE2(_mm_unpackhi_epi8(p, zero), a_hi);
+        __m128i out = _mm_packus_epi16(lo, hi);
+
+        // Alpha times alpha is not alpha, put the original back
+        out = _mm_or_si128(_mm_andnot_si128(alpha_mask, out), _mm_and_si128(alpha_mask, p));
+        _mm_storeu_si128((__m128i*)(px + i), out);
+    }
+    premultiplyRowScalar(px + i, n - i, aShift);
+}
+
+inline void colorKeyRowSSE2(Uint32 *px, int n, Uint32 key, Uint32 rgbMask)
+{
+    const __m128i keys = _mm_set1_epi32(int(key));
+    const __m128i mask = _mm_set1_epi32(int(rgbMask));
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i*)(px + i));
+        const __m128i match = _mm_cmpeq_epi32(_mm_and_si128(p, mask), keys);
+        _mm_storeu_si128((__m128i*)(px + i), _mm_andnot_si128(match, p));
+    }
+    colorKeyRowScalar(px + i, n - i, key, rgbMask);
+}
+#endif
+
+#ifdef PIXEL_CONVERT_AVX2
+// Byte shuffle taking a pixel in one layout to another, repeated for
+// every pixel of a 16 byte lane. Source bytes that do not exist (alpha
+// in a format without it) are zeroed by the shuffle and filled after.
+// @param srcBytes Bytes per source pixel, 3 or 4
+inline void makeShuffleMask(const PixelLayout &from, const PixelLayout &to, int srcBytes,
+    Uint8 mask[16])
+{
+    const int from_bytes[4] = {
+        srcBytes == 4 ? from.r / 8 : from.r,
+        srcBytes == 4 ? from.g / 8 : from.g,
+        srcBytes == 4 ? from.b / 8 : from.b,
+        from.a < 0 ? -1 : (srcBytes == 4 ? from.a / 8 : from.a)
+    };
+    const int to_bytes[4] = { to.r / 8, to.g / 8, to.b / 8, to.a / 8 };
+    for (int pixel = 0; pixel < 4; ++pixel)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            mask[pixel * 4 + to_bytes[c]] = from_bytes[c] < 0 ? 0x80 :
+                Uint8(pixel * srcBytes + from_bytes[c]);
+        }
+    }
+}
+
+PIXEL_CONVERT_TARGET_AVX2
+inline void convertRow32AVX2(const Uint8 *src, Uint32 *dst, int n,
+    const PixelLayout &from, const PixelLayout &to)
+{
+    Uint8 lane[16];
+    makeShuffleMask(from, to, 4, lane);
+    const __m128i lane_mask = _mm_loadu_si128((const __m128i*)lane);
+    const __m256i shuffle = _mm256_broadcastsi128_si256(lane_mask);
+    const __m256i fill = _mm256_set1_epi32(from.a < 0 ? int(0xffu << to.a) : 0);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        const __m256i out = _mm256_or_si256(_mm256_shuffle_epi8(p, shuffle), fill);
+        _mm256_storeu_si256((__m256i*)(dst + i), out);
+    }
+    convertRow32Scalar(src + i * 4, dst + i, n - i, from, to);
+}
+
+// 8 pixels per step, 4 from each of two 16 byte loads 12 bytes apart.
+// The second load reads 4 bytes past the 8 pixels, so stop early enough
+// that it never reads past the end of the row.
+PIXEL_CONVERT_TARGET_AVX2
+inline void convertRow24AVX2(const Uint8 *src, Uint32 *dst, int n,
+    const PixelLayout &from, const PixelLayout &to)
+{
+    Uint8 lane[16];
+    makeShuffleMask(from, to, 3, lane);
+    const __m128i lane_mask = _mm_loadu_si128((const __m128i*)lane);
+    const __m256i shuffle = _mm256_broadcastsi128_si256(lane_mask);
+    const __m256i fill = _mm256_set1_epi32(int(0xffu << to.a));
+
+    int i = 0;
+    for (; i + 10 <= n; i += 8)
+    {
+        const __m128i first = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        const __m128i second = _mm_loadu_si128((const __m128i*)(src + i * 3 + 12));
+        const __m256i p = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+        const __m256i out = _mm256_or_si256(_mm256_shuffle_epi8(p, shuffle), fill);
+        _mm256_storeu_si256((__m256i*)(dst + i), out);
+    }
+    convertRow24Scalar(src + i * 3, dst + i, n - i, from, to);
+}
+
+PIXEL_CONVERT_TARGET_AVX2
+inline __m256i premultiplyWideAVX2(__m256i wide, __m256i alpha)
+{
+    const __m256i round = _mm256_set1_epi16(128);
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(wide, alpha), round);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// Same as the SSE2 version, the unpacks and the pack work within each
+// 16 byte lane so pixels come back out where they went in
+PIXEL_CONVERT_TARGET_AVX2
+inline void premultiplyRowAVX2(Uint32 *px, int n, int aShift)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32(int(0xffu << aShift));
+    const __m256i byte_mask = _mm256_set1_epi32(0xff);
+    const __m128i shift = _mm_cvtsi32_si128(aShift);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(px + i));
+        __m256i a = _mm256_and_si256(_mm256_srl_epi32(p, shift), byte_mask);
+        a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+        const __m256i a_lo = _mm256_unpacklo_epi32(a, a);
+        const __m256i a_hi = _mm256_unpackhi_epi32(a, a);
+
+        __m256i lo = premultiplyWideAVX2(_mm256_unpacklo_epi8(p, zero), a_lo);
+        __m256i hi = premultiplyWideAVX2(_mm256_unpackhi_epi8(p, zero), a_hi);
+        __m256i out = _mm256_packus_epi16(lo, hi);
+        out = _mm256_or_si256(_mm256_andnot_si256(alpha_mask, out),
+            _mm256_and_si256(alpha_mask, p));
+        _mm256_storeu_si256((__m256i*)(px + i), out);
+    }
+    premultiplyRowScalar(px + i, n - i, aShift);
+}
+
+PIXEL_CONVERT_TARGET_AVX2
+inline void colorKeyRowAVX2(Uint32 *px, int n, Uint32 key, Uint32 rgbMask)
+{
+    const __m256i keys = _mm256_set1_epi32(int(key));
+    const __m256i mask = _mm256_set1_epi32(int(rgbMask));
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i p = _mm256_loadu_si256((const __m256i*)(px + i));
+        const __m256i match = _mm256_cmpeq_epi32(_mm256_and_si256(p, mask), keys);
+        _mm256_storeu_si256((__m256i*)(px + i), _mm256_andnot_si256(match, p));
+    }
+    colorKeyRowScalar(px + i, n - i, key, rgbMask);
+}
+#endif
+
+// @return the best kernels this build and CPU can run
+inline PixelKernelLevel detectPixelKernelLevel()
+{
+#ifdef PIXEL_CONVERT_AVX2
+    if (SDL_HasAVX2())
+    {
+        return PIXEL_KERNELS_AVX2;
+    }
+#endif
+#ifdef PIXEL_CONVERT_SSE2
+    if (SDL_HasSSE2())
+    {
+        return PIXEL_KERNELS_SSE2;
+    }
+#endif
+    return PIXEL_KERNELS_SCALAR;
+}
+
+// The kernels in use, picked the first time they are needed
+inline PixelKernelLevel& pixelKernelLevel()
+{
+    static PixelKernelLevel level = detectPixelKernelLevel();
+    return level;
+}
+
+// Use a lower level of kernels than detected, eg. to compare them
+// @param level The level to use, clamped to what the CPU supports
+// @return the level actually in use
+inline PixelKernelLevel setPixelKernelLevel(PixelKernelLevel level)
+{
+    const PixelKernelLevel best = detectPixelKernelLevel();
+    pixelKernelLevel() = level < best ? level : best;
+    return pixelKernelLevel();
+}
+
+inline const char* pixelKernelName(PixelKernelLevel level)
+{
+    switch (level)
+    {
+        case PIXEL_KERNELS_AVX2:
+            return "avx2";
+        case PIXEL_KERNELS_SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+inline void convertRow(const Uint8 *src, Uint32 *dst, int n, const PixelLayout &from,
+    const PixelLayout &to)
+{
+    const PixelKernelLevel level = pixelKernelLevel();
+#ifdef PIXEL_CONVERT_AVX2
+    if (level == PIXEL_KERNELS_AVX2)
+    {
+        if (from.bytes == 4)
+        {
+            convertRow32AVX2(src, dst, n, from, to);
+        }
+        else
+        {
+            convertRow24AVX2(src, dst, n, from, to);
+        }
+        return;
+    }
+#endif
+#ifdef PIXEL_CONVERT_SSE2
+    if (level >= PIXEL_KERNELS_SSE2 && from.bytes == 4)
+    {
+        convertRow32SSE2(src, dst, n, from, to);
+        return;
+    }
+#endif
+    (void)level;
+    if (from.bytes == 4)
+    {
+        convertRow32Scalar(src, dst, n, from, to);
+    }
+    else
+    {
+        convertRow24Scalar(src, dst, n, from, to);
+    }
+}
+
+inline void premultiplyRow(Uint32 *px, int n, int aShift)
+{
+    const PixelKernelLevel level = pixelKernelLevel();
+#ifdef PIXEL_CONVERT_AVX2
+    if (level == PIXEL_KERNELS_AVX2)
+    {
+        premultiplyRowAVX2(px, n, aShift);
+        return;
+    }
+#endif
+#ifdef PIXEL_CONVERT_SSE2
+    if (level == PIXEL_KERNELS_SSE2)
+    {
+        premultiplyRowSSE2(px, n, aShift);
+        return;
+    }
+#endif
+    (void)level;
+    premultiplyRowScalar(px, n, aShift);
+}
+
+inline void colorKeyRow(Uint32 *px, int n, Uint32 key, Uint32 rgbMask)
+{
+    const PixelKernelLevel level = pixelKernelLevel();
+#ifdef PIXEL_CONVERT_AVX2
+    if (level == PIXEL_KERNELS_AVX2)
+    {
+        colorKeyRowAVX2(px, n, key, rgbMask);
+        return;
+    }
+#endif
+#ifdef PIXEL_CONVERT_SSE2
+    if (level == PIXEL_KERNELS_SSE2)
+    {
+        colorKeyRowSSE2(px, n, key, rgbMask);
+        return;
+    }
+#endif
+    (void)level;
+    colorKeyRowScalar(px, n, key, rgbMask);
+}
+
+// Convert a surface's pixels to a 32 bit format with alpha
+// @param src The surface to convert
+// @param dstFormat The format to convert to, eg. SDL_PIXELFORMAT_ARGB8888
+// @param dst Where to write the converted pixels
+// @param dstPitch Bytes between rows of dst
+// @param flags PixelConvertFlags to apply while converting
+// @return false if either format is not one the kernels handle, nothing
+//         is written in that case
+inline bool convertPixels(SDL_Surface *src, Uint32 dstFormat, void *dst, int dstPitch, int flags)
+{
+    PixelLayout from, to;
+    if (!getPixelLayout(src->format->format, from) || !getPixelLayout(dstFormat, to) ||
+        to.bytes != 4 || to.a < 0)
+    {
+        return false;
+    }
+
+    // The key is in the source format, compare against it converted
+    Uint32 key = 0;
+    bool use_key = (flags & PIXEL_CONVERT_COLORKEY) && SDL_GetColorKey(src, &key) == 0;
+    const Uint32 rgb_mask = ~(0xffu << to.a);
+    if (use_key)
+    {
+        Uint8 r, g, b;
+        SDL_GetRGB(key, src->format, &r, &g, &b);
+        key = (Uint32(r) << to.r) | (Uint32(g) << to.g) | (Uint32(b) << to.b);
+    }
+
+    if (SDL_MUSTLOCK(src))
+    {
+        SDL_LockSurface(src);
+    }
+    for (int y = 0; y < src->h; ++y)
+    {
+        const Uint8 *in = (const Uint8*)src->pixels + y * src->pitch;
+        Uint32 *out = (Uint32*)((Uint8*)dst + y * dstPitch);
+        convertRow(in, out, src->w, from, to);
+        if (use_key)
+        {
+            colorKeyRow(out, src->w, key, rgb_mask);
+        }
+        if (flags & PIXEL_CONVERT_PREMULTIPLY)
+        {
+            premultiplyRow(out, src->w, to.a);
+        }
+    }
+    if (SDL_MUSTLOCK(src))
+    {
+        SDL_UnlockSurface(src);
+    }
+    return true;
+}
+
+// @return the first 32 bit format with alpha the renderer lists as
+//         native, or SDL_PIXELFORMAT_ARGB8888 if it lists none
+inline Uint32 nativeTextureFormat(SDL_Renderer *ren)
+{
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(ren, &info) == 0)
+    {
+        for (Uint32 i = 0; i < info.num_texture_formats; ++i)
+        {
+            PixelLayout layout;
+            if (getPixelLayout(info.texture_formats[i], layout) &&
+                layout.bytes == 4 && layout.a >= 0)
+            {
+                return info.texture_formats[i];
+            }
+        }
+    }
+    return SDL_PIXELFORMAT_ARGB8888;
+}
+
+// Blend mode for textures with premultiplied alpha
+inline SDL_BlendMode premultipliedBlendMode()
+{
+    return SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+}
+
+// Set the blend mode of a texture a surface is uploaded into. Like
+// SDL_CreateTextureFromSurface, the texture only blends if the surface
+// has alpha or a color key, opaque textures are copied without blending.
+// @param texture The texture the surface goes into
+// @param surface The surface being uploaded
+// @param flags PixelConvertFlags the upload was asked for
+// @return flags without PIXEL_CONVERT_PREMULTIPLY if the pixels are not
+//         to be premultiplied after all, because the texture does not
+//         blend or the renderer cannot blend premultiplied alpha
+inline int setUploadBlendMode(SDL_Texture *texture, SDL_Surface *surface, int flags)
+{
+    const bool has_alpha = surface->format->Amask != 0 ||
+        ((flags & PIXEL_CONVERT_COLORKEY) && SDL_HasColorKey(surface));
+    if (!has_alpha)
+    {
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+        return flags & ~PIXEL_CONVERT_PREMULTIPLY;
+    }
+    if ((flags & PIXEL_CONVERT_PREMULTIPLY) &&
+        SDL_SetTextureBlendMode(texture, premultipliedBlendMode()) == 0)
+    {
+        return flags;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return flags & ~PIXEL_CONVERT_PREMULTIPLY;
+}
+
+// Stand in for SDL_CreateTextureFromSurface that converts straight to the
+// renderer's native format with the SIMD kernels. Formats the kernels do
+// not handle, eg. paletted images, go through SDL_ConvertSurfaceFormat
+// first. The surface is not freed.
+// @param ren The renderer to create the texture on
+// @param surface The pixels to upload
+// @param flags PixelConvertFlags. If the renderer cannot do premultiplied
+//        blending (the software renderer cannot) the texture is left
+//        straight alpha instead.
+// @return the texture, or nullptr if something went wrong
+inline SDL_Texture* createTextureFromSurfaceFast(SDL_Renderer *ren, SDL_Surface *surface,
+    int flags = PIXEL_CONVERT_COLORKEY)
+{
+    const Uint32 format = nativeTextureFormat(ren);
+    SDL_Texture *texture = SDL_CreateTexture(ren, format, SDL_TEXTUREACCESS_STATIC,
+        surface->w, surface->h);
+    if (texture == nullptr)
+    {
+        std::cout << "SDL_CreateTexture" << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    flags = setUploadBlendMode(texture, surface, flags);
+
+    SDL_Surface *source = surface;
+    PixelLayout layout;
+    if (!getPixelLayout(surface->format->format, layout))
+    {
+        // Expanding keeps the color key, so it is still applied below
+        source = SDL_ConvertSurfaceFormat(surface, format, 0);
+        if (source == nullptr)
+        {
+            std::cout << "SDL_ConvertSurfaceFormat" << SDL_GetError() << std::endl;
+            SDL_DestroyTexture(texture);
+            return nullptr;
+        }
+    }
+
+    std::vector<Uint32> pixels(size_t(surface->w) * surface->h);
+    const int pitch = surface->w * 4;
+    bool ok = convertPixels(source, format, pixels.data(), pitch, flags) &&
+        SDL_UpdateTexture(texture, nullptr, pixels.data(), pitch) == 0;
+    if (source != surface)
+    {
+        SDL_FreeSurface(source);
+    }
+    if (!ok)
+    {
+        std::cout << "SDL_UpdateTexture" << SDL_GetError() << std::endl;
+        SDL_DestroyTexture(texture);
+        return nullptr;
+    }
+    return texture;
+}
+
+#endif
@@ -0,0 +1,305 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+
+// Frame profiler for the main loop. Build with -DENABLE_PROFILER to turn
+// it on, otherwise every PROFILE_* macro below expands to nothing and the
+// profiler costs nothing at all.
+//
+//   while (!quit)
+//   {
+//       PROFILE_FRAME();
+//       {
+//           PROFILE_ZONE("events");
+//           ...
+//       }
+//   }
+//   PROFILE_REPORT(std::cout);
+//   PROFILE_WRITE_TRACE("trace.json");
+//
+// The trace file can be opened in chrome://tracing or ui.perfetto.dev
+
+// Fixed size history of samples, the oldest are overwritten once full
+class ProfileRing
+{
+public:
+    explicit ProfileRing(size_t capacity = 512)
+        : samples(capacity, 0.0), next(0), count(0)
+    {
+    }
+
+    void push(double value)
+    {
+        samples[next] = value;
+        next = (next + 1) % samples.size();
+        if (count < samples.size())
+        {
+            ++count;
+        }
+    }
+
+    // @param p Which percentile to get, 0.5 for the median
+    // @return the sample at that percentile, 0 if there are no samples
+    double percentile(double p) const
+    {
+        if (count == 0)
+        {
+            return 0.0;
+        }
+        std::vector<double> sorted(samples.begin(), samples.begin() + count);
+        size_t rank = size_t(p * (count - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    double last() const
+    {
+        if (count == 0)
+        {
+            return 0.0;
+        }
+        return samples[(next + samples.size() - 1) % samples.size()];
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+private:
+    std::vector<double> samples;
+    size_t next;
+    size_t count;
+};
+
+// A completed zone, kept for the Chrome trace export
+struct ProfileTraceEvent
+{
+    int zone;
+    Uint64 start;
+    Uint64 end;
+};
+
+class Profiler
+{
+public:
+    static Profiler& instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // Get the id for a zone name, registering it the first time
+    // @param name Name of the zone, must outlive the profiler (eg. a literal)
+    int zoneId(const char *name)
+    {
+        for (size_t i = 0; i < zone_names.size(); ++i)
+        {
+            if (zone_names[i] == name)
+            {
+                return int(i);
+            }
+        }
+        zone_names.push_back(name);
+        zone_times.push_back(ProfileRing());
+        return int(zone_names.size() - 1);
+    }
+
+    // Record the time spent in a zone
+    // @param zone Id from zoneId
+    // @param start Performance counter value when the zone was entered
+    // @param end Performance counter value when the zone was left
+    void record(int zone, Uint64 start, Uint64 end)
+    {
+        zone_times[zone].push(toMilliseconds(end - start));
+        if (trace.size() < max_trace_events)
+        {
+            ProfileTraceEvent event;
+            event.zone = zone;
+            event.start = start;
+            event.end = end;
+            trace.push_back(event);
+        }
+    }
+
+    // Mark the boundary between two frames. Call once at the top of the
+    // main loop, the time since the previous call is one frame
+    void frameMark()
+    {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (frame_start != 0)
+        {
+            frame_times.push(toMilliseconds(now - frame_start));
+            frame_draw_calls.push(double(draw_calls));
+            record(frameZone(), frame_start, now);
+        }
+        frame_start = now;
+        draw_calls = 0;
+    }
+
+    void countDrawCall()
+    {
+        ++draw_calls;
+    }
+
+    // @return frame time in milliseconds at a percentile, eg. 0.99
+    double framePercentile(double p) const
+    {
+        return frame_times.percentile(p);
+    }
+
+    // @return draw calls per frame at a percentile
+    double drawCallPercentile(double p) const
+    {
+        return frame_draw_calls.percentile(p);
+    }
+
+    // @return time in milliseconds spent in a zone at a percentile
+    double zonePercentile(int zone, double p) const
+    {
+        return zone_times[zone].percentile(p);
+    }
+
+    size_t zoneCount() const
+    {
+        return zone_names.size();
+    }
+
+    const char* zoneName(int zone) const
+    {
+        return zone_names[zone];
+    }
+
+    // Print p50/p99 for frames, draw calls and every zone
+    // @param os The output stream to write the report to
+    void printReport(std::ostream &os) const
+    {
+        os << "frame p50=" << framePercentile(0.5) << "ms"
+           << " p99=" << framePercentile(0.99) << "ms"
+           << " draws p50=" << drawCallPercentile(0.5)
+           << " draws p99=" << drawCallPercentile(0.99) << std::endl;
+        for (size_t i = 0; i < zone_names.size(); ++i)
+        {
+            if (int(i) == frame_zone)
+            {
+                continue;
+            }
+            os << "  " << zone_names[i]
+               << " p50=" << zonePercentile(int(i), 0.5) << "ms"
+               << " p99=" << zonePercentile(int(i), 0.99) << "ms" << std::endl;
+        }
+    }
+
+    // Write every recorded zone as a Chrome trace event file
+    // @param file Path of the JSON file to write
+    // @return false if the file could not be written
+    bool writeChromeTrace(const std::string &file) const
+    {
+        std::ofstream out(file.c_str());
+        if (!out)
+        {
+            std::cerr << "Could not write trace " << file << std::endl;
+            return false;
+        }
+
+        const Uint64 origin = trace.empty() ? 0 : trace[0].start;
+        out << "{\"traceEvents\":[";
+        for (size_t i = 0; i < trace.size(); ++i)
+        {
+            const ProfileTraceEvent &event = trace[i];
+            out << (i == 0 ? "" : ",") << "\n"
+                << "{\"name\":\"" << zone_names[event.zone] << "\""
+                << ",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+                << ",\"ts\":" << toMicroseconds(event.start - origin)
+                << ",\"dur\":" << toMicroseconds(event.end - event.start) << "}";
+        }
+        out << "\n]}" << std::endl;
+        return bool(out);
+    }
+
+private:
+    Profiler()
+        : frequency(double(SDL_GetPerformanceFrequency())), frame_start(0),
+          draw_calls(0), frame_zone(-1), max_trace_events(100000)
+    {
+    }
+
+    int frameZone()
+    {
+        if (frame_zone < 0)
+        {
+            frame_zone = zoneId("frame");
+        }
+        return frame_zone;
+    }
+
+    double toMilliseconds(Uint64 ticks) const
+    {
+        return ticks * 1000.0 / frequency;
+    }
+
+    double toMicroseconds(Uint64 ticks) const
+    {
+        return ticks * 1000000.0 / frequency;
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    double frequency;
+    Uint64 frame_start;
+    int draw_calls;
+    int frame_zone;
+    size_t max_trace_events;
+    ProfileRing frame_times;
+    ProfileRing frame_draw_calls;
+    std::vector<const char*> zone_names;
+    std::vector<ProfileRing> zone_times;
+    std::vector<ProfileTraceEvent> trace;
+};
+
+// Times the enclosing scope
+class ProfileScope
+{
+public:
+    explicit ProfileScope(int zone)
+        : zone(zone), start(SDL_GetPerformanceCounter())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        Profiler::instance().record(zone, start, SDL_GetPerformanceCounter());
+    }
+
+private:
+    int zone;
+    Uint64 start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILER
+    #define PROFILE_ZONE(name) \
+        static const int PROFILE_CONCAT(profile_zone_, __LINE__) = Profiler::instance().zoneId(name); \
+        ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_zone_, __LINE__))
+    #define PROFILE_FRAME() Profiler::instance().frameMark()
+    #define PROFILE_DRAW_CALL() Profiler::instance().countDrawCall()
+    #define PROFILE_REPORT(os) Profiler::instance().printReport(os)
+    #define PROFILE_WRITE_TRACE(file) Profiler::instance().writeChromeTrace(file)
+#else
+    #define PROFILE_ZONE(name) do {} while (0)
+    #define PROFILE_FRAME() do {} while (0)
+    #define PROFILE_DRAW_CALL() do {} while (0)
+    #define PROFILE_REPORT(os) do {} while (0)
+    #define PROFILE_WRITE_TRACE(file) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <SDL2/SDL.h>
+#include "profiler.h"
+#include "glyph_atlas.h"
+
+// Draw the profiler's frame and zone timings as text, one line per
+// zone, using the same glyph atlas text path as lesson6
+// @param text The text engine to draw with
+// @param fontFile The font to draw the stats in
+// @param x The x coordinate of the top left of the overlay
+// @param y The y coordinate of the top left of the overlay
+inline void drawProfilerOverlay(TextEngine &text, const std::string &fontFile, int x, int y)
+{
+    const int FONT_SIZE = 12;
+    const SDL_Color color = {255, 255, 0, 255};
+    Profiler &profiler = Profiler::instance();
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2)
+         << "frame p50 " << profiler.framePercentile(0.5)
+         << "ms p99 " << profiler.framePercentile(0.99)
+         << "ms draws " << int(profiler.drawCallPercentile(0.5));
+    text.drawText(line.str(), fontFile, color, FONT_SIZE, x, y);
+
+    int line_height = 0;
+    text.sizeText(line.str(), fontFile, FONT_SIZE, nullptr, &line_height);
+    for (size_t i = 0; i < profiler.zoneCount(); ++i)
+    {
+        y += line_height;
+        line.str("");
+        line << profiler.zoneName(int(i))
+             << " p50 " << profiler.zonePercentile(int(i), 0.5)
+             << "ms p99 " << profiler.zonePercentile(int(i), 0.99) << "ms";
+        text.drawText(line.str(), fontFile, color, FONT_SIZE, x, y);
+    }
+}
+
+#ifdef ENABLE_PROFILER
+    #define PROFILE_OVERLAY(text, font, x, y) drawProfilerOverlay(text, font, x, y)
+#else
+    #define PROFILE_OVERLAY(text, font, x, y) do {} while (0)
+#endif
+
+#endif
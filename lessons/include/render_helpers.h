@@ -0,0 +1,52 @@
+#ifndef RENDER_HELPERS_H
+#define RENDER_HELPERS_H
+
+#include <iostream>
+#include <string>
+#include <SDL2/SDL.h>
+#include "texture.h"
+
+// Log an SDL error with some error message to the output stream
+// of our choice.
+// @param os The output stream to write the message to
+// @param msg The error message to write, format will be
+// "msg error: SDL_GetError()"
+void logSDLError(std::ostream &os, const std::string &msg);
+
+// Loads an image into a texture on the rendering device
+// @param file The image file to load
+// @param ren The renderer to load the texture onto
+// @return the loaded texture, texture member is nullptr if something went wrong
+Texture loadTexture(const std::string &file, SDL_Renderer *ren);
+
+// Draw an SDL_Texture to an SDL_Renderer at position x, y, with some desired
+// width and height
+// @param tex The source texture we want to draw
+// @param ren The renderer we want to draw to
+// @param x The x coordinate to draw to
+// @param y The y coordinate to draw to
+// @param w The width of the texture to draw
+// @param h The height of the texture to draw
+void renderTexture(const Texture &tex, SDL_Renderer *ren, int x, int y, int w, int h);
+
+// Draw an SDL_Texture to an SDL_Renderer into a destination rectangle
+// @param tex The source texture we want to draw
+// @param ren The renderer we want to draw to
+// @param dst The destination rectangle to render the texture to
+// @param clip The sub-section of the texture to draw (clipping rect)
+//             default of nullptr draws the texture's width x height
+void renderTexture(const Texture &tex, SDL_Renderer *ren, SDL_Rect dst, const SDL_Rect *clip = nullptr);
+
+// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
+// the texture's width and height and taking a clip of the texture if
+// if a clip rectangle is passed. If a clip is present, the clip's width
+// and height will be used in place of the texture's dimensions
+// @param tex The source texture we want to draw
+// @param ren The renderer we want to draw to
+// @param x The x coordinate to draw to
+// @param y The y coordinate to draw to
+// @param clip The sub-section of the texture to draw (clipping rect)
+//             default of nullptr draws the entire texture
+void renderTexture(const Texture &tex, SDL_Renderer *ren, int x, int y, const SDL_Rect *clip = nullptr);
+
+#endif
@@ -0,0 +1,665 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "offscreen.h"
+
+// A recorded run of a lesson's main loop: for every frame the input
+// events it handled, how many fixed updates it ran and the draw commands
+// it issued, along with how long it took and a hash of what it drew.
+// Playing the events and update counts back reruns the exact same
+// workload, headless and as fast as possible, so runs can be compared
+// between builds. Layout of the file, all numbers little endian:
+//
+//   header    "SDLREPLY", Uint32 version, Uint32 width, Uint32 height,
+//             Uint32 frame count, Uint32 event count, Uint32 draw count
+//   frames    per frame: varint updates, varint microseconds, Uint32
+//             hash, varint events, varint draws
+//   events    per event: varint type, signed varints a, b, c, varint flags
+//   draws     per draw: varint texture, varint has source, source x y w h
+//             as signed varints if it has one, destination x y w h
+//
+// Varints are 7 bits per byte, low bits first, with the top bit set on
+// every byte but the last. Signed values are zigzag encoded first so
+// small negative numbers stay small.
+const char REPLAY_MAGIC[8] = { 'S', 'D', 'L', 'R', 'E', 'P', 'L', 'Y' };
+const Uint32 REPLAY_VERSION = 1;
+
+// Texture id recorded for custom draws, eg. a TextObject in a scene
+const Uint32 REPLAY_CUSTOM_DRAW = 0;
+
+// The parts of an SDL_Event a replay needs. What a, b and c hold
+// depends on the type:
+//   keys           sym, scancode, modifiers, flags is the repeat count
+//   mouse buttons  button, x, y, flags is the click count
+//   mouse motion   button state, x, y
+//   mouse wheel    0, x, y
+//   window         window event, data1, data2
+struct ReplayEvent
+{
+    Uint32 type;
+    Sint32 a;
+    Sint32 b;
+    Sint32 c;
+    Uint32 flags;
+};
+
+// One SDL_RenderCopy, with the texture identified by the order textures
+// were first drawn in during the run (from 1)
+struct ReplayDraw
+{
+    Uint32 texture;
+    bool has_src;
+    SDL_Rect src;
+    SDL_Rect dst;
+};
+
+// One frame of a run, its events and draws are ranges of the log's lists
+struct ReplayFrame
+{
+    Uint32 updates;
+    Uint32 micros;
+
+    // Hash of the finished frame's pixels, 0 if nothing hashed it (eg.
+    // it was drawn to a window)
+    Uint32 hash;
+
+    Uint32 first_event;
+    Uint32 num_events;
+    Uint32 first_draw;
+    Uint32 num_draws;
+};
+
+// Records a run frame by frame and saves it, or loads one to play back.
+// Events, draws and frames go into flat lists so recording a frame only
+// allocates when a list has to grow.
+class ReplayLog
+{
+public:
+    // @param width Width of the frames of the run
+    // @param height Height of the frames of the run
+    ReplayLog(int width = 0, int height = 0)
+        : width(width), height(height), recording(false)
+    {
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Start recording a frame
+    void beginFrame()
+    {
+        ReplayFrame frame;
+        std::memset(&frame, 0, sizeof(frame));
+        frame.first_event = Uint32(events.size());
+        frame.first_draw = Uint32(draws.size());
+        frames.push_back(frame);
+        recording = true;
+    }
+
+    // Record an event handled this frame. Events a replay cannot rebuild
+    // (text input, controllers, ...) are skipped.
+    void recordEvent(const SDL_Event &event)
+    {
+        if (!recording)
+        {
+            return;
+        }
+        ReplayEvent recorded;
+        std::memset(&recorded, 0, sizeof(recorded));
+        recorded.type = event.type;
+        switch (event.type)
+        {
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                recorded.a = event.key.keysym.sym;
+                recorded.b = event.key.keysym.scancode;
+                recorded.c = event.key.keysym.mod;
+                recorded.flags = event.key.repeat;
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+                recorded.a = event.button.button;
+                recorded.b = event.button.x;
+                recorded.c = event.button.y;
+                recorded.flags = event.button.clicks;
+                break;
+            case SDL_MOUSEMOTION:
+                recorded.a = Sint32(event.motion.state);
+                recorded.b = event.motion.x;
+                recorded.c = event.motion.y;
+                break;
+            case SDL_MOUSEWHEEL:
+                recorded.b = event.wheel.x;
+                recorded.c = event.wheel.y;
+                break;
+            case SDL_WINDOWEVENT:
+                recorded.a = event.window.event;
+                recorded.b = event.window.data1;
+                recorded.c = event.window.data2;
+                break;
+            case SDL_QUIT:
+                break;
+            default:
+                return;
+        }
+        events.push_back(recorded);
+        ++frames.back().num_events;
+    }
+
+    // Record how many fixed updates ran this frame
+    void recordUpdates(Uint32 updates)
+    {
+        if (recording)
+        {
+            frames.back().updates = updates;
+        }
+    }
+
+    // Record a draw this frame
+    // @param texture The texture drawn, nullptr for a custom draw
+    // @param src The part of the texture drawn, nullptr for all of it
+    // @param dst Where it was drawn
+    void recordDraw(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect &dst)
+    {
+        if (!recording)
+        {
+            return;
+        }
+        ReplayDraw draw;
+        std::memset(&draw, 0, sizeof(draw));
+        draw.texture = REPLAY_CUSTOM_DRAW;
+        if (texture != nullptr)
+        {
+            auto found = texture_ids.find(texture);
+            if (found == texture_ids.end())
+            {
+                found = texture_ids.insert(std::make_pair(texture,
+                    Uint32(texture_ids.size() + 1))).first;
+            }
+            draw.texture = found->second;
+        }
+        draw.has_src = src != nullptr;
+        if (src != nullptr)
+        {
+            draw.src = *src;
+        }
+        draw.dst = dst;
+        draws.push_back(draw);
+        ++frames.back().num_draws;
+    }
+
+    // Record the hash of this frame's pixels, see hashPixels in
+    // offscreen.h
+    void recordHash(Uint32 hash)
+    {
+        if (recording)
+        {
+            frames.back().hash = hash;
+        }
+    }
+
+    // Finish recording the frame
+    // @param micros How long the frame took in microseconds
+    void endFrame(Uint32 micros)
+    {
+        if (recording)
+        {
+            frames.back().micros = micros;
+        }
+        recording = false;
+    }
+
+    size_t getFrameCount() const
+    {
+        return frames.size();
+    }
+
+    const ReplayFrame& frame(size_t index) const
+    {
+        return frames[index];
+    }
+
+    const ReplayEvent& event(size_t index) const
+    {
+        return events[index];
+    }
+
+    const ReplayDraw& draw(size_t index) const
+    {
+        return draws[index];
+    }
+
+    // Put a frame's events on the SDL event queue, in the order they
+    // were recorded, to be read by the next poll
+    // @return how many events were pushed
+    int pushEvents(size_t index) const
+    {
+        const ReplayFrame &played = frames[index];
+        int pushed = 0;
+        for (Uint32 i = 0; i < played.num_events; ++i)
+        {
+            SDL_Event sdl_event;
+            makeEvent(events[played.first_event + i], sdl_event);
+            if (SDL_PushEvent(&sdl_event) == 1)
+            {
+                ++pushed;
+            }
+        }
+        return pushed;
+    }
+
+    // Rebuild an SDL_Event from a recorded one. The timestamp is left for
+    // SDL_PushEvent to fill in.
+    static void makeEvent(const ReplayEvent &recorded, SDL_Event &event)
+    {
+        SDL_zero(event);
+        event.type = recorded.type;
+        switch (recorded.type)
+        {
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                event.key.state = recorded.type == SDL_KEYDOWN ? SDL_PRESSED : SDL_RELEASED;
+                event.key.keysym.sym = recorded.a;
+                event.key.keysym.scancode = SDL_Scancode(recorded.b);
+                event.key.keysym.mod = Uint16(recorded.c);
+                event.key.repeat = Uint8(recorded.flags);
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+                event.button.state = recorded.type == SDL_MOUSEBUTTONDOWN ? SDL_PRESSED : SDL_RELEASED;
+                event.button.button = Uint8(recorded.a);
+                event.button.x = recorded.b;
+                event.button.y = recorded.c;
+                event.button.clicks = Uint8(recorded.flags);
+                break;
+            case SDL_MOUSEMOTION:
+                event.motion.state = Uint32(recorded.a);
+                event.motion.x = recorded.b;
+                event.motion.y = recorded.c;
+                break;
+            case SDL_MOUSEWHEEL:
+                event.wheel.x = recorded.b;
+                event.wheel.y = recorded.c;
+                break;
+            case SDL_WINDOWEVENT:
+                event.window.event = Uint8(recorded.a);
+                event.window.data1 = recorded.b;
+                event.window.data2 = recorded.c;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Compare a run against a reference run of the same log. Only frames
+    // the reference hashed are compared, on their hashes and draws: a run
+    // recorded live draws only what changed, while a replay draws every
+    // frame in full, so a live recording is a workload to replay but not
+    // something to check against. Replay it once with --record to make
+    // the reference.
+    // @param reference The run to compare against
+    // @param os Where to describe the first difference
+    // @return how many frames differ, counting frames only one run has
+    long compare(const ReplayLog &reference, std::ostream &os) const
+    {
+        const size_t common = std::min(frames.size(), reference.frames.size());
+        long differing = long(std::max(frames.size(), reference.frames.size()) - common);
+        bool reported = false;
+        for (size_t i = 0; i < common; ++i)
+        {
+            const ReplayFrame &ours = frames[i];
+            const ReplayFrame &theirs = reference.frames[i];
+            if (theirs.hash == 0)
+            {
+                continue;
+            }
+            const bool hash_differs = ours.hash != theirs.hash;
+            const bool draws_differ = !sameDraws(ours, reference, theirs);
+            if (!hash_differs && !draws_differ)
+            {
+                continue;
+            }
+            if (!reported)
+            {
+                os << "replay first difference at frame " << i << ":"
+                   << (hash_differs ? " hash" : "") << (draws_differ ? " draws" : "")
+                   << std::endl;
+                reported = true;
+            }
+            ++differing;
+        }
+        if (frames.size() != reference.frames.size())
+        {
+            os << "replay frame count " << frames.size() << " reference "
+               << reference.frames.size() << std::endl;
+        }
+        return differing;
+    }
+
+    // @return every frame hash folded into one, to tell at a glance
+    //         whether two runs drew the same thing
+    Uint32 getRunHash() const
+    {
+        Uint32 hash = 2166136261u;
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            hash = (hash ^ frames[i].hash) * 16777619u;
+        }
+        return hash;
+    }
+
+    // Write the frame times in the benchmarks' format, a
+    // "name iterations=N seconds=S rate=R frames/s" line for the whole
+    // run, then name_p50_us, name_p99_us and name_max_us lines with that
+    // frame time in microseconds as the iteration count
+    void reportTimings(std::ostream &os, const std::string &name) const
+    {
+        std::vector<Uint32> sorted(frames.size());
+        Uint64 total = 0;
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            sorted[i] = frames[i].micros;
+            total += frames[i].micros;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        const double seconds = total / 1000000.0;
+        auto report = [&os, seconds](const std::string &line, long iterations)
+        {
+            const double rate = seconds > 0.0 ? iterations / seconds : 0.0;
+            os << line
+               << " iterations=" << iterations
+               << " seconds=" << seconds
+               << " rate=" << rate << " frames/s" << std::endl;
+        };
+        auto percentile = [&sorted](double fraction)
+        {
+            if (sorted.empty())
+            {
+                return 0L;
+            }
+            const size_t index = std::min(sorted.size() - 1, size_t(fraction * sorted.size()));
+            return long(sorted[index]);
+        };
+        report(name, long(frames.size()));
+        report(name + "_p50_us", percentile(0.5));
+        report(name + "_p99_us", percentile(0.99));
+        report(name + "_max_us", percentile(1.0));
+    }
+
+    // Write the log to a file
+    // @return false if the file could not be written
+    bool save(const std::string &file) const
+    {
+        std::vector<Uint8> bytes;
+        bytes.insert(bytes.end(), REPLAY_MAGIC, REPLAY_MAGIC + sizeof(REPLAY_MAGIC));
+        putUint32(bytes, REPLAY_VERSION);
+        putUint32(bytes, Uint32(width));
+        putUint32(bytes, Uint32(height));
+        putUint32(bytes, Uint32(frames.size()));
+        putUint32(bytes, Uint32(events.size()));
+        putUint32(bytes, Uint32(draws.size()));
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            putVarint(bytes, frames[i].updates);
+            putVarint(bytes, frames[i].micros);
+            putUint32(bytes, frames[i].hash);
+            putVarint(bytes, frames[i].num_events);
+            putVarint(bytes, frames[i].num_draws);
+        }
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            putVarint(bytes, events[i].type);
+            putSigned(bytes, events[i].a);
+            putSigned(bytes, events[i].b);
+            putSigned(bytes, events[i].c);
+            putVarint(bytes, events[i].flags);
+        }
+        for (size_t i = 0; i < draws.size(); ++i)
+        {
+            putVarint(bytes, draws[i].texture);
+            putVarint(bytes, draws[i].has_src ? 1 : 0);
+            if (draws[i].has_src)
+            {
+                putRect(bytes, draws[i].src);
+            }
+            putRect(bytes, draws[i].dst);
+        }
+
+        std::ofstream out(file.c_str(), std::ios::binary);
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        if (!out)
+        {
+            std::cout << "Could not write replay " << file << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Read a log written by save, replacing anything recorded
+    // @return false if the file is missing or not a valid replay
+    bool load(const std::string &file)
+    {
+        std::ifstream in(file.c_str(), std::ios::binary);
+        if (!in)
+        {
+            std::cout << "Could not read replay " << file << std::endl;
+            return false;
+        }
+        std::vector<Uint8> bytes((std::istreambuf_iterator<char>(in)),
+            std::istreambuf_iterator<char>());
+        if (!parse(bytes))
+        {
+            std::cout << "Not a valid replay " << file << std::endl;
+            frames.clear();
+            events.clear();
+            draws.clear();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static void putUint32(std::vector<Uint8> &bytes, Uint32 value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            bytes.push_back(Uint8(value >> (i * 8)));
+        }
+    }
+
+    static void putVarint(std::vector<Uint8> &bytes, Uint32 value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(Uint8(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(Uint8(value));
+    }
+
+    static void putSigned(std::vector<Uint8> &bytes, Sint32 value)
+    {
+        putVarint(bytes, (Uint32(value) << 1) ^ Uint32(value >> 31));
+    }
+
+    static void putRect(std::vector<Uint8> &bytes, const SDL_Rect &rect)
+    {
+        putSigned(bytes, rect.x);
+        putSigned(bytes, rect.y);
+        putSigned(bytes, rect.w);
+        putSigned(bytes, rect.h);
+    }
+
+    // Reads values out of a loaded file, failing once it runs past the end
+    struct Reader
+    {
+        const std::vector<Uint8> &bytes;
+        size_t at;
+        bool ok;
+
+        Uint32 uint32()
+        {
+            if (at + 4 > bytes.size())
+            {
+                ok = false;
+                return 0;
+            }
+            Uint32 value = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                value |= Uint32(bytes[at++]) << (i * 8);
+            }
+            return value;
+        }
+
+        Uint32 varint()
+        {
+            Uint32 value = 0;
+            for (int shift = 0; shift < 35; shift += 7)
+            {
+                if (at >= bytes.size())
+                {
+                    ok = false;
+                    return 0;
+                }
+                const Uint8 byte = bytes[at++];
+                value |= Uint32(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+            ok = false;
+            return 0;
+        }
+
+        Sint32 signedVarint()
+        {
+            const Uint32 value = varint();
+            return Sint32(value >> 1) ^ -Sint32(value & 1);
+        }
+
+        void rect(SDL_Rect &rect)
+        {
+            rect.x = signedVarint();
+            rect.y = signedVarint();
+            rect.w = signedVarint();
+            rect.h = signedVarint();
+        }
+    };
+
+    bool parse(const std::vector<Uint8> &bytes)
+    {
+        if (bytes.size() < sizeof(REPLAY_MAGIC) ||
+            std::memcmp(bytes.data(), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0)
+        {
+            return false;
+        }
+        Reader in = { bytes, sizeof(REPLAY_MAGIC), true };
+        if (in.uint32() != REPLAY_VERSION)
+        {
+            return false;
+        }
+        width = int(in.uint32());
+        height = int(in.uint32());
+        const Uint32 num_frames = in.uint32();
+        const Uint32 num_events = in.uint32();
+        const Uint32 num_draws = in.uint32();
+        // Every record takes at least a byte, so a count past the size
+        // of the file is corrupt and not worth allocating for
+        if (!in.ok || num_frames > bytes.size() || num_events > bytes.size() ||
+            num_draws > bytes.size())
+        {
+            return false;
+        }
+
+        frames.resize(num_frames);
+        Uint64 total_events = 0;
+        Uint64 total_draws = 0;
+        for (Uint32 i = 0; i < num_frames; ++i)
+        {
+            ReplayFrame &loaded = frames[i];
+            loaded.updates = in.varint();
+            loaded.micros = in.varint();
+            loaded.hash = in.uint32();
+            loaded.num_events = in.varint();
+            loaded.num_draws = in.varint();
+            loaded.first_event = Uint32(total_events);
+            loaded.first_draw = Uint32(total_draws);
+            total_events += loaded.num_events;
+            total_draws += loaded.num_draws;
+        }
+        if (!in.ok || total_events != num_events || total_draws != num_draws)
+        {
+            return false;
+        }
+
+        events.resize(num_events);
+        for (Uint32 i = 0; i < num_events; ++i)
+        {
+            events[i].type = in.varint();
+            events[i].a = in.signedVarint();
+            events[i].b = in.signedVarint();
+            events[i].c = in.signedVarint();
+            events[i].flags = in.varint();
+        }
+        draws.resize(num_draws);
+        for (Uint32 i = 0; i < num_draws; ++i)
+        {
+            draws[i].texture = in.varint();
+            draws[i].has_src = in.varint() != 0;
+            if (draws[i].has_src)
+            {
+                in.rect(draws[i].src);
+            }
+            else
+            {
+                SDL_zero(draws[i].src);
+            }
+            in.rect(draws[i].dst);
+        }
+        texture_ids.clear();
+        recording = false;
+        return in.ok;
+    }
+
+    bool sameDraws(const ReplayFrame &ours, const ReplayLog &reference,
+        const ReplayFrame &theirs) const
+    {
+        if (ours.num_draws != theirs.num_draws)
+        {
+            return false;
+        }
+        for (Uint32 i = 0; i < ours.num_draws; ++i)
+        {
+            const ReplayDraw &a = draws[ours.first_draw + i];
+            const ReplayDraw &b = reference.draws[theirs.first_draw + i];
+            if (a.texture != b.texture || a.has_src != b.has_src ||
+                (a.has_src && !SDL_RectEquals(&a.src, &b.src)) ||
+                !SDL_RectEquals(&a.dst, &b.dst))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int width;
+    int height;
+    bool recording;
+    std::vector<ReplayFrame> frames;
+    std::vector<ReplayEvent> events;
+    std::vector<ReplayDraw> draws;
+    std::unordered_map<SDL_Texture*, Uint32> texture_ids;
+};
+
+#endif
@@ -0,0 +1,452 @@
+#ifndef RETAINED_SCENE_H
+#define RETAINED_SCENE_H
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "texture.h"
+#include "profiler.h"
+#include "replay.h"
+
+// Most separate damaged areas to repaint one by one, past this the whole
+// screen is redrawn
+const int RETAINED_SCENE_MAX_DAMAGE_RECTS = 8;
+
+// One thing on screen in a RetainedScene
+struct SceneNode
+{
+    // Where the node is drawn, also the area damaged when it changes
+    SDL_Rect bounds;
+
+    // Drawn from clip (or the whole texture if has_clip is false) into
+    // bounds, unless draw is set, in which case draw is called instead
+    Texture texture;
+    SDL_Rect clip;
+    bool has_clip;
+    std::function<void(const SDL_Rect&)> draw;
+
+    int z;
+    bool visible;
+    bool used;
+};
+
+// Keeps the scene between frames and only redraws when something in it
+// changed. Changes add the old and new area of the node to a damage list.
+// When nothing is damaged render() does nothing at all, so an idle scene
+// costs no drawing and no present.
+//
+// SDL leaves the window's backbuffer undefined after SDL_RenderPresent,
+// so the scene is kept in a target texture the size of the scene
+// instead. Only the damaged rectangles of it are cleared and redrawn,
+// each under SDL_RenderSetClipRect, and then the whole texture is copied
+// to the window. If the renderer has no target textures any damage
+// redraws the whole scene. The scene owns the texture, destroy it before
+// the renderer.
+class RetainedScene
+{
+public:
+    // @param ren The renderer to draw with
+    // @param width Width of the area the scene covers, usually the window
+    // @param height Height of the area the scene covers
+    RetainedScene(SDL_Renderer *ren, int width, int height)
+        : renderer(ren), canvas(nullptr), full_damage(true), order_dirty(false),
+          redraws(0), recorder(nullptr)
+    {
+        screen.x = 0;
+        screen.y = 0;
+        screen.w = width;
+        screen.h = height;
+        background.r = 0;
+        background.g = 0;
+        background.b = 0;
+        background.a = 255;
+
+        SDL_RendererInfo info;
+        partial = SDL_GetRendererInfo(ren, &info) == 0 &&
+            (info.flags & SDL_RENDERER_TARGETTEXTURE) != 0;
+    }
+
+    ~RetainedScene()
+    {
+        if (canvas != nullptr)
+        {
+            SDL_DestroyTexture(canvas);
+        }
+    }
+
+    // Add a texture to the scene
+    // @param tex The texture to draw, the scene does not own it
+    // @param x The x coordinate to draw to
+    // @param y The y coordinate to draw to
+    // @param clip The part of the texture to draw, nullptr for all of it
+    // @param z Nodes with a higher z are drawn on top
+    // @return the id of the new node
+    int add(const Texture &tex, int x, int y, const SDL_Rect *clip = nullptr, int z = 0)
+    {
+        SceneNode &node = newNode(z);
+        node.texture = tex;
+        node.has_clip = clip != nullptr;
+        if (clip != nullptr)
+        {
+            node.clip = *clip;
+        }
+        node.bounds.x = x;
+        node.bounds.y = y;
+        node.bounds.w = clip != nullptr ? clip->w : tex.width;
+        node.bounds.h = clip != nullptr ? clip->h : tex.height;
+        damage(node.bounds);
+        return int(&node - &nodes[0]);
+    }
+
+    // Add something the scene cannot draw itself, eg. text from a
+    // TextEngine. draw is called with the node's bounds whenever part of
+    // them is repainted, and must not draw outside them.
+    // @return the id of the new node
+    int addCustom(const SDL_Rect &bounds, const std::function<void(const SDL_Rect&)> &draw,
+        int z = 0)
+    {
+        SceneNode &node = newNode(z);
+        node.bounds = bounds;
+        node.draw = draw;
+        damage(node.bounds);
+        return int(&node - &nodes[0]);
+    }
+
+    void remove(int id)
+    {
+        if (nodes[id].visible)
+        {
+            damage(nodes[id].bounds);
+        }
+        nodes[id] = SceneNode();
+        nodes[id].used = false;
+        nodes[id].visible = false;
+        order_dirty = true;
+    }
+
+    void setPosition(int id, int x, int y)
+    {
+        SceneNode &node = nodes[id];
+        if (node.bounds.x != x || node.bounds.y != y)
+        {
+            SDL_Rect moved = node.bounds;
+            moved.x = x;
+            moved.y = y;
+            setBounds(node, moved);
+        }
+    }
+
+    // Show a different part of a node's texture
+    void setClip(int id, const SDL_Rect &clip)
+    {
+        SceneNode &node = nodes[id];
+        if (!node.has_clip || std::memcmp(&node.clip, &clip, sizeof(clip)) != 0)
+        {
+            node.has_clip = true;
+            node.clip = clip;
+            SDL_Rect resized = { node.bounds.x, node.bounds.y, clip.w, clip.h };
+            setBounds(node, resized);
+        }
+    }
+
+    void setVisible(int id, bool visible)
+    {
+        if (nodes[id].visible != visible)
+        {
+            nodes[id].visible = visible;
+            damage(nodes[id].bounds);
+        }
+    }
+
+    // Mark a node for redrawing when what it shows changed without the
+    // scene knowing, eg. the pixels of its texture or a custom node
+    void markDirty(int id)
+    {
+        damage(nodes[id].bounds);
+    }
+
+    // Redraw everything on the next render
+    void invalidate()
+    {
+        full_damage = true;
+    }
+
+    void setBackground(const SDL_Color &color)
+    {
+        background = color;
+        invalidate();
+    }
+
+    // Turn repainting only damaged areas on or off. When off, any damage
+    // redraws the whole scene straight to the renderer's target, and no
+    // texture is kept. It is on by default if the renderer supports
+    // target textures.
+    void setPartialRepaint(bool enabled)
+    {
+        partial = enabled;
+        if (!partial && canvas != nullptr)
+        {
+            SDL_DestroyTexture(canvas);
+            canvas = nullptr;
+        }
+        invalidate();
+    }
+
+    // Record every node drawn into a log, see ReplayLog
+    void setRecorder(ReplayLog *log)
+    {
+        recorder = log;
+    }
+
+    // Keep the scene correct when the window is uncovered or resized,
+    // or the renderer lost the contents of its target textures
+    void handleEvent(const SDL_Event &event)
+    {
+        if ((event.type == SDL_WINDOWEVENT &&
+             (event.window.event == SDL_WINDOWEVENT_EXPOSED ||
+              event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED ||
+              event.window.event == SDL_WINDOWEVENT_RESTORED)) ||
+            event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET)
+        {
+            invalidate();
+        }
+    }
+
+    // @return true if the next render will draw something
+    bool isDirty() const
+    {
+        return full_damage || !damaged.empty();
+    }
+
+    // Repaint whatever changed since the last call. Does not present,
+    // present only if this returns true.
+    // @return false if nothing changed and nothing was drawn
+    bool render()
+    {
+        if (!isDirty())
+        {
+            return false;
+        }
+        if (order_dirty)
+        {
+            sortNodes();
+        }
+        if (partial && canvas == nullptr && !createCanvas())
+        {
+            partial = false;
+        }
+
+        Uint8 r, g, b, a;
+        SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+        SDL_SetRenderDrawColor(renderer, background.r, background.g, background.b,
+            background.a);
+        SDL_Texture *target = SDL_GetRenderTarget(renderer);
+        if (partial)
+        {
+            SDL_SetRenderTarget(renderer, canvas);
+        }
+
+        if (!partial || full_damage || !mergeDamage())
+        {
+            SDL_RenderClear(renderer);
+            drawNodes(screen);
+        }
+        else
+        {
+            for (size_t i = 0; i < damaged.size(); ++i)
+            {
+                SDL_RenderSetClipRect(renderer, &damaged[i]);
+                SDL_RenderFillRect(renderer, &damaged[i]);
+                drawNodes(damaged[i]);
+            }
+            SDL_RenderSetClipRect(renderer, nullptr);
+        }
+
+        // The backbuffer does not keep anything between presents, so the
+        // whole scene goes to it every time
+        if (partial)
+        {
+            SDL_SetRenderTarget(renderer, target);
+            SDL_RenderCopy(renderer, canvas, nullptr, &screen);
+            PROFILE_DRAW_CALL();
+        }
+
+        SDL_SetRenderDrawColor(renderer, r, g, b, a);
+        damaged.clear();
+        full_damage = false;
+        ++redraws;
+        return true;
+    }
+
+    // @return how many times render actually drew something
+    long getRedraws() const
+    {
+        return redraws;
+    }
+
+    const SceneNode& node(int id) const
+    {
+        return nodes[id];
+    }
+
+private:
+    RetainedScene(const RetainedScene&) = delete;
+    RetainedScene& operator=(const RetainedScene&) = delete;
+
+    // Make the texture the scene is kept in between frames
+    // @return false if the renderer could not make it
+    bool createCanvas()
+    {
+        canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_TARGET, screen.w, screen.h);
+        if (canvas == nullptr)
+        {
+            return false;
+        }
+        // Copied over what is on screen, not blended with it
+        SDL_SetTextureBlendMode(canvas, SDL_BLENDMODE_NONE);
+        full_damage = true;
+        return true;
+    }
+
+    SceneNode& newNode(int z)
+    {
+        size_t index = 0;
+        while (index < nodes.size() && nodes[index].used)
+        {
+            ++index;
+        }
+        if (index == nodes.size())
+        {
+            nodes.push_back(SceneNode());
+        }
+
+        SceneNode &node = nodes[index];
+        node = SceneNode();
+        node.texture = makeTexture(nullptr);
+        node.has_clip = false;
+        node.z = z;
+        node.visible = true;
+        node.used = true;
+        order_dirty = true;
+        return node;
+    }
+
+    void setBounds(SceneNode &node, const SDL_Rect &bounds)
+    {
+        if (node.visible)
+        {
+            damage(node.bounds);
+            damage(bounds);
+        }
+        node.bounds = bounds;
+    }
+
+    void damage(const SDL_Rect &rect)
+    {
+        SDL_Rect visible;
+        if (!full_damage && SDL_IntersectRect(&rect, &screen, &visible))
+        {
+            damaged.push_back(visible);
+        }
+    }
+
+    // Join overlapping damage so no pixel is drawn twice
+    // @return false if the damage is spread so wide that one full redraw
+    //         is cheaper
+    bool mergeDamage()
+    {
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+            for (size_t i = 0; i < damaged.size() && !merged; ++i)
+            {
+                for (size_t j = i + 1; j < damaged.size(); ++j)
+                {
+                    if (SDL_HasIntersection(&damaged[i], &damaged[j]))
+                    {
+                        SDL_UnionRect(&damaged[i], &damaged[j], &damaged[i]);
+                        damaged.erase(damaged.begin() + j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        long area = 0;
+        for (size_t i = 0; i < damaged.size(); ++i)
+        {
+            area += long(damaged[i].w) * damaged[i].h;
+        }
+        return int(damaged.size()) <= RETAINED_SCENE_MAX_DAMAGE_RECTS &&
+            area * 2 < long(screen.w) * screen.h;
+    }
+
+    void sortNodes()
+    {
+        order.clear();
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (nodes[i].used)
+            {
+                order.push_back(int(i));
+            }
+        }
+        // Stable so nodes on the same z draw in the order they were added
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b)
+        {
+            return nodes[a].z < nodes[b].z;
+        });
+        order_dirty = false;
+    }
+
+    // Draw every visible node overlapping an area
+    void drawNodes(const SDL_Rect &area)
+    {
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            const SceneNode &node = nodes[order[i]];
+            if (!node.visible || !SDL_HasIntersection(&node.bounds, &area))
+            {
+                continue;
+            }
+            // Without a clip the texture's width x height is drawn, a
+            // pooled texture can be bigger than that
+            const SDL_Rect content = {0, 0, node.texture.width, node.texture.height};
+            const SDL_Rect *src = node.has_clip ? &node.clip : &content;
+            if (node.draw)
+            {
+                node.draw(node.bounds);
+            }
+            else
+            {
+                SDL_RenderCopy(renderer, node.texture.texture, src, &node.bounds);
+            }
+            PROFILE_DRAW_CALL();
+            if (recorder != nullptr)
+            {
+                recorder->recordDraw(node.draw ? nullptr : node.texture.texture,
+                    node.draw ? nullptr : src, node.bounds);
+            }
+        }
+    }
+
+    SDL_Renderer *renderer;
+    SDL_Texture *canvas;
+    SDL_Rect screen;
+    SDL_Color background;
+    std::vector<SceneNode> nodes;
+    std::vector<int> order;
+    std::vector<SDL_Rect> damaged;
+    bool full_damage;
+    bool partial;
+    bool order_dirty;
+    long redraws;
+    ReplayLog *recorder;
+};
+
+#endif
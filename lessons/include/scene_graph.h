@@ -0,0 +1,362 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "texture.h"
+#include "profiler.h"
+
+// The part of the world shown on screen. World point (x, y) is drawn at
+// the top left of the window.
+struct Camera
+{
+    float x;
+    float y;
+    int width;
+    int height;
+};
+
+// One sprite in a SceneGraph
+struct SceneObject
+{
+    Texture texture;
+    SDL_Rect clip;
+    bool has_clip;
+
+    // Position relative to the parent, or the world if there is none
+    float local_x;
+    float local_y;
+
+    // Which point of the sprite sits at its position, 0,0 is the top
+    // left and 0.5,0.5 the center
+    float pivot_x;
+    float pivot_y;
+
+    // Top left corner in the world, kept up to date from the above
+    float world_x;
+    float world_y;
+    int width;
+    int height;
+
+    int z;
+    bool visible;
+    bool used;
+
+    // Tree links, -1 for none
+    int parent;
+    int first_child;
+    int next_sibling;
+
+    // Where the object is in the spatial grid
+    int cell;
+    int slot;
+};
+
+// Sprites placed in a world bigger than the screen, with a camera that
+// picks what is shown. Objects can be attached to a parent and move with
+// it. A uniform grid over the world indexes objects by the cell their
+// top left corner is in, so finding what the camera sees only looks at
+// the cells under the view instead of every object.
+class SceneGraph
+{
+public:
+    // @param worldWidth Width of the world, objects outside it are still
+    //        found but all share the edge cells
+    // @param worldHeight Height of the world
+    // @param cellSize Size of a grid cell, about the size of a typical
+    //        sprite up to a few times the screen size works well
+    SceneGraph(int worldWidth, int worldHeight, int cellSize = 256)
+        : cell_size(cellSize), max_width(0), max_height(0), first_free(-1), live(0)
+    {
+        columns = std::max((worldWidth + cellSize - 1) / cellSize, 1);
+        rows = std::max((worldHeight + cellSize - 1) / cellSize, 1);
+        cells.resize(size_t(columns) * rows);
+    }
+
+    // Add a sprite to the scene
+    // @param tex The texture to draw, the scene does not own it
+    // @param x The x coordinate, relative to the parent if it has one
+    // @param y The y coordinate, relative to the parent if it has one
+    // @param clip The part of the texture to draw, nullptr for all of it
+    // @param parent Object to attach to, -1 for none
+    // @param z Objects with a higher z are drawn on top
+    // @return the id of the new object
+    int add(const Texture &tex, float x, float y, const SDL_Rect *clip = nullptr,
+        int parent = -1, int z = 0)
+    {
+        int id = first_free;
+        if (id >= 0)
+        {
+            first_free = objects[id].next_sibling;
+        }
+        else
+        {
+            id = int(objects.size());
+            objects.push_back(SceneObject());
+        }
+
+        SceneObject &object = objects[id];
+        object.texture = tex;
+        object.has_clip = clip != nullptr;
+        object.clip = clip != nullptr ? *clip : SDL_Rect();
+        object.local_x = x;
+        object.local_y = y;
+        object.pivot_x = 0.0f;
+        object.pivot_y = 0.0f;
+        object.width = clip != nullptr ? clip->w : tex.width;
+        object.height = clip != nullptr ? clip->h : tex.height;
+        object.z = z;
+        object.visible = true;
+        object.used = true;
+        object.parent = parent;
+        object.first_child = -1;
+        object.next_sibling = -1;
+        object.cell = -1;
+        object.slot = -1;
+
+        if (parent >= 0)
+        {
+            object.next_sibling = objects[parent].first_child;
+            objects[parent].first_child = id;
+        }
+
+        max_width = std::max(max_width, object.width);
+        max_height = std::max(max_height, object.height);
+        updateWorld(id);
+        ++live;
+        return id;
+    }
+
+    // Remove an object and everything attached to it
+    void remove(int id)
+    {
+        const int parent = objects[id].parent;
+        if (parent >= 0)
+        {
+            // Unlink from the parent's list of children
+            int *link = &objects[parent].first_child;
+            while (*link != id)
+            {
+                link = &objects[*link].next_sibling;
+            }
+            *link = objects[id].next_sibling;
+        }
+        removeTree(id);
+    }
+
+    // Move an object, and everything attached to it
+    // @param x The x coordinate, relative to the parent if it has one
+    // @param y The y coordinate, relative to the parent if it has one
+    void setPosition(int id, float x, float y)
+    {
+        objects[id].local_x = x;
+        objects[id].local_y = y;
+        updateWorld(id);
+    }
+
+    // Set which point of the sprite is at its position, eg. 0.5, 0.5 to
+    // position it by its center
+    void setPivot(int id, float x, float y)
+    {
+        objects[id].pivot_x = x;
+        objects[id].pivot_y = y;
+        updateWorld(id);
+    }
+
+    // Show a different part of the texture
+    void setClip(int id, const SDL_Rect &clip)
+    {
+        SceneObject &object = objects[id];
+        object.has_clip = true;
+        object.clip = clip;
+        if (object.width != clip.w || object.height != clip.h)
+        {
+            object.width = clip.w;
+            object.height = clip.h;
+            max_width = std::max(max_width, clip.w);
+            max_height = std::max(max_height, clip.h);
+            updateWorld(id);
+        }
+    }
+
+    void setVisible(int id, bool visible)
+    {
+        objects[id].visible = visible;
+    }
+
+    const SceneObject& object(int id) const
+    {
+        return objects[id];
+    }
+
+    // Find the visible objects overlapping an area of the world
+    // @param area The area to look in, in world coordinates
+    // @param found Filled with the ids of the objects, in no set order
+    // @return how many objects the grid had to look at to find them
+    long query(const SDL_Rect &area, std::vector<int> &found) const
+    {
+        found.clear();
+
+        // Objects are filed under their top left corner, so one that
+        // starts left of or above the area can still reach into it
+        const int first_column = clampColumn((area.x - max_width) / cell_size);
+        const int last_column = clampColumn((area.x + area.w) / cell_size);
+        const int first_row = clampRow((area.y - max_height) / cell_size);
+        const int last_row = clampRow((area.y + area.h) / cell_size);
+
+        long checked = 0;
+        const float right = float(area.x + area.w);
+        const float bottom = float(area.y + area.h);
+        for (int row = first_row; row <= last_row; ++row)
+        {
+            for (int column = first_column; column <= last_column; ++column)
+            {
+                const std::vector<int> &cell = cells[row * columns + column];
+                checked += long(cell.size());
+                for (size_t i = 0; i < cell.size(); ++i)
+                {
+                    const SceneObject &object = objects[cell[i]];
+                    if (object.visible &&
+                        object.world_x < right && object.world_x + object.width > area.x &&
+                        object.world_y < bottom && object.world_y + object.height > area.y)
+                    {
+                        found.push_back(cell[i]);
+                    }
+                }
+            }
+        }
+        return checked;
+    }
+
+    // Draw what the camera sees, lowest z first, calling
+    //   draw(const Texture &tex, const SDL_Rect *clip, const SDL_Rect &dst)
+    // for every object, with dst in screen coordinates, eg. with
+    // renderTexture(tex, ren, dst.x, dst.y, dst.w, dst.h)
+    // @return how many objects were drawn
+    template<typename DrawFunc>
+    int draw(const Camera &camera, DrawFunc draw)
+    {
+        {
+            PROFILE_ZONE("cull");
+            SDL_Rect view = { int(std::floor(camera.x)), int(std::floor(camera.y)),
+                camera.width + 1, camera.height + 1 };
+            query(view, visible_ids);
+
+            // Ids break ties so equal z objects keep a stable order
+            std::sort(visible_ids.begin(), visible_ids.end(), [this](int a, int b)
+            {
+                return objects[a].z != objects[b].z ? objects[a].z < objects[b].z : a < b;
+            });
+        }
+
+        for (size_t i = 0; i < visible_ids.size(); ++i)
+        {
+            const SceneObject &object = objects[visible_ids[i]];
+            SDL_Rect dst = { int(std::floor(object.world_x - camera.x)),
+                int(std::floor(object.world_y - camera.y)), object.width, object.height };
+            draw(object.texture, object.has_clip ? &object.clip : nullptr, dst);
+        }
+        return int(visible_ids.size());
+    }
+
+    // @return how many objects are in the scene
+    int size() const
+    {
+        return live;
+    }
+
+private:
+    int clampColumn(int column) const
+    {
+        return std::min(std::max(column, 0), columns - 1);
+    }
+
+    int clampRow(int row) const
+    {
+        return std::min(std::max(row, 0), rows - 1);
+    }
+
+    // Recompute the world position of an object and its children, and
+    // move them to the right grid cells
+    void updateWorld(int id)
+    {
+        SceneObject &object = objects[id];
+        float origin_x = 0.0f;
+        float origin_y = 0.0f;
+        if (object.parent >= 0)
+        {
+            // Children hang off the parent's position, not its corner
+            const SceneObject &parent = objects[object.parent];
+            origin_x = parent.world_x + parent.pivot_x * parent.width;
+            origin_y = parent.world_y + parent.pivot_y * parent.height;
+        }
+        object.world_x = origin_x + object.local_x - object.pivot_x * object.width;
+        object.world_y = origin_y + object.local_y - object.pivot_y * object.height;
+
+        const int column = clampColumn(int(std::floor(object.world_x / cell_size)));
+        const int row = clampRow(int(std::floor(object.world_y / cell_size)));
+        const int cell = row * columns + column;
+        if (cell != object.cell)
+        {
+            unfile(id);
+            object.cell = cell;
+            object.slot = int(cells[cell].size());
+            cells[cell].push_back(id);
+        }
+
+        for (int child = object.first_child; child >= 0; child = objects[child].next_sibling)
+        {
+            updateWorld(child);
+        }
+    }
+
+    // Take an object out of its grid cell
+    void unfile(int id)
+    {
+        SceneObject &object = objects[id];
+        if (object.cell < 0)
+        {
+            return;
+        }
+        std::vector<int> &cell = cells[object.cell];
+        const int last = cell.back();
+        cell[object.slot] = last;
+        objects[last].slot = object.slot;
+        cell.pop_back();
+        object.cell = -1;
+        object.slot = -1;
+    }
+
+    void removeTree(int id)
+    {
+        int child = objects[id].first_child;
+        while (child >= 0)
+        {
+            const int next = objects[child].next_sibling;
+            removeTree(child);
+            child = next;
+        }
+
+        unfile(id);
+        objects[id].used = false;
+        objects[id].visible = false;
+        objects[id].next_sibling = first_free;
+        first_free = id;
+        --live;
+    }
+
+    int cell_size;
+    int columns;
+    int rows;
+    int max_width;
+    int max_height;
+    int first_free;
+    int live;
+    std::vector<SceneObject> objects;
+    std::vector<std::vector<int> > cells;
+    std::vector<int> visible_ids;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <SDL2/SDL.h>
+
+// One queued sprite draw
+struct SpriteBatchEntry
+{
+    SDL_Texture *texture;
+    SDL_Rect clip;
+    SDL_Rect dst;
+    SDL_Color color;
+
+    // Order the sprite was queued in, used to keep draws of the same
+    // texture in painter's order after sorting
+    int order;
+};
+
+// Collects sprite draws for a frame and submits them with one
+// SDL_RenderGeometry call per texture instead of one SDL_RenderCopy per
+// sprite. Draws are grouped by texture when the batch is flushed, so
+// sprites using different textures are not guaranteed to overlap in the
+// order they were queued. Sprites sharing a texture keep their order.
+// Requires SDL 2.0.18 or newer.
+class SpriteBatch
+{
+public:
+    // @param ren The renderer to submit to
+    // @param reserveSprites How many sprites to preallocate room for
+    explicit SpriteBatch(SDL_Renderer *ren, int reserveSprites = 1024)
+        : renderer(ren)
+    {
+        entries.reserve(reserveSprites);
+        vertices.reserve(reserveSprites * 4);
+        indices.reserve(reserveSprites * 6);
+    }
+
+    // Queue a sprite to be drawn on the next flush
+    // @param tex The texture to draw from
+    // @param clip The sub-section of the texture to draw, nullptr for all of it
+    // @param dst Where on the screen to draw it
+    // @param color Color and alpha to modulate the sprite with
+    void draw(SDL_Texture *tex, const SDL_Rect *clip, const SDL_Rect &dst,
+        SDL_Color color)
+    {
+        SpriteBatchEntry entry;
+        entry.texture = tex;
+        if (clip != nullptr)
+        {
+            entry.clip = *clip;
+        }
+        else
+        {
+            // Marks the whole texture, resolved when the group is built
+            entry.clip.x = 0;
+            entry.clip.y = 0;
+            entry.clip.w = -1;
+            entry.clip.h = -1;
+        }
+        entry.dst = dst;
+        entry.color = color;
+        entry.order = int(entries.size());
+        entries.push_back(entry);
+    }
+
+    // Queue a sprite drawn without any color modulation
+    void draw(SDL_Texture *tex, const SDL_Rect *clip, const SDL_Rect &dst)
+    {
+        SDL_Color white = {255, 255, 255, 255};
+        draw(tex, clip, dst, white);
+    }
+
+    // Queue a sprite at x, y using the clip's width and height
+    void draw(SDL_Texture *tex, const SDL_Rect &clip, int x, int y)
+    {
+        SDL_Rect dst;
+        dst.x = x;
+        dst.y = y;
+        dst.w = clip.w;
+        dst.h = clip.h;
+        draw(tex, &clip, dst);
+    }
+
+    // Sort the queued sprites by texture and submit each group
+    // @return how many SDL_RenderGeometry calls were made
+    int flush()
+    {
+        std::sort(entries.begin(), entries.end(), compareEntries);
+
+        int calls = 0;
+        size_t start = 0;
+        while (start < entries.size())
+        {
+            size_t end = start;
+            SDL_Texture *tex = entries[start].texture;
+            while (end < entries.size() && entries[end].texture == tex)
+            {
+                ++end;
+            }
+
+            submitGroup(start, end);
+            ++calls;
+            start = end;
+        }
+
+        entries.clear();
+        return calls;
+    }
+
+    // Throw away queued sprites without drawing them
+    void clear()
+    {
+        entries.clear();
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+    static bool compareEntries(const SpriteBatchEntry &a, const SpriteBatchEntry &b)
+    {
+        if (a.texture != b.texture)
+        {
+            return a.texture < b.texture;
+        }
+        return a.order < b.order;
+    }
+
+    // Build the quads for entries [start, end), which all share one
+    // texture, and draw them in a single call
+    void submitGroup(size_t start, size_t end)
+    {
+        SDL_Texture *tex = entries[start].texture;
+        int tex_w, tex_h;
+        if (SDL_QueryTexture(tex, NULL, NULL, &tex_w, &tex_h) != 0)
+        {
+            return;
+        }
+        const float inv_w = 1.0f / tex_w;
+        const float inv_h = 1.0f / tex_h;
+
+        vertices.clear();
+        indices.clear();
+        for (size_t i = start; i < end; ++i)
+        {
+            const SpriteBatchEntry &entry = entries[i];
+            SDL_Rect clip = entry.clip;
+            if (clip.w < 0)
+            {
+                clip.w = tex_w;
+                clip.h = tex_h;
+            }
+
+            const float x0 = float(entry.dst.x);
+            const float y0 = float(entry.dst.y);
+            const float x1 = float(entry.dst.x + entry.dst.w);
+            const float y1 = float(entry.dst.y + entry.dst.h);
+            const float u0 = clip.x * inv_w;
+            const float v0 = clip.y * inv_h;
+            const float u1 = (clip.x + clip.w) * inv_w;
+            const float v1 = (clip.y + clip.h) * inv_h;
+
+            const int base = int(vertices.size());
+            vertices.push_back(makeVertex(x0, y0, u0, v0, entry.color));
+            vertices.push_back(makeVertex(x1, y0, u1, v0, entry.color));
+            vertices.push_back(makeVertex(x1, y1, u1, v1, entry.color));
+            vertices.push_back(makeVertex(x0, y1, u0, v1, entry.color));
+
+            indices.push_back(base);
+            indices.push_back(base + 1);
+            indices.push_back(base + 2);
+            indices.push_back(base);
+            indices.push_back(base + 2);
+            indices.push_back(base + 3);
+        }
+
+        if (SDL_RenderGeometry(renderer, tex, &vertices[0], int(vertices.size()),
+            &indices[0], int(indices.size())) != 0)
+        {
+            std::cout << "SDL_RenderGeometry" << SDL_GetError() << std::endl;
+        }
+    }
+
+    static SDL_Vertex makeVertex(float x, float y, float u, float v, SDL_Color color)
+    {
+        SDL_Vertex vertex;
+        vertex.position.x = x;
+        vertex.position.y = y;
+        vertex.color = color;
+        vertex.tex_coord.x = u;
+        vertex.tex_coord.y = v;
+        return vertex;
+    }
+
+    SDL_Renderer *renderer;
+    std::vector<SpriteBatchEntry> entries;
+
+    // Scratch buffers reused between flushes so a steady frame does
+    // not allocate
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+#endif
@@ -0,0 +1,401 @@
+#ifndef STREAMING_TEXTURE_H
+#define STREAMING_TEXTURE_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "texture.h"
+
+// Pixel format streamed images are converted to and uploaded in
+const Uint32 STREAMING_PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+// Progress of a single image going through the TextureStreamer
+struct StreamingImageState
+{
+    std::string path;
+
+    // Filled in by a worker thread before sized is set, after which
+    // the worker only writes rows at or past rows_ready
+    int width;
+    int height;
+    int pitch;
+    std::vector<Uint8> pixels;
+    std::atomic<bool> sized;
+    std::atomic<int> rows_ready;
+    std::atomic<bool> decode_failed;
+
+    // Only ever touched on the render thread
+    SDL_Texture *texture;
+    int rows_uploaded;
+    bool done;
+    bool failed;
+};
+
+// Handle to an image that has been queued with TextureStreamer::load.
+// Only use it from the thread that owns the renderer.
+class StreamingTextureHandle
+{
+public:
+    StreamingTextureHandle()
+    {
+    }
+
+    explicit StreamingTextureHandle(const std::shared_ptr<StreamingImageState> &state)
+        : state(state)
+    {
+    }
+
+    // @return true once every row has been uploaded (or loading failed)
+    bool ready() const
+    {
+        return state && state->done;
+    }
+
+    // @return true if the image could not be decoded or uploaded
+    bool failed() const
+    {
+        return state && state->failed;
+    }
+
+    // The texture as far as it has been uploaded. Only the rows in
+    // loadedRect() hold the image so far, draw those with the clip-aware
+    // renderTexture to fade a large background in from the top. The
+    // streamer still owns the texture.
+    // @return the texture, texture member is nullptr until the image size
+    //         is known
+    Texture texture() const
+    {
+        Texture wrapped = makeTexture(nullptr);
+        if (state && state->texture != nullptr)
+        {
+            wrapped.texture = state->texture;
+            wrapped.width = state->width;
+            wrapped.height = state->height;
+            wrapped.format = STREAMING_PIXEL_FORMAT;
+            wrapped.access = SDL_TEXTUREACCESS_STREAMING;
+        }
+        return wrapped;
+    }
+
+    // @return the part of the texture that has been uploaded so far
+    SDL_Rect loadedRect() const
+    {
+        SDL_Rect rect = { 0, 0, 0, 0 };
+        if (state && state->texture != nullptr)
+        {
+            rect.w = state->width;
+            rect.h = state->rows_uploaded;
+        }
+        return rect;
+    }
+
+    // Take ownership of the texture once it is fully loaded. The caller
+    // is responsible for freeing it with cleanup() like any other
+    // texture, and later calls return nullptr
+    // @return the texture, or nullptr if not ready, failed or already taken
+    SDL_Texture* take()
+    {
+        if (!ready())
+        {
+            return nullptr;
+        }
+        SDL_Texture *texture = state->texture;
+        state->texture = nullptr;
+        return texture;
+    }
+
+    // @return the file this handle is loading, empty for a default
+    // constructed handle
+    const std::string& path() const
+    {
+        static const std::string no_path;
+        return state ? state->path : no_path;
+    }
+
+private:
+    std::shared_ptr<StreamingImageState> state;
+};
+
+// Loads large images into SDL_TEXTUREACCESS_STREAMING textures a band of
+// rows at a time so no single frame pays for a whole image. A worker
+// thread decodes each image with IMG_Load and converts it to the
+// texture's pixel format one band at a time, publishing rows as they are
+// done. The render thread calls update once per frame, which uploads
+// finished rows with SDL_UpdateTexture until the frame's byte budget is
+// spent, so frame time stays flat while images load in.
+//
+// SDL_image has no incremental decode, so the decode itself happens in
+// one go on the worker; the conversion and the uploads are what get
+// split into bands.
+class TextureStreamer
+{
+public:
+    // @param ren The renderer textures will be created on
+    // @param bytesPerFrame Most pixel bytes to upload per update call
+    // @param bandRows How many rows the worker converts at a time
+    // @param numThreads How many decode threads to start
+    explicit TextureStreamer(SDL_Renderer *ren, int bytesPerFrame = 1024 * 1024,
+        int bandRows = 32, int numThreads = 1)
+        : renderer(ren), bytes_per_frame(bytesPerFrame),
+          band_rows(std::max(bandRows, 1)), stopping(false)
+    {
+        for (int i = 0; i < std::max(numThreads, 1); ++i)
+        {
+            workers.push_back(std::thread(&TextureStreamer::workerLoop, this));
+        }
+    }
+
+    // Stops the workers and destroys any textures nobody has taken
+    ~TextureStreamer()
+    {
+        stopping = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        work_ready.notify_all();
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+
+        for (size_t i = 0; i < streams.size(); ++i)
+        {
+            if (streams[i]->texture != nullptr)
+            {
+                SDL_DestroyTexture(streams[i]->texture);
+            }
+        }
+    }
+
+    // Queue an image to be streamed in
+    // @param file The image file to load
+    // @return a handle that fills in over later update calls
+    StreamingTextureHandle load(const std::string &file)
+    {
+        std::shared_ptr<StreamingImageState> state(new StreamingImageState());
+        state->path = file;
+        state->width = 0;
+        state->height = 0;
+        state->pitch = 0;
+        state->sized = false;
+        state->rows_ready = 0;
+        state->decode_failed = false;
+        state->texture = nullptr;
+        state->rows_uploaded = 0;
+        state->done = false;
+        state->failed = false;
+
+        streams.push_back(state);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(state);
+        }
+        work_ready.notify_one();
+        return StreamingTextureHandle(state);
+    }
+
+    // Upload rows the workers have finished, oldest request first, until
+    // the byte budget for this frame is used up. At least one row goes
+    // up per call even if it is over budget, so loading always moves on.
+    // Must be called on the thread that owns the renderer.
+    // @return how many bytes were uploaded
+    int update()
+    {
+        int budget = bytes_per_frame;
+        int uploaded = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < streams.size(); ++i)
+        {
+            StreamingImageState &state = *streams[i];
+            if (!state.done && budget > 0)
+            {
+                int bytes = uploadRows(state, budget, uploaded == 0);
+                budget -= bytes;
+                uploaded += bytes;
+            }
+
+            // Drop finished streams once nobody but us can take the texture
+            if (!state.done || (state.texture != nullptr && streams[i].use_count() > 1))
+            {
+                streams[kept++] = streams[i];
+            }
+            else if (state.texture != nullptr)
+            {
+                SDL_DestroyTexture(state.texture);
+                state.texture = nullptr;
+            }
+        }
+        streams.resize(kept);
+        return uploaded;
+    }
+
+    // @param bytesPerFrame Most pixel bytes to upload per update call
+    void setBudget(int bytesPerFrame)
+    {
+        bytes_per_frame = bytesPerFrame;
+    }
+
+    // @return how many images have not been fully uploaded yet
+    int getInFlight() const
+    {
+        int count = 0;
+        for (size_t i = 0; i < streams.size(); ++i)
+        {
+            if (!streams[i]->done)
+            {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+private:
+    // Upload as many ready rows of one image as fit in the budget
+    // @param atLeastOne Upload a row even if it does not fit
+    // @return how many bytes were uploaded
+    int uploadRows(StreamingImageState &state, int budget, bool atLeastOne)
+    {
+        if (state.decode_failed.load())
+        {
+            std::cout << "IMG_Load " << state.path << std::endl;
+            state.failed = true;
+            state.done = true;
+            return 0;
+        }
+        if (!state.sized.load(std::memory_order_acquire))
+        {
+            return 0;
+        }
+
+        if (state.texture == nullptr)
+        {
+            state.texture = SDL_CreateTexture(renderer, STREAMING_PIXEL_FORMAT,
+                SDL_TEXTUREACCESS_STREAMING, state.width, state.height);
+            if (state.texture == nullptr)
+            {
+                std::cout << "SDL_CreateTexture" << SDL_GetError() << std::endl;
+                state.failed = true;
+                state.done = true;
+                return 0;
+            }
+            SDL_SetTextureBlendMode(state.texture, SDL_BLENDMODE_BLEND);
+        }
+
+        const int ready = state.rows_ready.load(std::memory_order_acquire);
+        int max_rows = budget / state.pitch;
+        if (max_rows == 0 && atLeastOne)
+        {
+            max_rows = 1;
+        }
+        const int rows = std::min(ready - state.rows_uploaded, max_rows);
+        if (rows <= 0)
+        {
+            return 0;
+        }
+
+        SDL_Rect band = { 0, state.rows_uploaded, state.width, rows };
+        if (SDL_UpdateTexture(state.texture, &band,
+            &state.pixels[size_t(state.rows_uploaded) * state.pitch], state.pitch) != 0)
+        {
+            std::cout << "SDL_UpdateTexture" << SDL_GetError() << std::endl;
+            state.failed = true;
+            state.done = true;
+            return 0;
+        }
+        state.rows_uploaded += rows;
+
+        if (state.rows_uploaded == state.height)
+        {
+            // The texture has its own copy now
+            std::vector<Uint8>().swap(state.pixels);
+            state.done = true;
+        }
+        return rows * state.pitch;
+    }
+
+    void workerLoop()
+    {
+        while (true)
+        {
+            std::shared_ptr<StreamingImageState> state;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_ready.wait(lock, [this] { return stopping || !pending.empty(); });
+                if (stopping)
+                {
+                    return;
+                }
+                state = pending.front();
+                pending.pop_front();
+            }
+            decode(*state);
+        }
+    }
+
+    void decode(StreamingImageState &state)
+    {
+        SDL_Surface *surface = IMG_Load(state.path.c_str());
+        if (surface != nullptr && SDL_ISPIXELFORMAT_INDEXED(surface->format->format))
+        {
+            // SDL_ConvertPixels does not take palettes, so expand those
+            // in one go instead
+            SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, STREAMING_PIXEL_FORMAT, 0);
+            SDL_FreeSurface(surface);
+            surface = converted;
+        }
+        if (surface == nullptr)
+        {
+            state.decode_failed = true;
+            return;
+        }
+
+        state.width = surface->w;
+        state.height = surface->h;
+        state.pitch = surface->w * SDL_BYTESPERPIXEL(STREAMING_PIXEL_FORMAT);
+        state.pixels.resize(size_t(state.pitch) * state.height);
+        state.sized.store(true, std::memory_order_release);
+
+        SDL_LockSurface(surface);
+        for (int y = 0; y < state.height && !stopping; y += band_rows)
+        {
+            const int rows = std::min(band_rows, state.height - y);
+            const Uint8 *src = (const Uint8*)surface->pixels + size_t(y) * surface->pitch;
+            if (SDL_ConvertPixels(state.width, rows, surface->format->format, src,
+                surface->pitch, STREAMING_PIXEL_FORMAT,
+                &state.pixels[size_t(y) * state.pitch], state.pitch) != 0)
+            {
+                state.decode_failed = true;
+                break;
+            }
+            state.rows_ready.store(y + rows, std::memory_order_release);
+        }
+        SDL_UnlockSurface(surface);
+        SDL_FreeSurface(surface);
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    SDL_Renderer *renderer;
+    int bytes_per_frame;
+    int band_rows;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::deque<std::shared_ptr<StreamingImageState> > pending;
+    std::atomic<bool> stopping;
+
+    // Render thread only, in the order they were requested
+    std::vector<std::shared_ptr<StreamingImageState> > streams;
+};
+
+#endif
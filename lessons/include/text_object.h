@@ -0,0 +1,439 @@
+#ifndef TEXT_OBJECT_H
+#define TEXT_OBJECT_H
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "glyph_atlas.h"
+#include "pixel_convert.h"
+
+// Where one character of a laid out string goes
+struct LayoutGlyph
+{
+    unsigned char ch;
+
+    // Left edge of the glyph's pixels, and their width. Whitespace has
+    // a width of 0.
+    int x;
+    int w;
+};
+
+// A string measured and positioned with one font, size and color
+struct TextLayout
+{
+    const GlyphAtlas *atlas;
+    Uint32 color;
+    std::string text;
+    std::vector<LayoutGlyph> glyphs;
+    int width;
+    int height;
+};
+
+// Pack a color into one number for comparing and hashing
+inline Uint32 packColor(const SDL_Color &color)
+{
+    return (Uint32(color.r) << 24) | (Uint32(color.g) << 16) | (Uint32(color.b) << 8) | color.a;
+}
+
+// Position every character of a string, including kerning
+// @param atlas The atlas of the font and size to use
+// @param text The string to lay out
+// @param layout Filled in with the result, reusing its storage
+inline void layoutText(GlyphAtlas &atlas, const std::string &text, TextLayout &layout)
+{
+    layout.atlas = &atlas;
+    layout.text.assign(text);
+    layout.glyphs.clear();
+    layout.height = atlas.getLineHeight();
+
+    int pen_x = 0;
+    unsigned char prev = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        unsigned char ch = static_cast<unsigned char>(text[i]);
+        const Glyph *glyph = atlas.getGlyph(ch);
+        if (glyph == nullptr)
+        {
+            continue;
+        }
+        if (prev != 0)
+        {
+            pen_x += atlas.getKerning(prev, ch);
+        }
+
+        LayoutGlyph placed;
+        placed.ch = ch;
+        placed.x = pen_x + glyph->offset_x;
+        placed.w = glyph->clip.w;
+        layout.glyphs.push_back(placed);
+
+        pen_x += glyph->advance;
+        prev = ch;
+    }
+    layout.width = pen_x;
+}
+
+// Remembers the layouts of recently used strings, keyed by font, size,
+// string and color. Slots are picked by hash and a new layout simply
+// overwrites whatever was in its slot, reusing that slot's storage, so
+// once the cache is warm looking up or adding a layout does not allocate.
+class TextLayoutCache
+{
+public:
+    // @param slots How many layouts to keep
+    explicit TextLayoutCache(int slots = 256)
+        : entries(std::max(slots, 1)), used(std::max(slots, 1), false), hits(0), misses(0)
+    {
+    }
+
+    // Get the layout of a string, laying it out if it is not cached.
+    // The layout stays valid until a later lookup lands in its slot.
+    const TextLayout& get(GlyphAtlas &atlas, SDL_Color color, const std::string &text)
+    {
+        const Uint32 packed = packColor(color);
+        size_t hash = std::hash<std::string>()(text);
+        hash ^= std::hash<const void*>()(&atlas) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        hash ^= packed + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+
+        const size_t slot = hash % entries.size();
+        TextLayout &layout = entries[slot];
+        if (used[slot] && layout.atlas == &atlas && layout.color == packed && layout.text == text)
+        {
+            ++hits;
+            return layout;
+        }
+
+        ++misses;
+        layoutText(atlas, text, layout);
+        layout.color = packed;
+        used[slot] = true;
+        return layout;
+    }
+
+    long getHits() const { return hits; }
+    long getMisses() const { return misses; }
+
+private:
+    std::vector<TextLayout> entries;
+    std::vector<bool> used;
+    long hits;
+    long misses;
+};
+
+// A piece of text that changes over time, eg. a score counter. It keeps
+// its own texture and only redraws the characters that changed when the
+// string is updated: characters that are the same and in the same place
+// as last time are left alone, the rest are cleared and redrawn from the
+// glyph atlas under a clip rectangle. The texture is only recreated when
+// the text outgrows it, and is freed with the object, so nothing leaks
+// however often the text changes.
+//
+// The texture holds premultiplied alpha, since that is what drawing
+// glyphs over transparent pixels produces. On renderers without custom
+// blend modes it is drawn with normal blending, which darkens the
+// antialiased edges slightly.
+class TextObject
+{
+public:
+    // @param engine The text engine to get the font's glyph atlas from
+    // @param fontFile The font to draw with
+    // @param fontSize The point size of the font
+    // @param color The color of the text
+    // @param cache Layout cache to share between text objects, may be nullptr
+    TextObject(TextEngine &engine, const std::string &fontFile, int fontSize,
+        SDL_Color color, TextLayoutCache *cache = nullptr)
+        : renderer(engine.getRenderer()), atlas(engine.getAtlas(fontFile, fontSize)),
+          cache(cache), color(color), texture(nullptr), capacity(0), texture_height(0),
+          dirty(false), full_redraw(true), glyphs_drawn(0), texture_creates(0)
+    {
+        shown.atlas = nullptr;
+        shown.width = 0;
+        shown.height = 0;
+        pending = shown;
+        use_target = SDL_RenderTargetSupported(renderer) == SDL_TRUE;
+    }
+
+    ~TextObject()
+    {
+        if (texture != nullptr)
+        {
+            SDL_DestroyTexture(texture);
+        }
+    }
+
+    // Change the string. Nothing is drawn until the next draw call.
+    void setText(const std::string &text)
+    {
+        const TextLayout &current = dirty ? pending : shown;
+        if (atlas == nullptr || (current.atlas != nullptr && current.text == text))
+        {
+            return;
+        }
+        if (cache != nullptr)
+        {
+            const TextLayout &layout = cache->get(*atlas, color, text);
+            pending.atlas = layout.atlas;
+            pending.color = layout.color;
+            pending.text.assign(layout.text);
+            pending.glyphs.assign(layout.glyphs.begin(), layout.glyphs.end());
+            pending.width = layout.width;
+            pending.height = layout.height;
+        }
+        else
+        {
+            layoutText(*atlas, text, pending);
+            pending.color = packColor(color);
+        }
+        dirty = true;
+    }
+
+    // Change the color, which redraws the whole string
+    void setColor(SDL_Color value)
+    {
+        if (packColor(value) == packColor(color))
+        {
+            return;
+        }
+        color = value;
+        if (!dirty)
+        {
+            pending = shown;
+            dirty = true;
+        }
+        pending.color = packColor(value);
+        full_redraw = true;
+    }
+
+    // Draw the text with its top left corner at x, y, bringing the
+    // texture up to date first if the text changed
+    // @return false if the font could not be opened
+    bool draw(int x, int y)
+    {
+        if (atlas == nullptr)
+        {
+            return false;
+        }
+        if (!use_target)
+        {
+            // No render targets, so draw straight from the atlas
+            const std::string &text = dirty ? pending.text : shown.text;
+            atlas->drawText(text, color, x, y);
+            return true;
+        }
+        if (dirty)
+        {
+            update();
+        }
+        if (texture != nullptr && shown.width > 0)
+        {
+            SDL_Rect src = { 0, 0, shown.width, shown.height };
+            SDL_Rect dst = { x, y, shown.width, shown.height };
+            SDL_RenderCopy(renderer, texture, &src, &dst);
+        }
+        return true;
+    }
+
+    // @return the size the text is drawn at
+    int getWidth() const { return (dirty ? pending : shown).width; }
+    int getHeight() const { return (dirty ? pending : shown).height; }
+
+    // @return how many glyphs the last update had to draw
+    int getGlyphsDrawn() const { return glyphs_drawn; }
+
+    // @return how many times the texture has been (re)created
+    int getTextureCreates() const { return texture_creates; }
+
+private:
+    // Redraw the parts of the texture that changed and swap the pending
+    // layout in
+    void update()
+    {
+        glyphs_drawn = 0;
+        if (!ensureCapacity(pending.width, pending.height))
+        {
+            return;
+        }
+
+        SDL_Texture *previous_target = SDL_GetRenderTarget(renderer);
+        SDL_BlendMode previous_blend;
+        SDL_GetRenderDrawBlendMode(renderer, &previous_blend);
+        Uint8 r, g, b, a;
+        SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+        SDL_Rect previous_clip;
+        SDL_RenderGetClipRect(renderer, &previous_clip);
+        const bool clipped = SDL_RenderIsClipEnabled(renderer) == SDL_TRUE;
+
+        SDL_SetRenderTarget(renderer, texture);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+
+        if (full_redraw)
+        {
+            SDL_Rect all = { 0, 0, capacity, texture_height };
+            redrawRun(all);
+        }
+        else
+        {
+            findChangedRuns();
+            for (size_t i = 0; i < runs.size(); ++i)
+            {
+                redrawRun(runs[i]);
+            }
+        }
+
+        SDL_RenderSetClipRect(renderer, nullptr);
+        SDL_SetRenderTarget(renderer, previous_target);
+        SDL_RenderSetClipRect(renderer, clipped ? &previous_clip : nullptr);
+        SDL_SetRenderDrawBlendMode(renderer, previous_blend);
+        SDL_SetRenderDrawColor(renderer, r, g, b, a);
+
+        std::swap(shown, pending);
+        dirty = false;
+        full_redraw = false;
+    }
+
+    // Make sure the texture is at least this big, growing it in powers
+    // of two so a counter that gains a digit does not recreate it often
+    bool ensureCapacity(int width, int height)
+    {
+        if (texture != nullptr && width <= capacity && height <= texture_height)
+        {
+            return true;
+        }
+
+        int new_capacity = std::max(capacity, 64);
+        while (new_capacity < width)
+        {
+            new_capacity *= 2;
+        }
+        SDL_Texture *created = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_TARGET, new_capacity, std::max(height, 1));
+        if (created == nullptr)
+        {
+            std::cout << "TextObject CreateTexture" << SDL_GetError() << std::endl;
+            return false;
+        }
+        if (SDL_SetTextureBlendMode(created, premultipliedBlendMode()) != 0)
+        {
+            SDL_SetTextureBlendMode(created, SDL_BLENDMODE_BLEND);
+        }
+
+        if (texture != nullptr)
+        {
+            SDL_DestroyTexture(texture);
+        }
+        texture = created;
+        capacity = new_capacity;
+        texture_height = std::max(height, 1);
+        full_redraw = true;
+        ++texture_creates;
+        return true;
+    }
+
+    // Work out which horizontal spans differ between what the texture
+    // shows and the pending layout
+    void findChangedRuns()
+    {
+        runs.clear();
+        const size_t count = std::max(shown.glyphs.size(), pending.glyphs.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            const bool has_old = i < shown.glyphs.size();
+            const bool has_new = i < pending.glyphs.size();
+            if (has_old && has_new && shown.glyphs[i].ch == pending.glyphs[i].ch &&
+                shown.glyphs[i].x == pending.glyphs[i].x)
+            {
+                continue;
+            }
+
+            int left = capacity;
+            int right = 0;
+            if (has_old)
+            {
+                left = std::min(left, shown.glyphs[i].x);
+                right = std::max(right, shown.glyphs[i].x + shown.glyphs[i].w);
+            }
+            if (has_new)
+            {
+                left = std::min(left, pending.glyphs[i].x);
+                right = std::max(right, pending.glyphs[i].x + pending.glyphs[i].w);
+            }
+            if (right <= left)
+            {
+                continue;
+            }
+            addRun(left, right);
+        }
+    }
+
+    // Add a span to the runs, joining it with the last one if they touch
+    void addRun(int left, int right)
+    {
+        left = std::max(left, 0);
+        right = std::min(right, capacity);
+        if (!runs.empty() && left <= runs.back().x + runs.back().w)
+        {
+            SDL_Rect &last = runs.back();
+            const int end = std::max(last.x + last.w, right);
+            last.x = std::min(last.x, left);
+            last.w = end - last.x;
+            return;
+        }
+        SDL_Rect run = { left, 0, right - left, pending.height };
+        runs.push_back(run);
+    }
+
+    // Clear a span of the texture and draw the pending glyphs over it,
+    // including neighbours that only overlap it slightly
+    void redrawRun(const SDL_Rect &run)
+    {
+        SDL_RenderSetClipRect(renderer, &run);
+        SDL_RenderFillRect(renderer, &run);
+
+        SDL_Texture *glyphs = atlas->getTexture();
+        SDL_SetTextureColorMod(glyphs, color.r, color.g, color.b);
+        SDL_SetTextureAlphaMod(glyphs, color.a);
+        for (size_t i = 0; i < pending.glyphs.size(); ++i)
+        {
+            const LayoutGlyph &placed = pending.glyphs[i];
+            if (placed.w == 0 || placed.x >= run.x + run.w || placed.x + placed.w <= run.x)
+            {
+                continue;
+            }
+            const Glyph *glyph = atlas->getGlyph(placed.ch);
+            if (glyph == nullptr)
+            {
+                continue;
+            }
+            SDL_Rect dst = { placed.x, 0, glyph->clip.w, glyph->clip.h };
+            SDL_RenderCopy(renderer, glyphs, &glyph->clip, &dst);
+            ++glyphs_drawn;
+        }
+    }
+
+    TextObject(const TextObject&) = delete;
+    TextObject& operator=(const TextObject&) = delete;
+
+    SDL_Renderer *renderer;
+    GlyphAtlas *atlas;
+    TextLayoutCache *cache;
+    SDL_Color color;
+    SDL_Texture *texture;
+    int capacity;
+    int texture_height;
+    bool use_target;
+    bool dirty;
+    bool full_redraw;
+    int glyphs_drawn;
+    int texture_creates;
+
+    // What the texture currently holds, and what it should hold next
+    TextLayout shown;
+    TextLayout pending;
+    std::vector<SDL_Rect> runs;
+};
+
+#endif
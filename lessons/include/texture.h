@@ -0,0 +1,29 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <SDL2/SDL.h>
+
+// An SDL_Texture along with the details we would otherwise need to ask
+// SDL_QueryTexture for every time it is drawn. The details are read once
+// when the texture is wrapped, so drawing never has to go back to SDL
+// for them. The wrapper does not own the texture, free it with
+// cleanup(tex.texture) as usual.
+struct Texture
+{
+    SDL_Texture *texture;
+
+    // Size of the image, from the top left of the texture. That is the
+    // whole texture, except for textures from a TexturePool, which are
+    // rounded up to a size class
+    int width;
+    int height;
+    Uint32 format;
+    int access;
+};
+
+// Wrap an SDL_Texture, querying its size, format and access mode
+// @param tex The texture to wrap, may be nullptr
+// @return the wrapped texture, all fields are zero if tex is nullptr
+Texture makeTexture(SDL_Texture *tex);
+
+#endif
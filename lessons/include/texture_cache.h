@@ -0,0 +1,285 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <iostream>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <SDL2/SDL.h>
+#include "texture.h"
+
+class TextureCache;
+
+// Estimate how many bytes of video memory a texture takes up
+// @param tex The texture to measure
+// @return width * height * bytes per pixel of the texture
+inline size_t textureBytes(const Texture &tex)
+{
+    size_t bpp = SDL_BYTESPERPIXEL(tex.format);
+    if (bpp == 0)
+    {
+        // YUV and other packed formats report 0, assume 32 bits
+        bpp = 4;
+    }
+    return size_t(tex.width) * size_t(tex.height) * bpp;
+}
+
+// One texture held by the cache
+struct TextureCacheEntry
+{
+    std::string path;
+    Texture texture;
+    size_t bytes;
+    int refs;
+};
+
+// A counted reference to a texture owned by a TextureCache. While at
+// least one handle to a texture exists the cache will not evict it.
+// Handles must not outlive the cache that created them.
+class TextureHandle
+{
+public:
+    TextureHandle()
+        : cache(nullptr), entry(nullptr)
+    {
+    }
+
+    TextureHandle(const TextureHandle &other)
+        : cache(other.cache), entry(other.entry)
+    {
+        if (entry != nullptr)
+        {
+            ++entry->refs;
+        }
+    }
+
+    TextureHandle& operator=(const TextureHandle &other)
+    {
+        if (this != &other)
+        {
+            TextureHandle copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    ~TextureHandle()
+    {
+        release();
+    }
+
+    // Drop this reference, leaving the handle empty
+    void release();
+
+    // @return the texture, or nullptr if the handle is empty
+    SDL_Texture* get() const
+    {
+        return entry != nullptr ? entry->texture.texture : nullptr;
+    }
+
+    // @return the texture along with its size, to draw with renderTexture.
+    //         All fields are zero if the handle is empty
+    const Texture& texture() const
+    {
+        static const Texture none = Texture();
+        return entry != nullptr ? entry->texture : none;
+    }
+
+    explicit operator bool() const
+    {
+        return get() != nullptr;
+    }
+
+    void swap(TextureHandle &other)
+    {
+        std::swap(cache, other.cache);
+        std::swap(entry, other.entry);
+    }
+
+private:
+    friend class TextureCache;
+
+    // Only the cache creates non-empty handles, and the reference
+    // count has already been bumped by the time it does
+    TextureHandle(TextureCache *cache, TextureCacheEntry *entry)
+        : cache(cache), entry(entry)
+    {
+    }
+
+    TextureCache *cache;
+    TextureCacheEntry *entry;
+};
+
+// Loads textures by path at most once and hands out counted handles to
+// them. Textures nobody holds a handle to stay resident until the total
+// size of the cache goes over its byte budget, at which point the least
+// recently used ones are destroyed. Textures that are still referenced
+// are never evicted, so the cache can go over budget if everything in
+// it is in use.
+class TextureCache
+{
+public:
+    // Function used to turn a path into a texture, eg. loadTexture from
+    // render_helpers.h:
+    //   TextureCache cache(renderer, loadTexture);
+    // A texture member of nullptr means the load failed
+    typedef Texture (*LoadFunc)(const std::string &file, SDL_Renderer *ren);
+
+    // @param ren The renderer textures will be loaded onto
+    // @param load The function to load textures with
+    // @param byteBudget How many bytes of textures, in use or not, may be
+    //        resident before unused ones are evicted
+    TextureCache(SDL_Renderer *ren, LoadFunc load, size_t byteBudget = 64 * 1024 * 1024)
+        : renderer(ren), loader(load), budget(byteBudget), resident_bytes(0),
+          hits(0), misses(0), evictions(0)
+    {
+    }
+
+    // All handles must have been released before the cache is destroyed
+    ~TextureCache()
+    {
+        for (auto &entry : entries)
+        {
+            if (entry.refs != 0)
+            {
+                std::cerr << "TextureCache destroyed while " << entry.path
+                          << " is still referenced" << std::endl;
+            }
+            SDL_DestroyTexture(entry.texture.texture);
+        }
+    }
+
+    // Get a texture, loading it if it is not already cached
+    // @param path Full path to the file, eg. from get_resource_path
+    // @return a handle to the texture, empty if it failed to load
+    TextureHandle acquire(const std::string &path)
+    {
+        auto found = lookup.find(path);
+        if (found != lookup.end())
+        {
+            ++hits;
+
+            // Move to the front of the list, it is now the most recently used
+            entries.splice(entries.begin(), entries, found->second);
+            TextureCacheEntry *entry = &*found->second;
+            ++entry->refs;
+            return TextureHandle(this, entry);
+        }
+
+        ++misses;
+        Texture texture = loader(path, renderer);
+        if (texture.texture == nullptr)
+        {
+            return TextureHandle();
+        }
+
+        TextureCacheEntry entry;
+        entry.path = path;
+        entry.texture = texture;
+        entry.bytes = textureBytes(texture);
+        entry.refs = 1;
+        entries.push_front(entry);
+        lookup[path] = entries.begin();
+        resident_bytes += entry.bytes;
+
+        evict();
+        return TextureHandle(this, &entries.front());
+    }
+
+    // Change the byte budget, evicting anything unused over the new budget
+    void setBudget(size_t byteBudget)
+    {
+        budget = byteBudget;
+        evict();
+    }
+
+    // Destroy every texture that no handle refers to
+    void purge()
+    {
+        size_t saved = budget;
+        budget = 0;
+        evict();
+        budget = saved;
+    }
+
+    size_t getResidentBytes() const { return resident_bytes; }
+    size_t getBudget() const { return budget; }
+    size_t getCount() const { return entries.size(); }
+    long getHits() const { return hits; }
+    long getMisses() const { return misses; }
+    long getEvictions() const { return evictions; }
+
+    // Print the hit/miss counters and memory use
+    // @param os The output stream to write to
+    void printStats(std::ostream &os) const
+    {
+        os << "TextureCache hits=" << hits
+           << " misses=" << misses
+           << " evictions=" << evictions
+           << " textures=" << entries.size()
+           << " bytes=" << resident_bytes
+           << " budget=" << budget << std::endl;
+    }
+
+private:
+    friend class TextureHandle;
+
+    void release(TextureCacheEntry *entry)
+    {
+        --entry->refs;
+        if (entry->refs == 0)
+        {
+            evict();
+        }
+    }
+
+    // Walk from the least recently used end destroying unreferenced
+    // textures until we are back under budget
+    void evict()
+    {
+        auto it = entries.end();
+        while (resident_bytes > budget && it != entries.begin())
+        {
+            --it;
+            if (it->refs != 0)
+            {
+                continue;
+            }
+
+            resident_bytes -= it->bytes;
+            SDL_DestroyTexture(it->texture.texture);
+            lookup.erase(it->path);
+            it = entries.erase(it);
+            ++evictions;
+        }
+    }
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    SDL_Renderer *renderer;
+    LoadFunc loader;
+    size_t budget;
+    size_t resident_bytes;
+    long hits;
+    long misses;
+    long evictions;
+
+    // Most recently used at the front. std::list so handles can keep
+    // pointers to entries while others are added and removed
+    std::list<TextureCacheEntry> entries;
+    std::unordered_map<std::string, std::list<TextureCacheEntry>::iterator> lookup;
+};
+
+inline void TextureHandle::release()
+{
+    if (entry != nullptr)
+    {
+        cache->release(entry);
+    }
+    cache = nullptr;
+    entry = nullptr;
+}
+
+#endif
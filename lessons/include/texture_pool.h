@@ -0,0 +1,463 @@
+#ifndef TEXTURE_POOL_H
+#define TEXTURE_POOL_H
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "cleanup.h"
+#include "handles.h"
+#include "texture.h"
+#include "pixel_convert.h"
+
+// Counters kept by a TexturePool
+struct TexturePoolStats
+{
+    // Requests served from an idle object, and ones that had to create one
+    long surface_hits;
+    long surface_misses;
+    long texture_hits;
+    long texture_misses;
+
+    // Objects handed back, and ones destroyed because the pool was over
+    // its idle budget or purged
+    long releases;
+    long destroyed;
+
+    // Bytes of pixels the pool has created and not destroyed, handed out
+    // or idle, and the most there has ever been at once
+    size_t resident_bytes;
+    size_t peak_resident_bytes;
+    size_t idle_bytes;
+};
+
+// Round a width or height up to the size class the pool allocates.
+// Classes are a quarter of a power of two apart above 16, so an object
+// is never more than 25% bigger than asked for in either direction.
+inline int poolBucketSize(int size)
+{
+    if (size <= 16)
+    {
+        return 16;
+    }
+    int octave = 16;
+    while (octave * 2 < size)
+    {
+        octave *= 2;
+    }
+    const int step = octave / 4;
+    return (size + step - 1) / step * step;
+}
+
+class TexturePool;
+
+// Deleter for handles to objects taken from a TexturePool, hands them
+// back to the pool instead of freeing them
+struct PoolDeleter
+{
+    PoolDeleter(TexturePool *pool = nullptr)
+        : pool(pool)
+    {
+    }
+
+    void operator()(SDL_Surface *surface) const;
+    void operator()(SDL_Texture *texture) const;
+
+    TexturePool *pool;
+};
+
+typedef UniqueHandle<SDL_Surface, PoolDeleter> PooledSurface;
+typedef UniqueHandle<SDL_Texture, PoolDeleter> PooledTexture;
+
+// Keeps temporary surfaces and textures around for reuse instead of
+// freeing them, so code that makes a short lived surface or texture
+// every time (text rendering, image conversion) stops going back to the
+// allocator and the driver. Objects are sorted into buckets by format,
+// texture access and size class, and a request is served from the
+// matching bucket when it has an idle object.
+//
+// Objects are handed back with release, or by a PooledSurface or
+// PooledTexture handle going out of scope, not with cleanup(), which
+// would free them behind the pool's back. Everything must be handed
+// back before the pool is destroyed.
+//
+// Surface pixels are allocated at the size class, and handed out through
+// a surface made with SDL_CreateRGBSurfaceWithFormatFrom over them at
+// exactly the size asked for. Textures cannot be resized, so they are
+// the size of their class: only the top left width x height is meant to
+// be used, draw with that as the source rect. Nothing is cleared when an
+// object is reused.
+//
+// Destroying a renderer destroys every texture on it, so a pool must be
+// destroyed before the renderer it was given, eg. by declaring it after
+// the renderer's handle.
+class TexturePool
+{
+public:
+    // @param ren The renderer textures are created on
+    // @param idleBudget Most bytes of idle objects to keep, objects
+    //        released past this are freed instead
+    explicit TexturePool(SDL_Renderer *ren, size_t idleBudget = 32 * 1024 * 1024)
+        : renderer(ren), budget(idleBudget)
+    {
+        std::memset(&stats, 0, sizeof(stats));
+    }
+
+    // Frees everything the pool created. Objects still handed out are
+    // freed too, using them after this is an error.
+    ~TexturePool()
+    {
+        SDL_assert(surfaces_out.empty() && textures_out.empty());
+        for (auto &out : surfaces_out)
+        {
+            SDL_FreeSurface(out.first);
+            SDL_FreeSurface(out.second.second);
+        }
+        for (auto &out : textures_out)
+        {
+            SDL_DestroyTexture(out.first);
+        }
+        purge();
+    }
+
+    // Get a surface of at least the given size
+    // @param w Width of the surface
+    // @param h Height of the surface
+    // @param format The SDL_PIXELFORMAT_* of the surface
+    // @return a surface of exactly w x h with undefined contents, or
+    //         nullptr if one could not be created
+    SDL_Surface* acquireSurface(int w, int h, Uint32 format)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const BucketKey key(format, -1, poolBucketSize(w), poolBucketSize(h));
+        std::vector<PoolSlot> &idle = surface_buckets[key];
+
+        PoolSlot pooled = { nullptr, nullptr };
+        if (!idle.empty())
+        {
+            pooled = idle.back();
+            idle.pop_back();
+            stats.idle_bytes -= surfaceBytes(pooled.pixels);
+            ++stats.surface_hits;
+        }
+        else
+        {
+            pooled.pixels = SDL_CreateRGBSurfaceWithFormat(0, std::get<2>(key), std::get<3>(key),
+                SDL_BITSPERPIXEL(format), format);
+            if (pooled.pixels == nullptr)
+            {
+                std::cout << "TexturePool CreateSurface" << SDL_GetError() << std::endl;
+                return nullptr;
+            }
+            ++stats.surface_misses;
+            addResident(surfaceBytes(pooled.pixels));
+        }
+
+        // The view from last time is kept if it is already the right
+        // size, otherwise a new one is made over the same pixels. Rows
+        // keep the pitch of the full size surface
+        if (pooled.view == nullptr || pooled.view->w != w || pooled.view->h != h)
+        {
+            SDL_FreeSurface(pooled.view);
+            pooled.view = SDL_CreateRGBSurfaceWithFormatFrom(pooled.pixels->pixels, w, h,
+                SDL_BITSPERPIXEL(format), pooled.pixels->pitch, format);
+            if (pooled.view == nullptr)
+            {
+                std::cout << "TexturePool CreateSurfaceFrom" << SDL_GetError() << std::endl;
+                removeResident(surfaceBytes(pooled.pixels));
+                SDL_FreeSurface(pooled.pixels);
+                return nullptr;
+            }
+        }
+        surfaces_out[pooled.view] = std::make_pair(key, pooled.pixels);
+        return pooled.view;
+    }
+
+    // Get a texture of at least the given size
+    // @param w Width needed
+    // @param h Height needed
+    // @param format The SDL_PIXELFORMAT_* of the texture
+    // @param access The SDL_TEXTUREACCESS_* of the texture
+    // @return a texture of the size class of w x h with undefined
+    //         contents, or nullptr if one could not be created
+    SDL_Texture* acquireTexture(int w, int h, Uint32 format, int access)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const BucketKey key(format, access, poolBucketSize(w), poolBucketSize(h));
+        std::vector<SDL_Texture*> &idle = texture_buckets[key];
+
+        SDL_Texture *texture = nullptr;
+        if (!idle.empty())
+        {
+            texture = idle.back();
+            idle.pop_back();
+            stats.idle_bytes -= keyBytes(key);
+            ++stats.texture_hits;
+        }
+        else
+        {
+            texture = SDL_CreateTexture(renderer, format, access, std::get<2>(key),
+                std::get<3>(key));
+            if (texture == nullptr)
+            {
+                std::cout << "TexturePool CreateTexture" << SDL_GetError() << std::endl;
+                return nullptr;
+            }
+            ++stats.texture_misses;
+            addResident(keyBytes(key));
+        }
+        textures_out[texture] = key;
+        return texture;
+    }
+
+    // Take back a surface from acquireSurface
+    // @return false if the surface did not come from this pool, it is
+    //         left alone
+    bool release(SDL_Surface *surface)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = surfaces_out.find(surface);
+        if (found == surfaces_out.end())
+        {
+            return false;
+        }
+        if (surface->refcount > 1)
+        {
+            // Someone else still holds a reference, as with SDL_FreeSurface
+            --surface->refcount;
+            return true;
+        }
+
+        const BucketKey key = found->second.first;
+        PoolSlot pooled = { found->second.second, surface };
+        surfaces_out.erase(found);
+        SDL_SetClipRect(surface, nullptr);
+        SDL_SetColorKey(surface, SDL_FALSE, 0);
+        SDL_SetSurfaceColorMod(surface, 255, 255, 255);
+        SDL_SetSurfaceAlphaMod(surface, 255);
+        SDL_SetSurfaceBlendMode(surface, SDL_ISPIXELFORMAT_ALPHA(std::get<0>(key)) ?
+            SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+        ++stats.releases;
+
+        const size_t bytes = surfaceBytes(pooled.pixels);
+        if (stats.idle_bytes + bytes > budget)
+        {
+            SDL_FreeSurface(pooled.view);
+            SDL_FreeSurface(pooled.pixels);
+            removeResident(bytes);
+            return true;
+        }
+        surface_buckets[key].push_back(pooled);
+        stats.idle_bytes += bytes;
+        return true;
+    }
+
+    // Take back a texture from acquireTexture
+    // @return false if the texture did not come from this pool, it is
+    //         left alone
+    bool release(SDL_Texture *texture)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = textures_out.find(texture);
+        if (found == textures_out.end())
+        {
+            return false;
+        }
+
+        const BucketKey key = found->second;
+        textures_out.erase(found);
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+        SDL_SetTextureColorMod(texture, 255, 255, 255);
+        SDL_SetTextureAlphaMod(texture, 255);
+        ++stats.releases;
+
+        const size_t bytes = keyBytes(key);
+        if (stats.idle_bytes + bytes > budget)
+        {
+            SDL_DestroyTexture(texture);
+            removeResident(bytes);
+            return true;
+        }
+        texture_buckets[key].push_back(texture);
+        stats.idle_bytes += bytes;
+        return true;
+    }
+
+    // Free every idle object
+    void purge()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &bucket : surface_buckets)
+        {
+            for (size_t i = 0; i < bucket.second.size(); ++i)
+            {
+                removeResident(surfaceBytes(bucket.second[i].pixels));
+                SDL_FreeSurface(bucket.second[i].view);
+                SDL_FreeSurface(bucket.second[i].pixels);
+            }
+            bucket.second.clear();
+        }
+        for (auto &bucket : texture_buckets)
+        {
+            for (size_t i = 0; i < bucket.second.size(); ++i)
+            {
+                SDL_DestroyTexture(bucket.second[i]);
+                removeResident(keyBytes(bucket.first));
+            }
+            bucket.second.clear();
+        }
+        stats.idle_bytes = 0;
+    }
+
+    // Change the idle budget. Idle objects over the new budget stay
+    // until purge is called.
+    void setBudget(size_t idleBudget)
+    {
+        budget = idleBudget;
+    }
+
+    const TexturePoolStats& getStats() const
+    {
+        return stats;
+    }
+
+private:
+    // Format, access (-1 for surfaces), width and height class
+    typedef std::tuple<Uint32, int, int, int> BucketKey;
+
+    static size_t keyBytes(const BucketKey &key)
+    {
+        size_t bpp = SDL_BYTESPERPIXEL(std::get<0>(key));
+        if (bpp == 0)
+        {
+            bpp = 4;
+        }
+        return size_t(std::get<2>(key)) * std::get<3>(key) * bpp;
+    }
+
+    static size_t surfaceBytes(const SDL_Surface *surface)
+    {
+        return size_t(surface->pitch) * surface->h;
+    }
+
+    void addResident(size_t bytes)
+    {
+        stats.resident_bytes += bytes;
+        stats.peak_resident_bytes = std::max(stats.peak_resident_bytes, stats.resident_bytes);
+    }
+
+    void removeResident(size_t bytes)
+    {
+        stats.resident_bytes -= bytes;
+        ++stats.destroyed;
+    }
+
+    // Pixels at the full size of a bucket, and the surface handed out
+    // over them
+    struct PoolSlot
+    {
+        SDL_Surface *pixels;
+        SDL_Surface *view;
+    };
+
+    TexturePool(const TexturePool&) = delete;
+    TexturePool& operator=(const TexturePool&) = delete;
+
+    SDL_Renderer *renderer;
+    size_t budget;
+    TexturePoolStats stats;
+    std::map<BucketKey, std::vector<PoolSlot> > surface_buckets;
+    std::map<BucketKey, std::vector<SDL_Texture*> > texture_buckets;
+    std::unordered_map<SDL_Surface*, std::pair<BucketKey, SDL_Surface*> > surfaces_out;
+    std::unordered_map<SDL_Texture*, BucketKey> textures_out;
+    std::mutex mutex;
+};
+
+inline void PoolDeleter::operator()(SDL_Surface *surface) const
+{
+    if (surface != nullptr && !pool->release(surface))
+    {
+        SDL_FreeSurface(surface);
+    }
+}
+
+inline void PoolDeleter::operator()(SDL_Texture *texture) const
+{
+    if (texture != nullptr && !pool->release(texture))
+    {
+        SDL_DestroyTexture(texture);
+    }
+}
+
+// Upload a surface into a texture from the pool, the pooled version of
+// createTextureFromSurfaceFast. The conversion goes through a pooled
+// scratch surface, so after the first few calls nothing is allocated.
+// @param pool The pool to take the texture and scratch surface from
+// @param surface The surface to upload
+// @param flags PIXEL_CONVERT_* options
+// @return the texture with width and height set to the surface's size,
+//         the part of the pooled texture that holds the image, texture is
+//         nullptr if something went wrong. Hand it back with
+//         pool.release(tex.texture) or a PooledTexture.
+inline Texture createPooledTexture(TexturePool &pool, SDL_Renderer *ren, SDL_Surface *surface,
+    int flags = PIXEL_CONVERT_COLORKEY)
+{
+    Texture result = makeTexture(nullptr);
+    const Uint32 format = nativeTextureFormat(ren);
+    SDL_Texture *texture = pool.acquireTexture(surface->w, surface->h, format,
+        SDL_TEXTUREACCESS_STATIC);
+    if (texture == nullptr)
+    {
+        return result;
+    }
+    flags = setUploadBlendMode(texture, surface, flags);
+
+    SDL_Surface *source = surface;
+    PixelLayout layout;
+    if (!getPixelLayout(surface->format->format, layout))
+    {
+        // Expanding keeps the color key, so it is still applied below
+        source = SDL_ConvertSurfaceFormat(surface, format, 0);
+        if (source == nullptr)
+        {
+            std::cout << "SDL_ConvertSurfaceFormat" << SDL_GetError() << std::endl;
+            pool.release(texture);
+            return result;
+        }
+    }
+
+    SDL_Surface *scratch = pool.acquireSurface(surface->w, surface->h, format);
+    const SDL_Rect area = { 0, 0, surface->w, surface->h };
+    bool ok = scratch != nullptr &&
+        convertPixels(source, format, scratch->pixels, scratch->pitch, flags) &&
+        SDL_UpdateTexture(texture, &area, scratch->pixels, scratch->pitch) == 0;
+    if (scratch != nullptr)
+    {
+        pool.release(scratch);
+    }
+    if (source != surface)
+    {
+        SDL_FreeSurface(source);
+    }
+    if (!ok)
+    {
+        std::cout << "SDL_UpdateTexture" << SDL_GetError() << std::endl;
+        pool.release(texture);
+        return result;
+    }
+
+    result.texture = texture;
+    result.width = surface->w;
+    result.height = surface->h;
+    result.format = format;
+    result.access = SDL_TEXTUREACCESS_STATIC;
+    return result;
+}
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef TILE_LAYER_H
+#define TILE_LAYER_H
+
+#include <iostream>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "texture.h"
+
+// A square block of tiles that is baked into its own render target
+struct TileChunk
+{
+    SDL_Texture *texture;
+
+    // Needs to be redrawn into its texture before the next use
+    bool dirty;
+
+    // Frame the chunk was last drawn on, used to pick which chunks to
+    // throw away when too many are resident
+    Uint32 last_used;
+};
+
+// A grid of tiles that never changes from frame to frame, eg. a
+// background. Instead of drawing every tile every frame, the map is split
+// into chunks and each chunk is drawn once into an SDL_TEXTUREACCESS_TARGET
+// texture. A frame then only costs one SDL_RenderCopy per chunk that
+// overlaps the viewport. Changing a tile only marks its chunk dirty, and
+// chunk textures are created on first use and dropped again when more
+// than maxResidentChunks are alive, so huge maps only pay for what has
+// been on screen recently.
+//
+// If the renderer cannot render to textures, chunks are drawn tile by
+// tile every frame instead.
+class TileLayer
+{
+public:
+    static const int EMPTY_TILE = -1;
+
+    // @param ren The renderer the chunk textures will live on
+    // @param tileset The texture tiles are cut from
+    // @param tileClips Where each tile id lives within the tileset
+    // @param mapWidth Width of the map in tiles
+    // @param mapHeight Height of the map in tiles
+    // @param tileSize Width and height of a tile on screen in pixels
+    // @param chunkTiles Width and height of a chunk in tiles
+    // @param maxResidentChunks How many chunk textures may exist at once
+    TileLayer(SDL_Renderer *ren, const Texture &tileset,
+        const std::vector<SDL_Rect> &tileClips, int mapWidth, int mapHeight,
+        int tileSize, int chunkTiles = 16, int maxResidentChunks = 64)
+        : renderer(ren), tileset(tileset), clips(tileClips),
+          map_width(mapWidth), map_height(mapHeight), tile_size(tileSize),
+          chunk_tiles(chunkTiles), max_resident(maxResidentChunks),
+          resident(0), frame(0), rebuilds(0), targets_supported(true),
+          tiles(mapWidth * mapHeight, int(EMPTY_TILE))
+    {
+        chunks_x = (map_width + chunk_tiles - 1) / chunk_tiles;
+        chunks_y = (map_height + chunk_tiles - 1) / chunk_tiles;
+
+        TileChunk empty;
+        empty.texture = nullptr;
+        empty.dirty = true;
+        empty.last_used = 0;
+        chunks.assign(chunks_x * chunks_y, empty);
+
+        SDL_RendererInfo info;
+        if (SDL_GetRendererInfo(renderer, &info) != 0 ||
+            (info.flags & SDL_RENDERER_TARGETTEXTURE) == 0)
+        {
+            targets_supported = false;
+        }
+    }
+
+    ~TileLayer()
+    {
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            if (chunks[i].texture != nullptr)
+            {
+                SDL_DestroyTexture(chunks[i].texture);
+            }
+        }
+    }
+
+    // Change one tile, marking the chunk holding it for a rebuild
+    // @param x Column of the tile
+    // @param y Row of the tile
+    // @param id Index into the tile clips, or EMPTY_TILE
+    void setTile(int x, int y, int id)
+    {
+        if (x < 0 || y < 0 || x >= map_width || y >= map_height)
+        {
+            return;
+        }
+        int &tile = tiles[y * map_width + x];
+        if (tile != id)
+        {
+            tile = id;
+            chunks[(y / chunk_tiles) * chunks_x + (x / chunk_tiles)].dirty = true;
+        }
+    }
+
+    // Set every tile in the map to the same id
+    void fill(int id)
+    {
+        tiles.assign(tiles.size(), id);
+        invalidate();
+    }
+
+    int getTile(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= map_width || y >= map_height)
+        {
+            return EMPTY_TILE;
+        }
+        return tiles[y * map_width + x];
+    }
+
+    // Mark every chunk dirty, eg. after SDL_RENDER_TARGETS_RESET when
+    // the contents of render targets have been lost
+    void invalidate()
+    {
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            chunks[i].dirty = true;
+        }
+    }
+
+    // Draw the part of the map that is inside the viewport
+    // @param view The area of the map in pixels to show, the top left of
+    //             the view is drawn at the top left of the screen
+    // @return how many chunks were drawn
+    int draw(const SDL_Rect &view)
+    {
+        ++frame;
+
+        const int chunk_px = chunk_tiles * tile_size;
+        int first_x = view.x / chunk_px;
+        int first_y = view.y / chunk_px;
+        int last_x = (view.x + view.w - 1) / chunk_px;
+        int last_y = (view.y + view.h - 1) / chunk_px;
+        if (first_x < 0) first_x = 0;
+        if (first_y < 0) first_y = 0;
+        if (last_x >= chunks_x) last_x = chunks_x - 1;
+        if (last_y >= chunks_y) last_y = chunks_y - 1;
+
+        int drawn = 0;
+        for (int cy = first_y; cy <= last_y; ++cy)
+        {
+            for (int cx = first_x; cx <= last_x; ++cx)
+            {
+                const int origin_x = cx * chunk_px - view.x;
+                const int origin_y = cy * chunk_px - view.y;
+                TileChunk &chunk = chunks[cy * chunks_x + cx];
+                chunk.last_used = frame;
+
+                if (!targets_supported)
+                {
+                    drawTiles(cx, cy, origin_x, origin_y);
+                    ++drawn;
+                    continue;
+                }
+
+                if (chunk.texture == nullptr || chunk.dirty)
+                {
+                    if (!rebuild(cx, cy))
+                    {
+                        drawTiles(cx, cy, origin_x, origin_y);
+                        ++drawn;
+                        continue;
+                    }
+                }
+
+                SDL_Rect dst;
+                dst.x = origin_x;
+                dst.y = origin_y;
+                dst.w = chunk_px;
+                dst.h = chunk_px;
+                SDL_RenderCopy(renderer, chunk.texture, NULL, &dst);
+                ++drawn;
+            }
+        }
+
+        trim();
+        return drawn;
+    }
+
+    int getMapWidth() const { return map_width; }
+    int getMapHeight() const { return map_height; }
+    int getResidentChunks() const { return resident; }
+
+    // Number of times a chunk has been redrawn into its texture
+    long getRebuilds() const { return rebuilds; }
+
+private:
+    // Redraw one chunk into its texture, creating it if needed
+    // @return false if the chunk could not be rendered to
+    bool rebuild(int cx, int cy)
+    {
+        TileChunk &chunk = chunks[cy * chunks_x + cx];
+        const int chunk_px = chunk_tiles * tile_size;
+        if (chunk.texture == nullptr)
+        {
+            chunk.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                SDL_TEXTUREACCESS_TARGET, chunk_px, chunk_px);
+            if (chunk.texture == nullptr)
+            {
+                std::cout << "TileLayer CreateTexture" << SDL_GetError() << std::endl;
+                return false;
+            }
+            ++resident;
+        }
+
+        SDL_Texture *old_target = SDL_GetRenderTarget(renderer);
+        if (SDL_SetRenderTarget(renderer, chunk.texture) != 0)
+        {
+            std::cout << "TileLayer SetRenderTarget" << SDL_GetError() << std::endl;
+            return false;
+        }
+
+        // Empty tiles have to be see-through, so clear to transparent
+        // rather than whatever the draw color happens to be
+        Uint8 r, g, b, a;
+        SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        SDL_RenderClear(renderer);
+        SDL_SetRenderDrawColor(renderer, r, g, b, a);
+
+        // Tiles never overlap, so they are copied into the chunk as they
+        // are and only blended when the chunk is drawn. Blending them into
+        // the chunk as well would multiply their color by alpha twice
+        SDL_BlendMode tile_mode = SDL_BLENDMODE_BLEND;
+        SDL_GetTextureBlendMode(tileset.texture, &tile_mode);
+        SDL_SetTextureBlendMode(tileset.texture, SDL_BLENDMODE_NONE);
+        drawTiles(cx, cy, 0, 0);
+        SDL_SetTextureBlendMode(tileset.texture, tile_mode);
+        SDL_SetTextureBlendMode(chunk.texture, chunkBlendMode(cx, cy, tile_mode));
+
+        SDL_SetRenderTarget(renderer, old_target);
+        chunk.dirty = false;
+        ++rebuilds;
+        return true;
+    }
+
+    // Blend mode to draw a chunk with so it looks the same as its tiles
+    // drawn one by one. Chunks of opaque tiles with nothing empty or off
+    // the edge of the map are copied without blending at all
+    // @param tileMode The tileset's blend mode
+    SDL_BlendMode chunkBlendMode(int cx, int cy, SDL_BlendMode tileMode) const
+    {
+        if (tileMode != SDL_BLENDMODE_NONE &&
+            (tileMode != SDL_BLENDMODE_BLEND || SDL_ISPIXELFORMAT_ALPHA(tileset.format)))
+        {
+            return tileMode;
+        }
+
+        const int start_x = cx * chunk_tiles;
+        const int start_y = cy * chunk_tiles;
+        if (start_x + chunk_tiles > map_width || start_y + chunk_tiles > map_height)
+        {
+            return SDL_BLENDMODE_BLEND;
+        }
+        for (int ty = 0; ty < chunk_tiles; ++ty)
+        {
+            for (int tx = 0; tx < chunk_tiles; ++tx)
+            {
+                const int id = tiles[(start_y + ty) * map_width + (start_x + tx)];
+                if (id < 0 || id >= int(clips.size()))
+                {
+                    return SDL_BLENDMODE_BLEND;
+                }
+            }
+        }
+        return SDL_BLENDMODE_NONE;
+    }
+
+    // Draw the tiles of one chunk with its top left corner at x, y
+    void drawTiles(int cx, int cy, int x, int y)
+    {
+        const int start_x = cx * chunk_tiles;
+        const int start_y = cy * chunk_tiles;
+        for (int ty = 0; ty < chunk_tiles && start_y + ty < map_height; ++ty)
+        {
+            for (int tx = 0; tx < chunk_tiles && start_x + tx < map_width; ++tx)
+            {
+                const int id = tiles[(start_y + ty) * map_width + (start_x + tx)];
+                if (id < 0 || id >= int(clips.size()))
+                {
+                    continue;
+                }
+
+                SDL_Rect dst;
+                dst.x = x + tx * tile_size;
+                dst.y = y + ty * tile_size;
+                dst.w = tile_size;
+                dst.h = tile_size;
+                SDL_RenderCopy(renderer, tileset.texture, &clips[id], &dst);
+            }
+        }
+    }
+
+    // Destroy the least recently drawn chunk textures until we are back
+    // under the resident limit. Chunks drawn this frame are kept.
+    void trim()
+    {
+        while (resident > max_resident)
+        {
+            TileChunk *oldest = nullptr;
+            for (size_t i = 0; i < chunks.size(); ++i)
+            {
+                TileChunk &chunk = chunks[i];
+                if (chunk.texture != nullptr && chunk.last_used != frame &&
+                    (oldest == nullptr || chunk.last_used < oldest->last_used))
+                {
+                    oldest = &chunk;
+                }
+            }
+            if (oldest == nullptr)
+            {
+                return;
+            }
+
+            SDL_DestroyTexture(oldest->texture);
+            oldest->texture = nullptr;
+            oldest->dirty = true;
+            --resident;
+        }
+    }
+
+    TileLayer(const TileLayer&) = delete;
+    TileLayer& operator=(const TileLayer&) = delete;
+
+    SDL_Renderer *renderer;
+    Texture tileset;
+    std::vector<SDL_Rect> clips;
+    int map_width;
+    int map_height;
+    int tile_size;
+    int chunk_tiles;
+    int chunks_x;
+    int chunks_y;
+    int max_resident;
+    int resident;
+    Uint32 frame;
+    long rebuilds;
+    bool targets_supported;
+    std::vector<int> tiles;
+    std::vector<TileChunk> chunks;
+};
+
+#endif
@@ -0,0 +1,984 @@
+#ifndef TILE_RASTER_H
+#define TILE_RASTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "pixel_convert.h"
+#include "profiler.h"
+
+// Pixels drawn by a TiledRasterizer are SDL_PIXELFORMAT_ARGB8888, the
+// format SDL's software renderer uses for textures by default
+const Uint32 RASTER_PIXEL_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+// Something a TiledRasterizer can draw from, the equivalent of an
+// SDL_Texture. Color mod, alpha mod and blend mode work the same way and
+// are read when a copy is queued.
+struct RasterImage
+{
+    std::vector<Uint32> pixels;
+    int width;
+    int height;
+    Uint8 r;
+    Uint8 g;
+    Uint8 b;
+    Uint8 a;
+    SDL_BlendMode blend;
+};
+
+// Convert a surface into a RasterImage, the same way
+// SDL_CreateTextureFromSurface turns it into a texture: color keyed
+// pixels become transparent and images with alpha or a color key blend
+// @param surface The surface to convert
+// @param image Filled with the converted pixels
+// @return false if the surface could not be converted
+inline bool makeRasterImage(SDL_Surface *surface, RasterImage &image)
+{
+    SDL_Surface *source = surface;
+    PixelLayout layout;
+    if (!getPixelLayout(surface->format->format, layout))
+    {
+        source = SDL_ConvertSurfaceFormat(surface, RASTER_PIXEL_FORMAT, 0);
+        if (source == nullptr)
+        {
+            std::cout << "SDL_ConvertSurfaceFormat" << SDL_GetError() << std::endl;
+            return false;
+        }
+    }
+
+    image.width = surface->w;
+    image.height = surface->h;
+    image.pixels.resize(size_t(surface->w) * surface->h);
+    bool ok = convertPixels(source, RASTER_PIXEL_FORMAT, image.pixels.data(),
+        surface->w * 4, PIXEL_CONVERT_COLORKEY);
+    if (source != surface)
+    {
+        SDL_FreeSurface(source);
+    }
+    if (!ok)
+    {
+        std::cout << "makeRasterImage unsupported format" << std::endl;
+        return false;
+    }
+
+    image.r = 255;
+    image.g = 255;
+    image.b = 255;
+    image.a = 255;
+    image.blend = (surface->format->Amask != 0 || SDL_HasColorKey(surface)) ?
+        SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE;
+    return true;
+}
+
+// Runs a batch of independent jobs on a fixed set of threads, the
+// calling thread included. Each thread starts with an even share of the
+// jobs and once it runs out takes jobs from the others' shares, so a
+// few expensive jobs do not leave the rest of the threads idle.
+class RasterThreadPool
+{
+public:
+    // Called for every job with the job's index and the thread running it
+    typedef void (*JobFunc)(void *context, int job, int thread);
+
+    // @param threads How many threads run jobs, including the caller
+    explicit RasterThreadPool(int threads)
+        : queues(std::max(threads, 1)), func(nullptr), context(nullptr),
+          generation(0), busy(0), stopping(false), steals(0)
+    {
+        for (int i = 1; i < int(queues.size()); ++i)
+        {
+            workers.push_back(std::thread(&RasterThreadPool::workerLoop, this, i));
+        }
+    }
+
+    ~RasterThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            workers[i].join();
+        }
+    }
+
+    // Run jobs 0 to count - 1 and wait for all of them to finish
+    void run(int count, JobFunc job, void *ctx)
+    {
+        const int threads = int(queues.size());
+        for (int i = 0; i < threads; ++i)
+        {
+            queues[i].next.store(long(count) * i / threads);
+            queues[i].end = int(long(count) * (i + 1) / threads);
+        }
+
+        if (threads > 1)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            func = job;
+            context = ctx;
+            busy = threads - 1;
+            ++generation;
+        }
+        else
+        {
+            func = job;
+            context = ctx;
+        }
+        wake.notify_all();
+
+        drain(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return busy == 0; });
+    }
+
+    // @return how many threads run jobs, including the caller
+    int size() const
+    {
+        return int(queues.size());
+    }
+
+    // @return how many jobs were taken from another thread's share
+    long getSteals() const
+    {
+        return steals.load();
+    }
+
+private:
+    // One thread's share of the jobs. Padded so threads taking jobs from
+    // their own share do not fight over a cache line.
+    struct Queue
+    {
+        Queue()
+            : next(0), end(0)
+        {
+        }
+
+        std::atomic<int> next;
+        int end;
+        char padding[64 - sizeof(std::atomic<int>) - sizeof(int)];
+    };
+
+    void workerLoop(int index)
+    {
+        int seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping)
+                {
+                    return;
+                }
+                seen = generation;
+            }
+
+            drain(index);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0)
+            {
+                done.notify_one();
+            }
+        }
+    }
+
+    // Run our own jobs, then help with everyone else's
+    void drain(int self)
+    {
+        const int threads = int(queues.size());
+        for (int i = 0; i < threads; ++i)
+        {
+            Queue &queue = queues[(self + i) % threads];
+            int job;
+            while ((job = queue.next.fetch_add(1)) < queue.end)
+            {
+                if (i != 0)
+                {
+                    ++steals;
+                }
+                func(context, job, self);
+            }
+        }
+    }
+
+    RasterThreadPool(const RasterThreadPool&) = delete;
+    RasterThreadPool& operator=(const RasterThreadPool&) = delete;
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    JobFunc func;
+    void *context;
+    int generation;
+    int busy;
+    bool stopping;
+    std::atomic<long> steals;
+};
+
+// Blend a row of ARGB8888 pixels onto another with their own alpha, the
+// way SDL blits a blended texture that is not scaled or color modded.
+// Each channel is (src * alpha >> 8) + (dst * (255 - alpha) >> 8), with
+// the source alpha channel counting as 255, opaque pixels are copied as
+// they are and transparent ones leave the destination alone. That is
+// what SDL's MMX kernel for this blit computes. SDL picks the kernel by
+// CPU and its other kernels, and other SDL versions, round differently,
+// so SDL_BenchRaster is what shows whether the installed SDL matches.
+inline void blendRowScalar(const Uint32 *src, Uint32 *dst, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        const Uint32 s = src[i];
+        const Uint32 alpha = s >> 24;
+        if (alpha == 0)
+        {
+            continue;
+        }
+        if (alpha == 255)
+        {
+            dst[i] = s;
+            continue;
+        }
+
+        const Uint32 d = dst[i];
+        const Uint32 inverse = 255 - alpha;
+        Uint32 out = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            const Uint32 sc = (s >> shift) & 0xff;
+            const Uint32 dc = (d >> shift) & 0xff;
+            const Uint32 scale = shift == 24 ? 255 : alpha;
+            const Uint32 c = std::min<Uint32>(((sc * scale) >> 8) + ((dc * inverse) >> 8), 255);
+            out |= c << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+#ifdef PIXEL_CONVERT_SSE2
+inline void blendRowSSE2(const Uint32 *src, Uint32 *dst, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+
+    // The source alpha channel is scaled by 255 instead of alpha
+    const __m128i alpha_slot = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m128i alpha_mask = _mm_set1_epi32(int(0xff000000u));
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        const __m128i a = _mm_and_si128(s, alpha_mask);
+
+        // Skip groups of four that are all transparent, common around
+        // sprites and glyphs
+        const __m128i transparent = _mm_cmpeq_epi32(a, zero);
+        if (_mm_movemask_epi8(transparent) == 0xffff)
+        {
+            continue;
+        }
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i opaque = _mm_cmpeq_epi32(a, alpha_mask);
+
+        // Alpha of each pixel in all four 16 bit channels of that pixel
+        __m128i alpha = _mm_srli_epi32(s, 24);
+        alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+        const __m128i alpha_lo = _mm_unpacklo_epi32(alpha, alpha);
+        const __m128i alpha_hi = _mm_unpackhi_epi32(alpha, alpha);
+
+        __m128i blended[2];
+        const __m128i alphas[2] = { alpha_lo, alpha_hi };
+        const __m128i sources[2] = { _mm_unpacklo_epi8(s, zero), _mm_unpackhi_epi8(s, zero) };
+        const __m128i dests[2] = { _mm_unpacklo_epi8(d, zero), _mm_unpackhi_epi8(d, zero) };
+        for (int half = 0; half < 2; ++half)
+        {
+            const __m128i scale = _mm_or_si128(alphas[half], _mm_and_si128(alpha_slot, full));
+            const __m128i inverse = _mm_xor_si128(alphas[half], full);
+            const __m128i from_src = _mm_srli_epi16(_mm_mullo_epi16(sources[half], scale), 8);
+            const __m128i from_dst = _mm_srli_epi16(_mm_mullo_epi16(dests[half], inverse), 8);
+            blended[half] = _mm_add_epi16(from_src, from_dst);
+        }
+        __m128i out = _mm_packus_epi16(blended[0], blended[1]);
+
+        out = _mm_or_si128(_mm_and_si128(opaque, s), _mm_andnot_si128(opaque, out));
+        out = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, out));
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+    }
+    blendRowScalar(src + i, dst + i, n - i);
+}
+#endif
+
+// Blend a row of pixels with their own alpha, picking the kernel from
+// pixelKernelLevel like the conversion kernels do
+inline void blendRow(const Uint32 *src, Uint32 *dst, int n)
+{
+#ifdef PIXEL_CONVERT_SSE2
+    if (pixelKernelLevel() >= PIXEL_KERNELS_SSE2)
+    {
+        blendRowSSE2(src, dst, n);
+        return;
+    }
+#endif
+    blendRowScalar(src, dst, n);
+}
+
+// Per draw settings the general pixel path needs
+struct RasterBlendState
+{
+    SDL_BlendMode blend;
+    bool modulate_color;
+    bool modulate_alpha;
+    Uint32 r;
+    Uint32 g;
+    Uint32 b;
+    Uint32 a;
+};
+
+// Draw one pixel the way SDL's generated blitters do for scaled or
+// color modded copies, with divides by 255 throughout
+inline Uint32 blendPixelGeneral(Uint32 s, Uint32 d, const RasterBlendState &state)
+{
+    Uint32 sr = (s >> 16) & 0xff, sg = (s >> 8) & 0xff, sb = s & 0xff, sa = s >> 24;
+    Uint32 dr = (d >> 16) & 0xff, dg = (d >> 8) & 0xff, db = d & 0xff, da = d >> 24;
+    if (state.modulate_color)
+    {
+        sr = sr * state.r / 255;
+        sg = sg * state.g / 255;
+        sb = sb * state.b / 255;
+    }
+    if (state.modulate_alpha)
+    {
+        sa = sa * state.a / 255;
+    }
+    if ((state.blend == SDL_BLENDMODE_BLEND || state.blend == SDL_BLENDMODE_ADD) && sa < 255)
+    {
+        sr = sr * sa / 255;
+        sg = sg * sa / 255;
+        sb = sb * sa / 255;
+    }
+
+    switch (state.blend)
+    {
+        case SDL_BLENDMODE_BLEND:
+            dr = sr + (255 - sa) * dr / 255;
+            dg = sg + (255 - sa) * dg / 255;
+            db = sb + (255 - sa) * db / 255;
+            da = sa + (255 - sa) * da / 255;
+            break;
+        case SDL_BLENDMODE_ADD:
+            dr = std::min<Uint32>(sr + dr, 255);
+            dg = std::min<Uint32>(sg + dg, 255);
+            db = std::min<Uint32>(sb + db, 255);
+            break;
+        case SDL_BLENDMODE_MOD:
+            dr = sr * dr / 255;
+            dg = sg * dg / 255;
+            db = sb * db / 255;
+            break;
+        default:
+            dr = sr;
+            dg = sg;
+            db = sb;
+            da = sa;
+            break;
+    }
+    return (da << 24) | (dr << 16) | (dg << 8) | db;
+}
+
+// Draw one pixel of a filled rectangle the way SDL_BlendFillRect does
+// @param color The draw color, already multiplied by its alpha for
+//        blended and additive fills
+inline Uint32 blendFillPixel(Uint32 d, Uint32 r, Uint32 g, Uint32 b, Uint32 a,
+    SDL_BlendMode blend)
+{
+    Uint32 dr = (d >> 16) & 0xff, dg = (d >> 8) & 0xff, db = d & 0xff, da = d >> 24;
+    const Uint32 inverse = 255 - a;
+    switch (blend)
+    {
+        case SDL_BLENDMODE_BLEND:
+            dr = inverse * dr / 255 + r;
+            dg = inverse * dg / 255 + g;
+            db = inverse * db / 255 + b;
+            da = inverse * da / 255 + a;
+            break;
+        case SDL_BLENDMODE_ADD:
+            dr = std::min<Uint32>(dr + r, 255);
+            dg = std::min<Uint32>(dg + g, 255);
+            db = std::min<Uint32>(db + b, 255);
+            break;
+        case SDL_BLENDMODE_MOD:
+            dr = dr * r / 255;
+            dg = dg * g / 255;
+            db = db * b / 255;
+            break;
+        default:
+            return (a << 24) | (r << 16) | (g << 8) | b;
+    }
+    return (da << 24) | (dr << 16) | (dg << 8) | db;
+}
+
+// What a queued draw does
+enum RasterOp
+{
+    RASTER_FILL = 0,
+    RASTER_COPY = 1
+};
+
+// One queued draw
+struct RasterCommand
+{
+    int op;
+
+    // The area drawn, already clipped to the clip rect and the target
+    SDL_Rect area;
+
+    // For copies: the source and destination rects, which together give
+    // the scale. Scaled copies have them clipped the way SDL clips them
+    const RasterImage *image;
+    SDL_Rect src;
+    SDL_Rect dst;
+    bool scaled;
+
+    // Color (fills) or color mod (copies), and blending
+    RasterBlendState state;
+};
+
+// Counters kept by a TiledRasterizer
+struct TiledRasterStats
+{
+    long flushes;
+    long commands;
+
+    // Commands summed over every tile they touch
+    long binned;
+    long steals;
+};
+
+// A software renderer for machines without a GPU that uses every core.
+// It takes the same draw calls as an SDL_Renderer (clear, fill, copies
+// with source and clip rects, color and alpha mod) and queues them. On
+// flush the target is split into square tiles, each queued draw is added
+// to the list of every tile it touches, and tiles are drawn in parallel
+// on a RasterThreadPool. Draws land on each pixel in the order they were
+// made, so the result does not depend on the number of threads.
+//
+// Pixels are computed with the same arithmetic as the blitters behind
+// SDL's software renderer, so the output is meant to match it exactly
+// (SDL_BenchRaster checks this). Scaled copies follow SDL 2.0.16 and
+// later, which sample from half a step in. Blended copies that are not scaled or
+// modulated, usually most of a frame, use an SSE2 kernel when available.
+class TiledRasterizer
+{
+public:
+    // @param width Width of the target in pixels
+    // @param height Height of the target in pixels
+    // @param threads How many threads draw tiles, 0 for one per CPU
+    // @param tileSize Width and height of a tile
+    TiledRasterizer(int width, int height, int threads = 0, int tileSize = 64)
+        : width(width), height(height), tile_size(tileSize),
+          pool(threads > 0 ? threads : SDL_GetCPUCount()),
+          owned(size_t(width) * height), pixels(nullptr), pitch(width * 4),
+          blend(SDL_BLENDMODE_NONE), clip_enabled(false), used_temporaries(0)
+    {
+        pixels = owned.data();
+        color[0] = color[1] = color[2] = 0;
+        color[3] = 255;
+        tiles_x = (width + tileSize - 1) / tileSize;
+        tiles_y = (height + tileSize - 1) / tileSize;
+        bins.resize(size_t(tiles_x) * tiles_y);
+        std::memset(&stats, 0, sizeof(stats));
+    }
+
+    // Draw into memory the caller owns instead, eg. the pixels of an
+    // SDL_Surface in RASTER_PIXEL_FORMAT
+    // @param target width x height pixels, nullptr to go back to the
+    //        rasterizer's own buffer
+    // @param targetPitch Bytes from one row to the next
+    void setTarget(Uint32 *target, int targetPitch)
+    {
+        pixels = target != nullptr ? target : owned.data();
+        pitch = target != nullptr ? targetPitch : width * 4;
+    }
+
+    Uint32* getPixels() const { return pixels; }
+    int getPitch() const { return pitch; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getThreads() const { return pool.size(); }
+
+    void setDrawColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+    {
+        color[0] = r;
+        color[1] = g;
+        color[2] = b;
+        color[3] = a;
+    }
+
+    void setDrawBlendMode(SDL_BlendMode mode)
+    {
+        blend = mode;
+    }
+
+    // Limit drawing to a rectangle, nullptr to draw anywhere. Like
+    // SDL_RenderClear, clear ignores it.
+    void setClipRect(const SDL_Rect *rect)
+    {
+        clip_enabled = rect != nullptr;
+        if (rect != nullptr)
+        {
+            clip = *rect;
+        }
+    }
+
+    // Fill the whole target with the draw color. Anything queued before
+    // is covered up, so it is dropped.
+    void clear()
+    {
+        commands.clear();
+        used_temporaries = 0;
+        RasterCommand command = fillCommand(SDL_BLENDMODE_NONE);
+        command.area.x = 0;
+        command.area.y = 0;
+        command.area.w = width;
+        command.area.h = height;
+        commands.push_back(command);
+    }
+
+    // Fill a rectangle with the draw color and blend mode
+    // @param rect The rectangle, nullptr for the whole target
+    void fillRect(const SDL_Rect *rect)
+    {
+        RasterCommand command = fillCommand(blend);
+        SDL_Rect full = { 0, 0, width, height };
+        if (clipArea(rect != nullptr ? *rect : full, command.area))
+        {
+            commands.push_back(command);
+        }
+    }
+
+    // Queue a copy from an image, like SDL_RenderCopy
+    // @param image The image to draw, it must stay alive until flush
+    // @param src The part of the image to draw, nullptr for all of it
+    // @param dst Where to draw it, scaled to fit, nullptr for the whole target
+    // @return 0, like SDL_RenderCopy, which also draws nothing and
+    //         succeeds when src is outside the image
+    int copy(const RasterImage &image, const SDL_Rect *src, const SDL_Rect *dst)
+    {
+        RasterCommand command;
+        command.op = RASTER_COPY;
+        command.image = &image;
+        SDL_Rect whole = { 0, 0, image.width, image.height };
+        if (src != nullptr)
+        {
+            if (!SDL_IntersectRect(src, &whole, &command.src))
+            {
+                return 0;
+            }
+        }
+        else
+        {
+            command.src = whole;
+        }
+        if (dst != nullptr)
+        {
+            command.dst = *dst;
+        }
+        else
+        {
+            command.dst.x = 0;
+            command.dst.y = 0;
+            command.dst.w = width;
+            command.dst.h = height;
+        }
+        command.scaled = command.src.w != command.dst.w || command.src.h != command.dst.h;
+
+        command.state.blend = image.blend;
+        command.state.r = image.r;
+        command.state.g = image.g;
+        command.state.b = image.b;
+        command.state.a = image.a;
+        command.state.modulate_color = image.r != 255 || image.g != 255 || image.b != 255;
+        command.state.modulate_alpha = image.a != 255;
+
+        if (command.dst.w <= 0 || command.dst.h <= 0 || !clipArea(command.dst, command.area))
+        {
+            return 0;
+        }
+        if (command.scaled)
+        {
+            const bool inside = command.dst.x >= 0 && command.dst.y >= 0 &&
+                command.dst.x + command.dst.w <= width && command.dst.y + command.dst.h <= height;
+            if (!inside)
+            {
+                scaleToTemporary(command);
+            }
+            else if (!clipScaled(command))
+            {
+                return 0;
+            }
+        }
+        commands.push_back(command);
+        return 0;
+    }
+
+    // Draw everything queued into the target
+    void flush()
+    {
+        PROFILE_ZONE("raster flush");
+        for (size_t i = 0; i < bins.size(); ++i)
+        {
+            bins[i].clear();
+        }
+        for (size_t i = 0; i < commands.size(); ++i)
+        {
+            const SDL_Rect &area = commands[i].area;
+            const int first_x = area.x / tile_size;
+            const int last_x = (area.x + area.w - 1) / tile_size;
+            const int first_y = area.y / tile_size;
+            const int last_y = (area.y + area.h - 1) / tile_size;
+            for (int ty = first_y; ty <= last_y; ++ty)
+            {
+                for (int tx = first_x; tx <= last_x; ++tx)
+                {
+                    bins[ty * tiles_x + tx].push_back(int(i));
+                }
+            }
+            stats.binned += long(last_x - first_x + 1) * (last_y - first_y + 1);
+        }
+
+        const long steals_before = pool.getSteals();
+        pool.run(int(bins.size()), &TiledRasterizer::tileJob, this);
+        stats.steals += pool.getSteals() - steals_before;
+        stats.commands += long(commands.size());
+        ++stats.flushes;
+        commands.clear();
+        used_temporaries = 0;
+    }
+
+    const TiledRasterStats& getStats() const
+    {
+        return stats;
+    }
+
+private:
+    RasterCommand fillCommand(SDL_BlendMode mode) const
+    {
+        RasterCommand command;
+        command.op = RASTER_FILL;
+        command.image = nullptr;
+        command.scaled = false;
+        command.state.blend = mode;
+        command.state.modulate_color = false;
+        command.state.modulate_alpha = false;
+        command.state.a = color[3];
+        if (mode == SDL_BLENDMODE_BLEND || mode == SDL_BLENDMODE_ADD)
+        {
+            // SDL_BlendFillRect premultiplies the draw color up front
+            command.state.r = Uint32(color[0]) * color[3] / 255;
+            command.state.g = Uint32(color[1]) * color[3] / 255;
+            command.state.b = Uint32(color[2]) * color[3] / 255;
+        }
+        else
+        {
+            command.state.r = color[0];
+            command.state.g = color[1];
+            command.state.b = color[2];
+        }
+        return command;
+    }
+
+    // The part of the target that can be drawn on, the clip rect if
+    // there is one
+    // @return false if it is empty
+    bool drawableArea(SDL_Rect &bounds) const
+    {
+        bounds.x = 0;
+        bounds.y = 0;
+        bounds.w = width;
+        bounds.h = height;
+        return !clip_enabled || SDL_IntersectRect(&bounds, &clip, &bounds);
+    }
+
+    // Cut a rectangle down to the target and the clip rect
+    // @return false if nothing is left
+    bool clipArea(const SDL_Rect &rect, SDL_Rect &area) const
+    {
+        SDL_Rect bounds;
+        if (!drawableArea(bounds))
+        {
+            return false;
+        }
+        return SDL_IntersectRect(&rect, &bounds, &area) == SDL_TRUE;
+    }
+
+    // Clip a scaled copy that stays on the target to the clip rect the
+    // way SDL_BlitScaled does: the source's edges move by the part of the
+    // destination cut off, divided by the scale, and both are rounded to
+    // whole pixels. The scale is then stepped across the clipped rects.
+    // @return false if nothing is left to draw, which can happen to the
+    //         source before the destination when scaling up
+    bool clipScaled(RasterCommand &command) const
+    {
+        SDL_Rect bounds;
+        drawableArea(bounds);
+        const double scale_w = double(command.dst.w) / command.src.w;
+        const double scale_h = double(command.dst.h) / command.src.h;
+        double src_x0 = command.src.x;
+        double src_y0 = command.src.y;
+        double src_x1 = src_x0 + command.src.w;
+        double src_y1 = src_y0 + command.src.h;
+
+        // Relative to the clip rect, as SDL does it, so the rounding is
+        // the same
+        double dst_x0 = double(command.dst.x) - bounds.x;
+        double dst_y0 = double(command.dst.y) - bounds.y;
+        double dst_x1 = dst_x0 + command.dst.w;
+        double dst_y1 = dst_y0 + command.dst.h;
+        if (dst_x0 < 0)
+        {
+            src_x0 -= dst_x0 / scale_w;
+            dst_x0 = 0;
+        }
+        if (dst_x1 > bounds.w)
+        {
+            src_x1 -= (dst_x1 - bounds.w) / scale_w;
+            dst_x1 = bounds.w;
+        }
+        if (dst_y0 < 0)
+        {
+            src_y0 -= dst_y0 / scale_h;
+            dst_y0 = 0;
+        }
+        if (dst_y1 > bounds.h)
+        {
+            src_y1 -= (dst_y1 - bounds.h) / scale_h;
+            dst_y1 = bounds.h;
+        }
+        dst_x0 += bounds.x;
+        dst_x1 += bounds.x;
+        dst_y0 += bounds.y;
+        dst_y1 += bounds.y;
+
+        command.src.x = int(std::floor(src_x0 + 0.5));
+        command.src.y = int(std::floor(src_y0 + 0.5));
+        command.src.w = int(std::floor(src_x1 + 0.5)) - command.src.x;
+        command.src.h = int(std::floor(src_y1 + 0.5)) - command.src.y;
+        command.dst.x = int(std::floor(dst_x0 + 0.5));
+        command.dst.y = int(std::floor(dst_y0 + 0.5));
+        command.dst.w = int(std::floor(dst_x1 + 0.5)) - command.dst.x;
+        command.dst.h = int(std::floor(dst_y1 + 0.5)) - command.dst.y;
+        command.area = command.dst;
+        return command.src.w > 0 && command.src.h > 0 && command.dst.w > 0 && command.dst.h > 0;
+    }
+
+    // SDL's software renderer does not scale a copy that crosses the
+    // edge of the target onto the target. It scales the source into a
+    // temporary surface the size of the destination, without blending
+    // or color mod, then blits that unscaled with the image's blending
+    // and color mod. This does the same, turning the command into an
+    // unscaled copy from a temporary image. Only the part of the
+    // temporary surface inside the clipped area is ever read, so only
+    // that part is made, sampled as SDL_SoftStretch does.
+    void scaleToTemporary(RasterCommand &command)
+    {
+        if (used_temporaries == temporaries.size())
+        {
+            temporaries.push_back(RasterImage());
+        }
+        RasterImage &scaled = temporaries[used_temporaries++];
+        const RasterImage &image = *command.image;
+        scaled.width = command.area.w;
+        scaled.height = command.area.h;
+        scaled.pixels.resize(size_t(scaled.width) * scaled.height);
+        scaled.r = image.r;
+        scaled.g = image.g;
+        scaled.b = image.b;
+        scaled.a = image.a;
+        scaled.blend = image.blend;
+
+        const Uint32 step_x = (Uint32(command.src.w) << 16) / Uint32(command.dst.w);
+        const Uint32 step_y = (Uint32(command.src.h) << 16) / Uint32(command.dst.h);
+        const int first_x = command.area.x - command.dst.x;
+        const int first_y = command.area.y - command.dst.y;
+        for (int y = 0; y < scaled.height; ++y)
+        {
+            const Uint32 pos_y = step_y / 2 + Uint32(first_y + y) * step_y;
+            const Uint32 *in = &image.pixels[size_t(command.src.y + (pos_y >> 16)) * image.width +
+                command.src.x];
+            Uint32 *out = &scaled.pixels[size_t(y) * scaled.width];
+            Uint32 pos_x = step_x / 2 + Uint32(first_x) * step_x;
+            for (int x = 0; x < scaled.width; ++x, pos_x += step_x)
+            {
+                out[x] = in[pos_x >> 16];
+            }
+        }
+
+        command.image = &scaled;
+        command.src.x = 0;
+        command.src.y = 0;
+        command.src.w = scaled.width;
+        command.src.h = scaled.height;
+        command.dst = command.area;
+        command.scaled = false;
+    }
+
+    static void tileJob(void *context, int tile, int)
+    {
+        static_cast<TiledRasterizer*>(context)->drawTile(tile);
+    }
+
+    void drawTile(int tile)
+    {
+        const std::vector<int> &bin = bins[tile];
+        if (bin.empty())
+        {
+            return;
+        }
+        SDL_Rect tile_rect;
+        tile_rect.x = (tile % tiles_x) * tile_size;
+        tile_rect.y = (tile / tiles_x) * tile_size;
+        tile_rect.w = std::min(tile_size, width - tile_rect.x);
+        tile_rect.h = std::min(tile_size, height - tile_rect.y);
+
+        for (size_t i = 0; i < bin.size(); ++i)
+        {
+            const RasterCommand &command = commands[bin[i]];
+            SDL_Rect area;
+            if (!SDL_IntersectRect(&command.area, &tile_rect, &area))
+            {
+                continue;
+            }
+            if (command.op == RASTER_FILL)
+            {
+                drawFill(command, area);
+            }
+            else
+            {
+                drawCopy(command, area);
+            }
+        }
+    }
+
+    Uint32* row(int y) const
+    {
+        return reinterpret_cast<Uint32*>(reinterpret_cast<Uint8*>(pixels) + size_t(y) * pitch);
+    }
+
+    void drawFill(const RasterCommand &command, const SDL_Rect &area)
+    {
+        const RasterBlendState &state = command.state;
+        for (int y = area.y; y < area.y + area.h; ++y)
+        {
+            Uint32 *out = row(y) + area.x;
+            if (state.blend == SDL_BLENDMODE_NONE)
+            {
+                const Uint32 value = (state.a << 24) | (state.r << 16) | (state.g << 8) | state.b;
+                std::fill(out, out + area.w, value);
+                continue;
+            }
+            for (int x = 0; x < area.w; ++x)
+            {
+                out[x] = blendFillPixel(out[x], state.r, state.g, state.b, state.a, state.blend);
+            }
+        }
+    }
+
+    void drawCopy(const RasterCommand &command, const SDL_Rect &area)
+    {
+        const RasterImage &image = *command.image;
+        const RasterBlendState &state = command.state;
+        const bool plain = !state.modulate_color && !state.modulate_alpha;
+
+        if (!command.scaled)
+        {
+            const int offset_x = command.src.x - command.dst.x;
+            const int offset_y = command.src.y - command.dst.y;
+            for (int y = area.y; y < area.y + area.h; ++y)
+            {
+                const Uint32 *in = &image.pixels[size_t(y + offset_y) * image.width +
+                    area.x + offset_x];
+                Uint32 *out = row(y) + area.x;
+                if (plain && state.blend == SDL_BLENDMODE_NONE)
+                {
+                    std::memcpy(out, in, size_t(area.w) * 4);
+                }
+                else if (plain && state.blend == SDL_BLENDMODE_BLEND)
+                {
+                    blendRow(in, out, area.w);
+                }
+                else
+                {
+                    for (int x = 0; x < area.w; ++x)
+                    {
+                        out[x] = blendPixelGeneral(in[x], out[x], state);
+                    }
+                }
+            }
+            return;
+        }
+
+        // Nearest neighbour in 16.16 fixed point, starting half a step
+        // in, like SDL's scaled blitters. Steps are measured from the
+        // destination as clipScaled left it, not from the tile, so
+        // splitting into tiles does not shift the image.
+        const Uint32 step_x = (Uint32(command.src.w) << 16) / Uint32(command.dst.w);
+        const Uint32 step_y = (Uint32(command.src.h) << 16) / Uint32(command.dst.h);
+        for (int y = area.y; y < area.y + area.h; ++y)
+        {
+            const Uint32 pos_y = step_y / 2 + Uint32(y - command.dst.y) * step_y;
+            const Uint32 *in = &image.pixels[size_t(command.src.y + (pos_y >> 16)) * image.width +
+                command.src.x];
+            Uint32 *out = row(y) + area.x;
+            Uint32 pos_x = step_x / 2 + Uint32(area.x - command.dst.x) * step_x;
+            for (int x = 0; x < area.w; ++x, pos_x += step_x)
+            {
+                out[x] = blendPixelGeneral(in[pos_x >> 16], out[x], state);
+            }
+        }
+    }
+
+    TiledRasterizer(const TiledRasterizer&) = delete;
+    TiledRasterizer& operator=(const TiledRasterizer&) = delete;
+
+    int width;
+    int height;
+    int tile_size;
+    int tiles_x;
+    int tiles_y;
+    RasterThreadPool pool;
+    std::vector<Uint32> owned;
+    Uint32 *pixels;
+    int pitch;
+
+    Uint8 color[4];
+    SDL_BlendMode blend;
+    SDL_Rect clip;
+    bool clip_enabled;
+
+    std::vector<RasterCommand> commands;
+    std::vector<std::vector<int> > bins;
+
+    // Scaled copies that cross the edge of the target, made by
+    // scaleToTemporary and kept until flush. A deque so queued commands
+    // can point at them while more are added, reused from flush to flush
+    std::deque<RasterImage> temporaries;
+    size_t used_temporaries;
+    TiledRasterStats stats;
+};
+
+#endif
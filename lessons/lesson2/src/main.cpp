@@ -3,6 +3,9 @@
 #include <SDL2/SDL.h>
 #include "res_path.h"
 #include "cleanup.h"
+#include "texture.h"
+#include "render_helpers.h"
+#include "pixel_convert.h"
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
@@ -10,25 +13,15 @@ const int PAUSE_TIME_IN_SECONDS = 10;
 const int MILLISECONDS_IN_SECONDS = 1000;
 const int SDL_RENDERER_FIRST_AVAILABLE_DRIVER = -1;
 
-// Log an SDL error with some error message to the output stream
-// of our choice.
-// @param os The output stream to write the message to
-// @param msg The error message to write, format will be
-// "msg error: SDL_GetError()"
-void logSDLError(std::ostream &os, const std::string &msg)
-{
-    os << msg << SDL_GetError() << std::endl;
-}
-
-// Load texture from file
-SDL_Texture* loadTexture(const std::string &file, SDL_Renderer *ren)
+// Load texture from a BMP file
+Texture loadBmpTexture(const std::string &file, SDL_Renderer *ren)
 {
     SDL_Texture *texture = nullptr;
     SDL_Surface *loaded_image = SDL_LoadBMP(file.c_str());
 
     if (loaded_image != nullptr)
     {
-        texture = SDL_CreateTextureFromSurface(ren, loaded_image);
+        texture = createTextureFromSurfaceFast(ren, loaded_image);
         SDL_FreeSurface(loaded_image);
 
         if (texture == nullptr)
@@ -41,21 +34,7 @@ SDL_Texture* loadTexture(const std::string &file, SDL_Renderer *ren)
         logSDLError(std::cout, "LoadBMP");
     }
     
-    return texture;
-}
-
-
-// Render a texture at a position on the screen
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y)
-{
-    // Setup destination rectangle and place it at desired (x,y) location
-    SDL_Rect dst;
-    dst.x = x;
-    dst.y = y;
-
-    // Get texture dimensions
-    SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
-    SDL_RenderCopy(ren, tex, NULL, &dst);
+    return makeTexture(texture);
 }
 
 
@@ -89,18 +68,18 @@ int main(int argc, char **argv)
 
     // Load images
     const std::string resource_path = get_resource_path("lesson2");
-    SDL_Texture *bg_texture = loadTexture(resource_path + "background.bmp", renderer);
-    SDL_Texture *img_texture = loadTexture(resource_path + "image.bmp", renderer);
-    if ( (bg_texture == nullptr) || (img_texture == nullptr) )
+    Texture bg_texture = loadBmpTexture(resource_path + "background.bmp", renderer);
+    Texture img_texture = loadBmpTexture(resource_path + "image.bmp", renderer);
+    if ( (bg_texture.texture == nullptr) || (img_texture.texture == nullptr) )
     {
-        cleanup(bg_texture, img_texture, renderer, window);
+        cleanup(bg_texture.texture, img_texture.texture, renderer, window);
         SDL_Quit();
         return 1;
     }
 
     // Render tiled background to window
-    int bg_width, bg_height;
-    SDL_QueryTexture(bg_texture, NULL, NULL, &bg_width, &bg_height);
+    int bg_width = bg_texture.width;
+    int bg_height = bg_texture.height;
     for (int bg_pos_x = 0; bg_pos_x < SCREEN_WIDTH; bg_pos_x += bg_width)
     {
         for (int bg_pos_y = 0; bg_pos_y < SCREEN_HEIGHT; bg_pos_y += bg_height)
@@ -110,8 +89,8 @@ int main(int argc, char **argv)
     }
 
     // Render image to center of window
-    int img_width, img_height;
-    SDL_QueryTexture(img_texture, NULL, NULL, &img_width, &img_height);
+    int img_width = img_texture.width;
+    int img_height = img_texture.height;
     int img_pos_x = (SCREEN_WIDTH / 2) - (img_width / 2);
     int img_pos_y = (SCREEN_HEIGHT / 2) - (img_height/ 2);
     renderTexture(img_texture, renderer, img_pos_x, img_pos_y);
@@ -120,7 +99,7 @@ int main(int argc, char **argv)
     SDL_RenderPresent(renderer);
     SDL_Delay(PAUSE_TIME_IN_SECONDS * MILLISECONDS_IN_SECONDS);
 
-    cleanup(bg_texture, img_texture, renderer, window);
+    cleanup(bg_texture.texture, img_texture.texture, renderer, window);
     SDL_Quit();
     return 0;
 }
\ No newline at end of file
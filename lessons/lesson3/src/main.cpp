@@ -1,9 +1,15 @@
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include "res_path.h"
 #include "cleanup.h"
+#include "texture.h"
+#include "render_helpers.h"
+#include "tile_layer.h"
+#include "scene_graph.h"
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
@@ -12,64 +18,6 @@ const int PAUSE_TIME_IN_SECONDS = 10;
 const int MILLISECONDS_IN_SECONDS = 1000;
 const int SDL_RENDERER_FIRST_AVAILABLE_DRIVER = -1;
 
-// Log an SDL error with some error message to the output stream
-// of our choice.
-// @param os The output stream to write the message to
-// @param msg The error message to write, format will be
-// "msg error: SDL_GetError()"
-void logSDLError(std::ostream &os, const std::string &msg)
-{
-    os << msg << SDL_GetError() << std::endl;
-}
-
-// Loads an image into a texture on the rendering device
-// @param file The image file to load
-// @param ren The renderer to load the texture onto
-// @return the loaded texture, or nullptr if something went wrong
-SDL_Texture* loadTexture(const std::string &file, SDL_Renderer *ren)
-{
-    SDL_Texture *texture = IMG_LoadTexture(ren, file.c_str());
-    if (texture == nullptr)
-    {
-        logSDLError(std::cout, "LoadTexture");
-    }
-    return texture;
-}
-
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, with some desired
-// width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-// @param w The width of the texture to draw
-// @param h The height of the texture to draw
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y, int w, int h){
-	//Setup the destination rectangle to be at the position we want
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-	dst.w = w;
-	dst.h = h;
-	SDL_RenderCopy(ren, tex, NULL, &dst);
-}
-
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
-// the texture's width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y)
-{
-    int w, h;
-    SDL_QueryTexture(tex, NULL, NULL, &w, &h);
-    renderTexture(tex, ren, x, y, w, h);
-}
-
-
 int main(int argc, char **argv)
 {
     if ( SDL_Init(SDL_INIT_VIDEO) != 0 )
@@ -112,41 +60,51 @@ int main(int argc, char **argv)
 
     // Load images
     const std::string resource_path = get_resource_path("lesson3");
-    SDL_Texture *bg_texture = loadTexture(resource_path + "background.png", renderer);
-    SDL_Texture *img_texture = loadTexture(resource_path + "image.png", renderer);
-    if ( (bg_texture == nullptr) || (img_texture == nullptr) )
+    Texture bg_texture = loadTexture(resource_path + "background.png", renderer);
+    Texture img_texture = loadTexture(resource_path + "image.png", renderer);
+    if ( (bg_texture.texture == nullptr) || (img_texture.texture == nullptr) )
     {
-        cleanup(bg_texture, img_texture, renderer, window);
+        cleanup(bg_texture.texture, img_texture.texture, renderer, window);
         SDL_Quit();
         return 1;
     }
 
-    // Render tiled background to window (tiles are square)
+    // Render tiled background to window (tiles are square).
+    // The tiles never change, so they are baked once into chunk
+    // textures by the tile layer and each frame only draws the
+    // chunks on screen instead of one copy per tile
     int num_tiles_x = SCREEN_WIDTH / TILE_SIZE;
     int num_tiles_y = SCREEN_HEIGHT / TILE_SIZE;
-    for (int i = 0; i < num_tiles_x * num_tiles_y; ++i)
+    std::vector<SDL_Rect> tile_clips(1);
+    tile_clips[0].x = 0;
+    tile_clips[0].y = 0;
+    tile_clips[0].w = bg_texture.width;
+    tile_clips[0].h = bg_texture.height;
+    std::unique_ptr<TileLayer> background(new TileLayer(renderer, bg_texture, tile_clips,
+        num_tiles_x, num_tiles_y, TILE_SIZE));
+    background->fill(0);
+
+    SDL_Rect view = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+    background->draw(view);
+
+    // Render image to center of window. The image is positioned by its
+    // center, and the camera only hands over what is in view
+    SceneGraph scene(SCREEN_WIDTH, SCREEN_HEIGHT);
+    int image = scene.add(img_texture, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2);
+    scene.setPivot(image, 0.5f, 0.5f);
+    Camera camera = {0.0f, 0.0f, SCREEN_WIDTH, SCREEN_HEIGHT};
+    scene.draw(camera, [&](const Texture &tex, const SDL_Rect *, const SDL_Rect &dst)
     {
-        // Calculate tile positions. Tiles drawn left-to-right,
-        // row-by-row. X-coordinate repeats every complete row
-        // (num tiles along width of screen), and the Y-coordinate
-        // increases for each row (every multiple of num_tiles_x)
-        int x = i % num_tiles_x;
-        int y = i / num_tiles_x;
-        renderTexture(bg_texture, renderer, x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE);
-    }
-
-    // Render image to center of window
-    int img_width, img_height;
-    SDL_QueryTexture(img_texture, NULL, NULL, &img_width, &img_height);
-    int img_pos_x = (SCREEN_WIDTH / 2) - (img_width / 2);
-    int img_pos_y = (SCREEN_HEIGHT / 2) - (img_height/ 2);
-    renderTexture(img_texture, renderer, img_pos_x, img_pos_y);
+        renderTexture(tex, renderer, dst.x, dst.y, dst.w, dst.h);
+    });
 
     // Render current contents and pause
     SDL_RenderPresent(renderer);
     SDL_Delay(PAUSE_TIME_IN_SECONDS * MILLISECONDS_IN_SECONDS);
 
-    cleanup(bg_texture, img_texture, renderer, window);
+    // The layer owns textures, so it must go before the renderer does
+    background.reset();
+    cleanup(bg_texture.texture, img_texture.texture, renderer, window);
     SDL_Quit();
     return 0;
 }
\ No newline at end of file
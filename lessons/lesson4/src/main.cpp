@@ -1,9 +1,18 @@
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include "res_path.h"
 #include "cleanup.h"
+#include "handles.h"
+#include "texture.h"
+#include "render_helpers.h"
+#include "game_loop.h"
+#include "retained_scene.h"
+#include "offscreen.h"
+#include "profiler.h"
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
@@ -11,66 +20,10 @@ const int TILE_SIZE = 40;
 const int PAUSE_TIME_IN_SECONDS = 10;
 const int MILLISECONDS_IN_SECONDS = 1000;
 const int SDL_RENDERER_FIRST_AVAILABLE_DRIVER = -1;
+const int MAX_FPS = 60;
+const int OFFSCREEN_BUFFERS = 3;
 const std::string CURRENT_LESSON = "lesson4";
 
-// Log an SDL error with some error message to the output stream
-// of our choice.
-// @param os The output stream to write the message to
-// @param msg The error message to write, format will be
-// "msg error: SDL_GetError()"
-void logSDLError(std::ostream &os, const std::string &msg)
-{
-    os << msg << SDL_GetError() << std::endl;
-}
-
-// Loads an image into a texture on the rendering device
-// @param file The image file to load
-// @param ren The renderer to load the texture onto
-// @return the loaded texture, or nullptr if something went wrong
-SDL_Texture* loadTexture(const std::string &file, SDL_Renderer *ren)
-{
-    SDL_Texture *texture = IMG_LoadTexture(ren, file.c_str());
-    if (texture == nullptr)
-    {
-        logSDLError(std::cout, "LoadTexture");
-    }
-    return texture;
-}
-
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, with some desired
-// width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-// @param w The width of the texture to draw
-// @param h The height of the texture to draw
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y, int w, int h){
-	//Setup the destination rectangle to be at the position we want
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-	dst.w = w;
-	dst.h = h;
-	SDL_RenderCopy(ren, tex, NULL, &dst);
-}
-
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
-// the texture's width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y)
-{
-    int w, h;
-    SDL_QueryTexture(tex, NULL, NULL, &w, &h);
-    renderTexture(tex, ren, x, y, w, h);
-}
-
-
 bool setupSDL(SDL_Window *window, SDL_Renderer *renderer)
 {
 
@@ -80,83 +33,257 @@ bool setupSDL(SDL_Window *window, SDL_Renderer *renderer)
 
 int main(int argc, char **argv)
 {
+    // Subsystems stay up until their guards go out of scope at the end
+    // of main, after every handle declared below them has been freed
+    SDLInitGuard sdl_init(SDL_INIT_VIDEO);
+    if (!sdl_init.good())
+    {
+        logSDLError(std::cout, "SDL_Init");
+        return 1;
+    }
 
     // Init SDL_image to avoid delay on first image load.
-    // IMG_Init returns the currently initialized image loaders.
-    // A logical AND with the image loader flag we are checking
-    // allows us to verify the image loader was successfully 
-    // initialized
-    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG )
+    // IMG_Init returns the currently initialized image loaders,
+    // the guard checks the loader we asked for is one of them
+    ImageInitGuard img_init(IMG_INIT_PNG);
+    if (!img_init.good())
     {
         logSDLError(std::cout, "IMG_Init");
-        return false;
+        return 1;
     }
 
-    SDL_Window *window = SDL_CreateWindow("Lesson3 - SDL_IMG", 
-        100, 
-        100, 
-        SCREEN_WIDTH, 
-        SCREEN_HEIGHT, 
-        SDL_WINDOW_SHOWN);
-    if (window == nullptr)
+    // Pass --frames N to run N frames as fast as possible, --offscreen
+    // to render into memory instead of a window, --record FILE to save
+    // the run and --replay FILE to play a saved one back
+    GameLoopConfig loop_config;
+    loop_config.max_fps = MAX_FPS;
+    parseLoopArgs(argc, argv, loop_config);
+
+    // Offscreen there is no window, frames are drawn into buffers that a
+    // consumer thread reads in place, the way an encoder would
+    std::unique_ptr<OffscreenTarget> offscreen;
+    UniqueWindow window;
+    UniqueRenderer renderer;
+    SDL_Renderer *ren = nullptr;
+    if (loop_config.offscreen)
     {
-        logSDLError(std::cout, "SDL_CreateWindow Error");
-        SDL_Quit();
-        return false;
+        offscreen.reset(new OffscreenTarget(SCREEN_WIDTH, SCREEN_HEIGHT, OFFSCREEN_BUFFERS));
+        if (!offscreen->good())
+        {
+            return 1;
+        }
+        ren = offscreen->getRenderer();
     }
+    else
+    {
+        window.reset(SDL_CreateWindow("Lesson3 - SDL_IMG", 
+            100, 
+            100, 
+            SCREEN_WIDTH, 
+            SCREEN_HEIGHT, 
+            SDL_WINDOW_SHOWN));
+        if (!window)
+        {
+            logSDLError(std::cout, "SDL_CreateWindow Error");
+            return 1;
+        }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window,
-        SDL_RENDERER_FIRST_AVAILABLE_DRIVER,
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-
+        renderer.reset(SDL_CreateRenderer(window.get(),
+            SDL_RENDERER_FIRST_AVAILABLE_DRIVER,
+            SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+        if (!renderer)
+        {
+            logSDLError(std::cout, "SDL_CreateRenderer Error");
+            return 1;
+        }
+        ren = renderer.get();
+    }
 
     // Load image
     const std::string resource_path = get_resource_path(CURRENT_LESSON);
-    SDL_Texture *tex_img = loadTexture(resource_path + "image.png", renderer);
-    if ( tex_img == nullptr )
+    Texture tex_img = loadTexture(resource_path + "image.png", ren);
+    // tex_img is what gets passed around for drawing, the handle
+    // owns the texture and frees it when main returns
+    UniqueTexture tex_img_owner(tex_img.texture);
+    if ( tex_img.texture == nullptr )
     {
-        cleanup(tex_img, renderer, window);
-        SDL_Quit();
         return 1;
     }
 
     // Calculate position for center of screen
-    int img_width, img_height;
-    SDL_QueryTexture(tex_img, NULL, NULL, &img_width, &img_height);
+    int img_width = tex_img.width;
+    int img_height = tex_img.height;
     int img_pos_x = (SCREEN_WIDTH / 2) - (img_width / 2);
     int img_pos_y = (SCREEN_HEIGHT / 2) - (img_height/ 2);
 
-    // Setup main loop
-    SDL_Event event;
-    bool quit = false;
-    while(!quit)
+    // The scene only changes when the window needs repainting, so it
+    // is kept between frames and only drawn when something is damaged
+    RetainedScene scene(ren, SCREEN_WIDTH, SCREEN_HEIGHT);
+    scene.add(tex_img, img_pos_x, img_pos_y);
+
+    // Each offscreen frame lands in a different buffer, so every frame
+    // is drawn in full
+    if (offscreen)
+    {
+        scene.setPartialRepaint(false);
+    }
+
+    // A replay is rerun frame by frame from its log, and the rerun is
+    // recorded too, with a hash of every frame, to compare against it
+    const bool replaying = !loop_config.replay_file.empty();
+    const bool recording = replaying || !loop_config.record_file.empty();
+    ReplayLog played;
+    ReplayLog run(SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (replaying && !played.load(loop_config.replay_file))
+    {
+        return 1;
+    }
+    if (recording)
+    {
+        scene.setRecorder(&run);
+    }
+
+    // Stands in for an encoder: hashes every frame straight out of the
+    // buffer it was drawn into. Replays hash each frame as it is done
+    // instead, so the hash lands in the right frame of the log
+    Uint32 frame_hash = 0;
+    long frames_read = 0;
+    double read_seconds = 0.0;
+    std::thread consumer;
+    if (offscreen && !replaying)
     {
-        // Read user input
-        while(SDL_PollEvent(&event))
+        consumer = std::thread([&]()
         {
-            if (event.type == SDL_QUIT)
+            OffscreenFrame frame;
+            Uint64 first = 0;
+            Uint64 last = 0;
+            while (offscreen->acquireFrame(frame))
             {
-                quit = true;
+                const Uint32 hash = hashPixels(frame.pixels, frame.pitch,
+                    frame.width, frame.height);
+                offscreen->releaseFrame(frame);
+                frame_hash = hash;
+                last = SDL_GetPerformanceCounter();
+                if (first == 0)
+                {
+                    first = last;
+                }
+                ++frames_read;
             }
+            read_seconds = double(last - first) / SDL_GetPerformanceFrequency();
+        });
+    }
 
-            if (event.type == SDL_KEYDOWN)
-            {
-                quit = true;
-            }
+    // Setup main loop. Input is handled as it arrives and the scene is
+    // redrawn at most MAX_FPS times a second
+    GameLoop loop(loop_config);
+    if (recording)
+    {
+        loop.setRecorder(&run);
+    }
+    if (replaying)
+    {
+        loop.setPlayback(&played);
+    }
+
+    // Read user input
+    loop.onEvent([&](const SDL_Event &event)
+    {
+        scene.handleEvent(event);
+
+        if (event.type == SDL_QUIT)
+        {
+            loop.quit();
+        }
+
+        if (event.type == SDL_KEYDOWN)
+        {
+            loop.quit();
+        }
 
-            if (event.type == SDL_MOUSEBUTTONDOWN)
+        if (event.type == SDL_MOUSEBUTTONDOWN)
+        {
+            loop.quit();
+        }
+    });
+
+    // Render scene, skipping the frame when nothing changed. Offscreen
+    // every frame is produced
+    loop.onRender([&](double)
+    {
+        if (offscreen)
+        {
+            offscreen->beginFrame();
+            scene.invalidate();
+        }
+        bool drawn = false;
+        {
+            PROFILE_ZONE("draw");
+            drawn = scene.render();
+        }
+        if (offscreen)
+        {
+            PROFILE_ZONE("present");
+            offscreen->endFrame();
+            OffscreenFrame frame;
+            if (replaying && offscreen->acquireFrame(frame, 0))
             {
-                quit = true;
+                run.recordHash(hashPixels(frame.pixels, frame.pitch, frame.width, frame.height));
+                offscreen->releaseFrame(frame);
             }
         }
+        else if (drawn)
+        {
+            PROFILE_ZONE("present");
+            SDL_RenderPresent(ren);
+        }
+    });
+
+    // Sleep until the next event while there is nothing to redraw. The
+    // loop never idles offscreen, every frame goes to the consumer
+    loop.onIdle([&]()
+    {
+        return !scene.isDirty();
+    });
 
-        // Render scene
-        SDL_RenderClear(renderer);
-        renderTexture(tex_img, renderer, img_pos_x, img_pos_y);
-        SDL_RenderPresent(renderer);
+    loop.run();
+    if (consumer.joinable())
+    {
+        offscreen->close();
+        consumer.join();
+        std::cout << CURRENT_LESSON << " offscreen frames=" << offscreen->getProduced()
+                  << " render_fps=" << offscreen->getFps()
+                  << " read=" << frames_read
+                  << " read_fps=" << (read_seconds > 0.0 ? (frames_read - 1) / read_seconds : 0.0)
+                  << " hash=" << std::hex << frame_hash << std::dec << std::endl;
+    }
+    // A replay that no longer draws what the reference drew fails the
+    // run, after the rerun is saved so it can be looked at
+    long differing = 0;
+    if (replaying)
+    {
+        run.reportTimings(std::cout, CURRENT_LESSON + "_replay");
+        differing = run.compare(played, std::cerr);
+        std::cerr << CURRENT_LESSON << " replay differing_frames=" << differing
+                  << " hash=" << std::hex << run.getRunHash() << std::dec << std::endl;
+    }
+    if (!loop_config.record_file.empty() && !run.save(loop_config.record_file))
+    {
+        return 1;
+    }
+    if (differing > 0)
+    {
+        return 1;
+    }
+    if (loop_config.headless_frames > 0)
+    {
+        std::cout << CURRENT_LESSON << " frames=" << loop.getFrames()
+                  << " seconds=" << loop.getSeconds()
+                  << " fps=" << loop.getFps()
+                  << " redraws=" << scene.getRedraws() << std::endl;
     }
 
-    cleanup(tex_img, renderer, window);
-    SDL_Quit();
+    PROFILE_REPORT(std::cout);
+    PROFILE_WRITE_TRACE("lesson4_trace.json");
     return 0;
 }
\ No newline at end of file
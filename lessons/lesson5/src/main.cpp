@@ -1,232 +1,317 @@
 #include <iostream>
+#include <memory>
 #include <string>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include "res_path.h"
 #include "cleanup.h"
+#include "handles.h"
+#include "texture.h"
+#include "render_helpers.h"
+#include "game_loop.h"
+#include "input.h"
+#include "animation.h"
+#include "retained_scene.h"
+#include "offscreen.h"
+#include "replay.h"
+#include "profiler.h"
 
-const int clipWidth = 100;
-const int clipHeight = 100;
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 const int TILE_SIZE = 40;
 const int PAUSE_TIME_IN_SECONDS = 10;
 const int MILLISECONDS_IN_SECONDS = 1000;
 const int SDL_RENDERER_FIRST_AVAILABLE_DRIVER = -1;
+const int MAX_FPS = 60;
+const int OFFSCREEN_BUFFERS = 2;
 const std::string CURRENT_LESSON = "lesson5";
 
-// Log an SDL error with some error message to the output stream
-// of our choice.
-// @param os The output stream to write the message to
-// @param msg The error message to write, format will be
-// "msg error: SDL_GetError()"
-void logSDLError(std::ostream &os, const std::string &msg)
+bool setupSDL(SDL_Window *window, SDL_Renderer *renderer)
 {
-    os << msg << SDL_GetError() << std::endl;
+
+
+    return true;
 }
 
-// Loads an image into a texture on the rendering device
-// @param file The image file to load
-// @param ren The renderer to load the texture onto
-// @return the loaded texture, or nullptr if something went wrong
-SDL_Texture* loadTexture(const std::string &file, SDL_Renderer *ren)
+int main(int argc, char **argv)
 {
-    SDL_Texture *texture = IMG_LoadTexture(ren, file.c_str());
-    if (texture == nullptr)
+    // Subsystems stay up until their guards go out of scope at the end
+    // of main, after every handle declared below them has been freed
+    SDLInitGuard sdl_init(SDL_INIT_VIDEO);
+    if (!sdl_init.good())
     {
-        logSDLError(std::cout, "LoadTexture");
+        logSDLError(std::cout, "SDL_Init");
+        return 1;
     }
-    return texture;
-}
-
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, with some desired
-// width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-// @param w The width of the texture to draw
-// @param h The height of the texture to draw
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y, int w, int h){
-	//Setup the destination rectangle to be at the position we want
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-	dst.w = w;
-	dst.h = h;
-	SDL_RenderCopy(ren, tex, NULL, &dst);
-}
 
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
-// the texture's width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param dst The destination rectangle to render th texture to
-// @param clip The sub-section of the texture to draw (clipping rect)
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, SDL_Rect dst, SDL_Rect *clip = nullptr)
-{
-	SDL_RenderCopy(ren, tex, clip, &dst);
-}
+    // Init SDL_image to avoid delay on first image load.
+    // IMG_Init returns the currently initialized image loaders,
+    // the guard checks the loader we asked for is one of them
+    ImageInitGuard img_init(IMG_INIT_PNG);
+    if (!img_init.good())
+    {
+        logSDLError(std::cout, "IMG_Init");
+        return 1;
+    }
 
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
-// the texture's width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y)
-{
-    int w, h;
-    SDL_QueryTexture(tex, NULL, NULL, &w, &h);
-    renderTexture(tex, ren, x, y, w, h);
-}
+    // Pass --frames N to run N frames as fast as possible, --offscreen
+    // to render into memory instead of a window, --record FILE to save
+    // the run and --replay FILE to play a saved one back
+    GameLoopConfig loop_config;
+    loop_config.max_fps = MAX_FPS;
+    parseLoopArgs(argc, argv, loop_config);
 
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
-// the texture's width and height and taking a clip of the texture if
-// if a clip rectangle is passed. If a clip is present, the clip's width
-// and height will be used in place of the texture's dimensions
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-// @param clip The sub-section of the texture to draw (clipping rect)
-//             default of nullptr draws the entire texture
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y, SDL_Rect *clip = nullptr)
-{
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-    if (clip != nullptr)
+    // Offscreen there is no window, each frame is hashed in place once
+    // it is drawn
+    std::unique_ptr<OffscreenTarget> offscreen;
+    UniqueWindow window;
+    UniqueRenderer renderer;
+    SDL_Renderer *ren = nullptr;
+    if (loop_config.offscreen)
     {
-        dst.w = clip->w;
-        dst.h = clip->h;
+        offscreen.reset(new OffscreenTarget(SCREEN_WIDTH, SCREEN_HEIGHT, OFFSCREEN_BUFFERS));
+        if (!offscreen->good())
+        {
+            return 1;
+        }
+        ren = offscreen->getRenderer();
     }
     else
     {
-        SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
+        window.reset(SDL_CreateWindow("Lesson5 - Sprite Sheets", 
+            100, 
+            100, 
+            SCREEN_WIDTH, 
+            SCREEN_HEIGHT, 
+            SDL_WINDOW_SHOWN));
+        if (!window)
+        {
+            logSDLError(std::cout, "SDL_CreateWindow Error");
+            return 1;
+        }
+
+        renderer.reset(SDL_CreateRenderer(window.get(),
+            SDL_RENDERER_FIRST_AVAILABLE_DRIVER,
+            SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+        if (!renderer)
+        {
+            logSDLError(std::cout, "SDL_CreateRenderer Error");
+            return 1;
+        }
+        ren = renderer.get();
     }
 
-    renderTexture(tex, ren, dst, clip);    
-}
+    // Load image
+    const std::string resource_path = get_resource_path(CURRENT_LESSON);
+    Texture tex_img = loadTexture(resource_path + "image.png", ren);
+    // tex_img is what gets passed around for drawing, the handle
+    // owns the texture and frees it when main returns
+    UniqueTexture tex_img_owner(tex_img.texture);
+    if ( tex_img.texture == nullptr )
+    {
+        return 1;
+    }
 
+    // The sheet layout and its clips come from image.anim, keys 1-4
+    // show a single frame like before and 5 plays them in a loop
+    AnimationLibrary animations;
+    if (!animations.load(resource_path + "image.anim"))
+    {
+        return 1;
+    }
+    const int clip_ids[] = {
+        animations.findClip("1"),
+        animations.findClip("2"),
+        animations.findClip("3"),
+        animations.findClip("4"),
+        animations.findClip("cycle")
+    };
+    for (int i = 0; i < 5; ++i)
+    {
+        if (clip_ids[i] < 0)
+        {
+            std::cout << "image.anim is missing a clip" << std::endl;
+            return 1;
+        }
+    }
 
-bool setupSDL(SDL_Window *window, SDL_Renderer *renderer)
-{
+    // Calculate position for center of screen.
+    // Image is clipped to size, so make sure to use the clip size
+    // when calculating the center position for the image on screen
+    const SDL_Rect &first_frame = animations.frame(0);
+    int img_pos_x = (SCREEN_WIDTH / 2) - (first_frame.w / 2);
+    int img_pos_y = (SCREEN_HEIGHT / 2) - (first_frame.h / 2);
 
+    // Specify a default clip to start with
+    AnimationSystem sprites(animations);
+    const int sprite = sprites.add(clip_ids[0], float(img_pos_x), float(img_pos_y));
 
-    return true;
-}
+    // Only the sprite changes, and only when its frame does, so the
+    // scene is kept between frames and redrawn when it is damaged
+    RetainedScene scene(ren, SCREEN_WIDTH, SCREEN_HEIGHT);
+    const int sprite_node = scene.add(tex_img, img_pos_x, img_pos_y, &sprites.clipOf(sprite));
 
-int main(int argc, char **argv)
-{
-    // Init SDL_image to avoid delay on first image load.
-    // IMG_Init returns the currently initialized image loaders.
-    // A logical AND with the image loader flag we are checking
-    // allows us to verify the image loader was successfully 
-    // initialized
-    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG )
+    // Each offscreen frame lands in a different buffer, so every frame
+    // is drawn in full
+    if (offscreen)
     {
-        logSDLError(std::cout, "IMG_Init");
-        return false;
+        scene.setPartialRepaint(false);
     }
 
-    SDL_Window *window = SDL_CreateWindow("Lesson5 - Sprite Sheets", 
-        100, 
-        100, 
-        SCREEN_WIDTH, 
-        SCREEN_HEIGHT, 
-        SDL_WINDOW_SHOWN);
-    if (window == nullptr)
+    // A replay is rerun frame by frame from its log, and the rerun is
+    // recorded too, with a hash of every frame, to compare against it
+    const bool replaying = !loop_config.replay_file.empty();
+    const bool recording = replaying || !loop_config.record_file.empty();
+    ReplayLog played;
+    ReplayLog run(SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (replaying && !played.load(loop_config.replay_file))
     {
-        logSDLError(std::cout, "SDL_CreateWindow Error");
-        SDL_Quit();
-        return false;
+        return 1;
+    }
+    if (recording)
+    {
+        scene.setRecorder(&run);
     }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window,
-        SDL_RENDERER_FIRST_AVAILABLE_DRIVER,
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-
+    // Setup main loop. Input is handled as it arrives and the scene is
+    // redrawn at most MAX_FPS times a second
+    GameLoop loop(loop_config);
+    if (recording)
+    {
+        loop.setRecorder(&run);
+    }
+    if (replaying)
+    {
+        loop.setPlayback(&played);
+    }
 
-    // Load image
-    const std::string resource_path = get_resource_path(CURRENT_LESSON);
-    SDL_Texture *tex_img = loadTexture(resource_path + "image.png", renderer);
-    if ( tex_img == nullptr )
+    // Keys are bound to named actions rather than switched on, and the
+    // bindings could be changed at runtime, eg. from an options screen.
+    // Clicking plays the looping clip too
+    InputSystem input;
+    const int quit_action = input.defineAction("quit");
+    const char *clip_actions[] = {"clip1", "clip2", "clip3", "clip4", "cycle"};
+    const SDL_Keycode clip_keys[] = {SDLK_1, SDLK_2, SDLK_3, SDLK_4, SDLK_5};
+    int clip_action_ids[5];
+    for (int i = 0; i < 5; ++i)
     {
-        cleanup(tex_img, renderer, window);
-        SDL_Quit();
-        return 1;
+        clip_action_ids[i] = input.defineAction(clip_actions[i]);
+        input.bindKey(clip_keys[i], clip_action_ids[i]);
     }
+    input.bindMouseButton(SDL_BUTTON_LEFT, clip_action_ids[4]);
+    input.bindKey(SDLK_ESCAPE, quit_action);
+    loop.setInput(&input);
 
-    // Calculate position for center of screen
-    int img_width, img_height;
-    SDL_QueryTexture(tex_img, NULL, NULL, &img_width, &img_height);
+    // Events the actions do not cover
+    loop.onEvent([&](const SDL_Event &event)
+    {
+        scene.handleEvent(event);
 
-    // Image is clipped to size, so make sure to use the clip size
-    // when calculating the center position for the image on screen
-    int img_pos_x = (SCREEN_WIDTH / 2) - (clipWidth / 2);
-    int img_pos_y = (SCREEN_HEIGHT / 2) - (clipHeight/ 2);
+        if (event.type == SDL_QUIT)
+        {
+            loop.quit();
+        }
+    });
 
-    // Setup the clips for our image
-    const int num_sprite_rows = 2;
-    const int num_sprite_cols = 2;
-    SDL_Rect clips[4];
-    for ( int i = 0; i < 4; ++i)
+    // Advance animations at the fixed update rate
+    loop.onUpdate([&](double dt)
     {
-        clips[i].x = (i / num_sprite_cols) * clipWidth;
-        clips[i].y = (i % num_sprite_rows) * clipHeight;
-        clips[i].w = clipWidth;
-        clips[i].h = clipHeight;
-    }
-    // Specify a default clip to start with
-    int useClip =  0;
+        sprites.update(float(dt));
+        scene.setClip(sprite_node, sprites.clipOf(sprite));
+    });
+
+    Uint32 frame_hash = 0;
 
-    // Setup main loop
-    SDL_Event event;
-    bool quit = false;
-    while(!quit)
+    // Render scene, skipping the frame when the sprite did not change.
+    // Offscreen every frame is produced.
+    // Looping clips change by themselves, so the loop keeps ticking
+    // rather than waiting for events
+    loop.onRender([&](double)
     {
-        // Read user input
-        while(SDL_PollEvent(&event))
+        // Act on this frame's input before drawing
+        if (input.wasPressed(quit_action))
         {
-            if (event.type == SDL_QUIT)
+            loop.quit();
+        }
+        for (int i = 0; i < 5; ++i)
+        {
+            if (input.wasPressed(clip_action_ids[i]))
             {
-                quit = true;
+                sprites.play(sprite, clip_ids[i]);
+                scene.setClip(sprite_node, sprites.clipOf(sprite));
             }
+        }
 
-            if (event.type == SDL_KEYDOWN)
+        if (offscreen)
+        {
+            offscreen->beginFrame();
+            scene.invalidate();
+        }
+        bool drawn = false;
+        {
+            PROFILE_ZONE("draw");
+            drawn = scene.render();
+        }
+        if (offscreen)
+        {
+            PROFILE_ZONE("present");
+            offscreen->endFrame();
+            OffscreenFrame frame;
+            if (offscreen->acquireFrame(frame, 0))
             {
-                switch (event.key.keysym.sym)
-                {
-                    case SDLK_1:
-                        useClip = 0;
-                        break;
-                    case SDLK_2:
-                        useClip = 1;
-                        break;
-                    case SDLK_3:
-                        useClip = 2;
-                        break;
-                    case SDLK_4:
-                        useClip = 3;
-                        break;
-                    case SDLK_ESCAPE:
-                        quit = true;
-                        break;
-                    default:
-                        break;
-                }
+                frame_hash = hashPixels(frame.pixels, frame.pitch, frame.width, frame.height);
+                run.recordHash(frame_hash);
+                offscreen->releaseFrame(frame);
             }
         }
+        else if (drawn)
+        {
+            PROFILE_ZONE("present");
+            SDL_RenderPresent(ren);
+        }
+    });
 
-        // Render scene
-        SDL_RenderClear(renderer);
-        renderTexture(tex_img, renderer, img_pos_x, img_pos_y, &clips[useClip]);
-        SDL_RenderPresent(renderer);
+    loop.run();
+    if (offscreen)
+    {
+        std::cout << CURRENT_LESSON << " offscreen frames=" << offscreen->getProduced()
+                  << " render_fps=" << offscreen->getFps()
+                  << " hash=" << std::hex << frame_hash << std::dec << std::endl;
+    }
+    // A replay that no longer draws what the reference drew fails the
+    // run, after the rerun is saved so it can be looked at
+    long differing = 0;
+    if (replaying)
+    {
+        run.reportTimings(std::cout, CURRENT_LESSON + "_replay");
+        differing = run.compare(played, std::cerr);
+        std::cerr << CURRENT_LESSON << " replay differing_frames=" << differing
+                  << " hash=" << std::hex << run.getRunHash() << std::dec << std::endl;
+    }
+    if (!loop_config.record_file.empty() && !run.save(loop_config.record_file))
+    {
+        return 1;
+    }
+    if (differing > 0)
+    {
+        return 1;
+    }
+    if (loop_config.headless_frames > 0)
+    {
+        std::cout << CURRENT_LESSON << " frames=" << loop.getFrames()
+                  << " seconds=" << loop.getSeconds()
+                  << " fps=" << loop.getFps()
+                  << " redraws=" << scene.getRedraws() << std::endl;
+    }
+    if (input.getLatencySamples() > 0)
+    {
+        std::cout << "input latency_ms mean=" << input.getMeanLatency()
+                  << " p99=" << input.getLatencyPercentile(0.99)
+                  << " max=" << input.getMaxLatency()
+                  << " samples=" << input.getLatencySamples() << std::endl;
     }
 
-    cleanup(tex_img, renderer, window);
-    SDL_Quit();
+    PROFILE_REPORT(std::cout);
+    PROFILE_WRITE_TRACE("lesson5_trace.json");
     return 0;
 }
\ No newline at end of file
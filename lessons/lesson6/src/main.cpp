@@ -1,10 +1,21 @@
 #include <iostream>
+#include <memory>
 #include <string>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include "res_path.h"
 #include "cleanup.h"
+#include "handles.h"
+#include "texture.h"
+#include "render_helpers.h"
+#include "pixel_convert.h"
+#include "game_loop.h"
+#include "profiler_overlay.h"
+#include "glyph_atlas.h"
+#include "retained_scene.h"
+#include "text_object.h"
+#include "texture_pool.h"
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
@@ -12,240 +23,228 @@ const int TILE_SIZE = 40;
 const int PAUSE_TIME_IN_SECONDS = 10;
 const int MILLISECONDS_IN_SECONDS = 1000;
 const int SDL_RENDERER_FIRST_AVAILABLE_DRIVER = -1;
+const int MAX_FPS = 60;
 const std::string CURRENT_LESSON = "lesson6";
 const std::string WINDOW_TITLE = "Lesson 6 - Fonts";
 
-// Log an SDL error with some error message to the output stream
-// of our choice.
-// @param os The output stream to write the message to
-// @param msg The error message to write, format will be
-// "msg error: SDL_GetError()"
-void logSDLError(std::ostream &os, const std::string &msg)
-{
-    os << msg << SDL_GetError() << std::endl;
-}
-
-// Loads an image into a texture on the rendering device
-// @param file The image file to load
-// @param ren The renderer to load the texture onto
-// @return the loaded texture, or nullptr if something went wrong
-SDL_Texture* loadTexture(const std::string &file, SDL_Renderer *ren)
-{
-    SDL_Texture *texture = IMG_LoadTexture(ren, file.c_str());
-    if (texture == nullptr)
-    {
-        logSDLError(std::cout, "LoadTexture");
-    }
-    return texture;
-}
-
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, with some desired
-// width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-// @param w The width of the texture to draw
-// @param h The height of the texture to draw
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y, int w, int h){
-	//Setup the destination rectangle to be at the position we want
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-	dst.w = w;
-	dst.h = h;
-	SDL_RenderCopy(ren, tex, NULL, &dst);
-}
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
-// the texture's width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param dst The destination rectangle to render th texture to
-// @param clip The sub-section of the texture to draw (clipping rect)
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, SDL_Rect dst, SDL_Rect *clip = nullptr)
-{
-	SDL_RenderCopy(ren, tex, clip, &dst);
-}
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
-// the texture's width and height
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-// void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y)
-// {
-//     int w, h;
-//     SDL_QueryTexture(tex, NULL, NULL, &w, &h);
-//     renderTexture(tex, ren, x, y, w, h);
-// }
-
-// Draw an SDL_Texture to an SDL_Renderer at position x, y, preserving
-// the texture's width and height and taking a clip of the texture if
-// if a clip rectangle is passed. If a clip is present, the clip's width
-// and height will be used in place of the texture's dimensions
-// @param tex The source texture we want to draw
-// @param ren The renderer we want to draw to
-// @param x The x coordinate to draw to
-// @param y The y coordinate to draw to
-// @param clip The sub-section of the texture to draw (clipping rect)
-//             default of nullptr draws the entire texture
-void renderTexture(SDL_Texture *tex, SDL_Renderer *ren, int x, int y, SDL_Rect *clip = nullptr)
-{
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-    if (clip != nullptr)
-    {
-        dst.w = clip->w;
-        dst.h = clip->h;
-    }
-    else
-    {
-        SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
-    }
-
-    renderTexture(tex, ren, dst, clip);    
-}
-
 // Render the message we want to display to a texture for drawing
 // @param message The message we want to display
 // @param fontFile The font we want to use to render the text
 // @param color The color we want the text to be
 // @param fontSize The size we want the font to be
+// @param pool The pool to take the texture from
 // @param renderer The renderer to load the texture in
-// @return An SDL_Texture containing the rendered message, or nullptr if something went wrong
-SDL_Texture* renderText(const std::string &message, const std::string &fontFile,
-	SDL_Color color, int fontSize, SDL_Renderer *renderer)
+// @return A texture containing the rendered message, its texture member is nullptr
+//         if something went wrong. The texture comes from the pool and may be
+//         bigger than the text, draw it with a clip of the texture's width and height
+Texture renderText(const std::string &message, const std::string &fontFile,
+	SDL_Color color, int fontSize, TexturePool &pool, SDL_Renderer *renderer)
 {
 	// Open the font
-	TTF_Font *font = TTF_OpenFont(fontFile.c_str(), fontSize);
-	if (font == nullptr)
+	UniqueFont font(TTF_OpenFont(fontFile.c_str(), fontSize));
+	if (!font)
     {
 		logSDLError(std::cout, "TTF_OpenFont");
-		return nullptr;
+		return makeTexture(nullptr);
 	}
 
 	// We need to first render to a surface as that's what TTF_RenderText
 	// returns, then load that surface into a texture
-	SDL_Surface *surf = TTF_RenderText_Blended(font, message.c_str(), color);
-	if (surf == nullptr)
+	UniqueSurface surf(TTF_RenderText_Blended(font.get(), message.c_str(), color));
+	if (!surf)
     {
-		TTF_CloseFont(font);
 		logSDLError(std::cout, "TTF_RenderText");
-		return nullptr;
+		return makeTexture(nullptr);
 	}
 
-	SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surf);
-	if (texture == nullptr)
+	Texture texture = createPooledTexture(pool, renderer, surf.get());
+	if (texture.texture == nullptr)
     {
 		logSDLError(std::cout, "CreateTexture");
 	}
 
-	// Clean up the surface and font
-	SDL_FreeSurface(surf);
-	TTF_CloseFont(font);
+	// The surface and font are freed as their handles go out of scope
 	return texture;
 }
 
 int main(int argc, char **argv)
 {
+    // Subsystems stay up until their guards go out of scope at the end
+    // of main, after every handle declared below them has been freed
+    SDLInitGuard sdl_init(SDL_INIT_VIDEO);
+    if (!sdl_init.good())
+    {
+        logSDLError(std::cout, "SDL_Init");
+        return 1;
+    }
+
     // Init SDL_image to avoid delay on first image load.
-    // IMG_Init returns the currently initialized image loaders.
-    // A logical AND with the image loader flag we are checking
-    // allows us to verify the image loader was successfully 
-    // initialized
-    if ( (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG )
+    // IMG_Init returns the currently initialized image loaders,
+    // the guard checks the loader we asked for is one of them
+    ImageInitGuard img_init(IMG_INIT_PNG);
+    if (!img_init.good())
     {
         logSDLError(std::cout, "IMG_Init");
-        return false;
+        return 1;
     }
 
-    if (TTF_Init() != 0)
+    TTFInitGuard ttf_init;
+    if (!ttf_init.good())
     {
         logSDLError(std::cout, "TTF_Init");
-        SDL_Quit();
         return 1;
     }
 
-    SDL_Window *window = SDL_CreateWindow(WINDOW_TITLE.c_str(), 
+    UniqueWindow window(SDL_CreateWindow(WINDOW_TITLE.c_str(), 
         100, 
         100, 
         SCREEN_WIDTH, 
         SCREEN_HEIGHT, 
-        SDL_WINDOW_SHOWN);
-    if (window == nullptr)
+        SDL_WINDOW_SHOWN));
+    if (!window)
     {
         logSDLError(std::cout, "SDL_CreateWindow Error");
-        SDL_Quit();
-        return false;
+        return 1;
     }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window,
+    UniqueRenderer renderer(SDL_CreateRenderer(window.get(),
         SDL_RENDERER_FIRST_AVAILABLE_DRIVER,
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-
+        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+    if (!renderer)
+    {
+        logSDLError(std::cout, "SDL_CreateRenderer Error");
+        return 1;
+    }
 
     // Load text
     const std::string resource_path = get_resource_path(CURRENT_LESSON);
     SDL_Color color = {255, 255, 255, 255};
-    SDL_Texture *tex_img = renderText("TTF fonts are cool!",
+
+    // Text textures come from the pool and go back to it when their
+    // PooledTexture handle goes out of scope. The pool is declared after
+    // the renderer so it is destroyed first, and before the handles so
+    // they are all back by then
+    TexturePool texture_pool(renderer.get());
+    Texture tex_img = renderText("TTF fonts are cool!",
         resource_path + "sample.ttf",
         color,
         64,
-        renderer);
-    if ( tex_img == nullptr )
+        texture_pool,
+        renderer.get());
+    PooledTexture text_texture(tex_img.texture, PoolDeleter(&texture_pool));
+    if ( tex_img.texture == nullptr )
     {
-        cleanup(renderer, window);
-        TTF_Quit();
-        SDL_Quit();
         return 1;
     }
+    SDL_Rect text_clip = {0, 0, tex_img.width, tex_img.height};
 
     // Calculate position for center of screen
-    int img_width, img_height;
-    SDL_QueryTexture(tex_img, NULL, NULL, &img_width, &img_height);
+    int img_width = tex_img.width;
+    int img_height = tex_img.height;
 
     // Image is clipped to size, so make sure to use the clip size
     // when calculating the center position for the image on screen
     int img_pos_x = (SCREEN_WIDTH / 2) - (img_width / 2);
     int img_pos_y = (SCREEN_HEIGHT / 2) - (img_height/ 2);
 
-    // Setup main loop
-    SDL_Event event;
-    bool quit = false;
-    while(!quit)
+    // Text that changes every frame goes through the glyph atlas
+    // instead of renderText, so the font is only opened once and
+    // each glyph is only rasterized the first time it is seen.
+    // The engine owns textures and fonts, declaring it after the renderer
+    // and the TTF guard makes sure it goes before both of them
+    TextEngine text_engine(renderer.get());
+    const std::string font_file = resource_path + "sample.ttf";
+
+    // Everything on screen is static, so the scene is kept between
+    // frames and only drawn again when the window needs repainting.
+    // The counter shows how many times that has happened
+    RetainedScene scene(renderer.get(), SCREEN_WIDTH, SCREEN_HEIGHT);
+    scene.add(tex_img, img_pos_x, img_pos_y, &text_clip);
+    SDL_Rect counter_bounds = {10, 10, 0, 0};
+    text_engine.sizeText("Redraws: 0000000", font_file, 16,
+        &counter_bounds.w, &counter_bounds.h);
+    // The counter keeps its own texture and only redraws the digits
+    // that changed, instead of laying out and drawing the whole string
+    TextObject counter(text_engine, font_file, 16, color);
+    scene.addCustom(counter_bounds, [&](const SDL_Rect &bounds)
+    {
+        counter.setText("Redraws: " + std::to_string(scene.getRedraws() + 1));
+        counter.draw(bounds.x, bounds.y);
+    });
+#ifdef ENABLE_PROFILER
+    // The overlay changes every frame, so it is redrawn every frame
+    SDL_Rect overlay_bounds = {10, 30, SCREEN_WIDTH - 20, SCREEN_HEIGHT - 40};
+    const int overlay_node = scene.addCustom(overlay_bounds, [&](const SDL_Rect &bounds)
     {
-        // Read user input
-        while(SDL_PollEvent(&event))
+        PROFILE_OVERLAY(text_engine, font_file, bounds.x, bounds.y);
+    });
+#endif
+
+    // Setup main loop. Input is handled as it arrives and the scene is
+    // redrawn at most MAX_FPS times a second. Pass --frames N to run N
+    // frames as fast as possible instead
+    GameLoopConfig loop_config;
+    loop_config.max_fps = MAX_FPS;
+    parseLoopArgs(argc, argv, loop_config);
+    GameLoop loop(loop_config);
+
+    // Read user input
+    loop.onEvent([&](const SDL_Event &event)
+    {
+        scene.handleEvent(event);
+
+        if (event.type == SDL_QUIT)
         {
-            if (event.type == SDL_QUIT)
-            {
-                quit = true;
-            }
+            loop.quit();
+        }
 
-            if (event.type == SDL_KEYDOWN)
+        if (event.type == SDL_KEYDOWN)
+        {
+            switch (event.key.keysym.sym)
             {
-                switch (event.key.keysym.sym)
-                {
-                    case SDLK_ESCAPE:
-                        quit = true;
-                        break;
-                    default:
-                        break;
-                }
+                case SDLK_ESCAPE:
+                    loop.quit();
+                    break;
+                default:
+                    break;
             }
         }
+    });
+
+    // Render scene, skipping the frame when nothing changed
+    loop.onRender([&](double)
+    {
+        bool drawn = false;
+        {
+            PROFILE_ZONE("draw");
+            drawn = scene.render();
+        }
+        if (drawn)
+        {
+            PROFILE_ZONE("present");
+            SDL_RenderPresent(renderer.get());
+        }
+#ifdef ENABLE_PROFILER
+        scene.markDirty(overlay_node);
+#endif
+    });
 
-        // Render scene
-        SDL_RenderClear(renderer);
-        renderTexture(tex_img, renderer, img_pos_x, img_pos_y);
-        SDL_RenderPresent(renderer);
+    // Sleep until the next event while there is nothing to redraw
+    loop.onIdle([&]()
+    {
+        return !scene.isDirty();
+    });
+
+    loop.run();
+    if (loop_config.headless_frames > 0)
+    {
+        std::cout << CURRENT_LESSON << " frames=" << loop.getFrames()
+                  << " seconds=" << loop.getSeconds()
+                  << " fps=" << loop.getFps()
+                  << " redraws=" << scene.getRedraws() << std::endl;
     }
 
-    cleanup(tex_img, renderer, window);
-    SDL_Quit();
+    PROFILE_REPORT(std::cout);
+    PROFILE_WRITE_TRACE("lesson6_trace.json");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "asset_pack.h"
+
+// Offline pack builder. Bundles every file under a resource directory
+// into one pack that AssetPack maps at runtime, eg. from lessons:
+//   SDL_AssetPack res/ res/assets.pack
+// Existing .pack files under the directory are left out.
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cout << "usage: " << argv[0] << " res_dir/ out.pack" << std::endl;
+        return 1;
+    }
+
+    std::string root = argv[1];
+    if (root.empty() || (root[root.size() - 1] != '/' && root[root.size() - 1] != '\\'))
+    {
+        root += '/';
+    }
+    const std::string out_file = argv[2];
+
+    std::vector<std::string> all_names, names;
+    listAssetFiles(root, "", all_names);
+    for (size_t i = 0; i < all_names.size(); ++i)
+    {
+        const std::string &name = all_names[i];
+        if (name.size() < 5 || name.compare(name.size() - 5, 5, ".pack") != 0)
+        {
+            names.push_back(name);
+        }
+    }
+    if (names.empty())
+    {
+        std::cout << "No files found under " << root << std::endl;
+        return 1;
+    }
+
+    if (!writeAssetPack(root, names, out_file))
+    {
+        return 1;
+    }
+    std::cout << "Packed " << names.size() << " files into " << out_file << std::endl;
+    return 0;
+}
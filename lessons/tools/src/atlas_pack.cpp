@@ -0,0 +1,60 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "atlas_packer.h"
+
+// Offline atlas builder. Packs loose images into pages and writes the
+// pages plus a manifest that TextureAtlas::load reads back at runtime.
+// Each image is stored under the path it was given on the command line,
+// so run it from the directory the game will look images up relative
+// to, eg. from lessons/res:
+//   SDL_AtlasPack ./ atlas 1024 lesson3/background.png lesson3/image.png
+const int PADDING = 1;
+
+int main(int argc, char **argv)
+{
+    if (argc < 5)
+    {
+        std::cout << "usage: " << argv[0]
+                  << " out_dir/ name page_size image [image...]" << std::endl;
+        return 1;
+    }
+
+    const std::string out_dir = argv[1];
+    const std::string name = argv[2];
+    const int page_size = std::atoi(argv[3]);
+    if (page_size <= 0)
+    {
+        std::cout << "page_size must be a positive number of pixels" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    for (int i = 4; i < argc; ++i)
+    {
+        files.push_back(argv[i]);
+    }
+
+    if (SDL_Init(0) != 0 || (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG)
+    {
+        std::cout << "SDL_Init/IMG_Init" << SDL_GetError() << std::endl;
+        return 1;
+    }
+
+    AtlasLayout layout;
+    bool ok = buildAtlas(files, files, page_size, PADDING, layout) &&
+        writeAtlas(layout, out_dir, name);
+    if (ok)
+    {
+        std::cout << "Packed " << layout.regions.size() << " images into "
+                  << layout.pages.size() << " pages" << std::endl;
+    }
+
+    freeAtlasLayout(layout);
+    IMG_Quit();
+    SDL_Quit();
+    return ok ? 0 : 1;
+}